@@ -27,6 +27,7 @@
 #include "libavutil/ffversion.h"
 
 #include <string.h>
+#include <sys/stat.h>
 
 #include "libavformat/avformat.h"
 #include "libavcodec/avcodec.h"
@@ -70,6 +71,9 @@ typedef struct InputStream {
     AVStream *st;
 
     AVCodecContext *dec_ctx;
+
+    AVCodecParserContext *parser;   ///< used instead of the decoder with -parse_frames
+    AVCodecContext *parser_ctx;
 } InputStream;
 
 typedef struct InputFile {
@@ -85,6 +89,7 @@ const int program_birth_year = 2007;
 static int do_bitexact = 0;
 static int do_count_frames = 0;
 static int do_count_packets = 0;
+static int do_parse_frames = 0;
 static int do_read_frames  = 0;
 static int do_read_packets = 0;
 static int do_show_chapters = 0;
@@ -115,6 +120,7 @@ static int use_value_prefix             = 0;
 static int use_byte_value_binary_prefix = 0;
 static int use_value_sexagesimal_format = 0;
 static int show_private_data            = 1;
+static int flush_entries                = 1;
 
 static char *print_format;
 static char *stream_specifier;
@@ -2099,7 +2105,8 @@ static void show_packet(WriterContext *w, InputFile *ifile, AVPacket *pkt, int p
     writer_print_section_footer(w);
 
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
+    if (flush_entries)
+        fflush(stdout);
 }
 
 static void show_subtitle(WriterContext *w, AVSubtitle *sub, AVStream *stream,
@@ -2122,7 +2129,8 @@ static void show_subtitle(WriterContext *w, AVSubtitle *sub, AVStream *stream,
     writer_print_section_footer(w);
 
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
+    if (flush_entries)
+        fflush(stdout);
 }
 
 static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
@@ -2268,7 +2276,83 @@ static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
     writer_print_section_footer(w);
 
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
+    if (flush_entries)
+        fflush(stdout);
+}
+
+/**
+ * Describe the frame in pkt from what the parser and the container know,
+ * without decoding it. Fields only a decoder can provide are left unset.
+ */
+static void parse_frame(WriterContext *w, InputFile *ifile,
+                        AVFrame *frame, AVPacket *pkt)
+{
+    InputStream *ist = &ifile->streams[pkt->stream_index];
+    AVCodecParameters *par = ist->st->codecpar;
+    AVCodecParserContext *parser = ist->parser;
+    const uint8_t *data = pkt->data;
+    int size = pkt->size;
+
+    while (size > 0) {
+        uint8_t *out = pkt->data;
+        int out_size = size, len = size;
+
+        if (parser) {
+            len = av_parser_parse2(parser, ist->parser_ctx, &out, &out_size,
+                                   data, size, pkt->pts, pkt->dts, pkt->pos);
+            /* parsers are never flushed here, so stop once nothing is
+             * consumed, after describing whatever was still returned */
+            if (len <= 0)
+                len = size;
+        }
+        data += len;
+        size -= len;
+        if (!out_size)
+            continue;
+
+        av_frame_unref(frame);
+        frame->key_frame = parser && parser->key_frame >= 0 ? parser->key_frame :
+                           !!(pkt->flags & AV_PKT_FLAG_KEY);
+        frame->pts                   = pkt->pts;
+        frame->pkt_dts               = pkt->dts;
+        frame->best_effort_timestamp = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+        frame->pkt_duration          = pkt->duration;
+        frame->pkt_pos               = pkt->pos;
+        frame->pkt_size              = out_size;
+        frame->format                = parser && parser->format >= 0 ? parser->format : par->format;
+
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+            frame->width               = parser && parser->width  > 0 ? parser->width  : par->width;
+            frame->height              = parser && parser->height > 0 ? parser->height : par->height;
+            frame->sample_aspect_ratio = par->sample_aspect_ratio;
+            frame->color_range         = par->color_range;
+            frame->colorspace          = par->color_space;
+            frame->color_primaries     = par->color_primaries;
+            frame->color_trc           = par->color_trc;
+            frame->chroma_location     = par->chroma_location;
+            if (parser) {
+                /* set up from the stream, some parsers update it */
+                int ticks_per_frame = FFMAX(ist->parser_ctx->ticks_per_frame, 1);
+
+                frame->pict_type        = parser->pict_type;
+                /* the parser counts the picture duration in ticks minus one,
+                 * AVFrame counts the fields beyond the first two */
+                frame->repeat_pict      = FFMAX((1 + parser->repeat_pict) * 2 / ticks_per_frame - 2, 0);
+                frame->interlaced_frame = parser->field_order > AV_FIELD_PROGRESSIVE;
+                frame->top_field_first  = parser->field_order == AV_FIELD_TT ||
+                                          parser->field_order == AV_FIELD_TB;
+            }
+        } else {
+            frame->nb_samples     = parser && parser->duration > 0 ? parser->duration :
+                                    av_get_audio_frame_duration2(par, out_size);
+            frame->channels       = par->channels;
+            frame->channel_layout = par->channel_layout;
+        }
+
+        nb_streams_frames[pkt->stream_index]++;
+        if (do_show_frames)
+            show_frame(w, frame, ist->st, ifile->fmt_ctx);
+    }
 }
 
 static av_always_inline int process_frame(WriterContext *w,
@@ -2283,6 +2367,12 @@ static av_always_inline int process_frame(WriterContext *w,
     int ret = 0, got_frame = 0;
 
     clear_log(1);
+    if (ifile->streams[pkt->stream_index].parser_ctx) {
+        if (*packet_new)
+            parse_frame(w, ifile, frame, pkt);
+        *packet_new = 0;
+        return 0;
+    }
     if (dec_ctx && dec_ctx->codec) {
         switch (par->codec_type) {
         case AVMEDIA_TYPE_VIDEO:
@@ -2955,6 +3045,15 @@ static int open_input_file(InputFile *ifile, const char *filename,
             ist->dec_ctx->coded_height = stream->codec->coded_height;
 #endif
 
+            /* with -parse_frames, audio and video frames come from the
+             * parsers, the decoder context only describes the stream */
+            if (do_parse_frames &&
+                (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO ||
+                 stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)) {
+                av_dict_free(&opts);
+                continue;
+            }
+
             if (avcodec_open2(ist->dec_ctx, codec, &opts) < 0) {
                 av_log(NULL, AV_LOG_WARNING, "Could not open codec for input stream %d\n",
                        stream->index);
@@ -2969,6 +3068,28 @@ static int open_input_file(InputFile *ifile, const char *filename,
         }
     }
 
+    /* with -parse_frames, audio and video frames come from the parsers */
+    for (i = 0; do_parse_frames && i < fmt_ctx->nb_streams; i++) {
+        InputStream *ist = &ifile->streams[i];
+        AVCodecParameters *par = fmt_ctx->streams[i]->codecpar;
+
+        if (par->codec_type != AVMEDIA_TYPE_VIDEO &&
+            par->codec_type != AVMEDIA_TYPE_AUDIO)
+            continue;
+
+        ist->parser_ctx = avcodec_alloc_context3(NULL);
+        if (!ist->parser_ctx || avcodec_parameters_to_context(ist->parser_ctx, par) < 0)
+            exit(1);
+#if FF_API_LAVF_AVCTX
+        /* some decoders set ticks_per_frame on init, which
+         * avformat_find_stream_info() did for us */
+        ist->parser_ctx->ticks_per_frame = fmt_ctx->streams[i]->codec->ticks_per_frame;
+#endif
+        ist->parser = av_parser_init(par->codec_id);
+        if (ist->parser)
+            ist->parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+    }
+
     ifile->fmt_ctx = fmt_ctx;
     return 0;
 }
@@ -2978,9 +3099,12 @@ static void close_input_file(InputFile *ifile)
     int i;
 
     /* close decoder for each stream */
-    for (i = 0; i < ifile->nb_streams; i++)
+    for (i = 0; i < ifile->nb_streams; i++) {
         if (ifile->streams[i].st->codecpar->codec_id != AV_CODEC_ID_NONE)
             avcodec_free_context(&ifile->streams[i].dec_ctx);
+        av_parser_close(ifile->streams[i].parser);
+        avcodec_free_context(&ifile->streams[i].parser_ctx);
+    }
 
     av_freep(&ifile->streams);
     ifile->nb_streams = 0;
@@ -3557,6 +3681,7 @@ static const OptionDef real_options[] = {
     { "show_streams", 0, { .func_arg = &opt_show_streams }, "show streams info" },
     { "show_chapters", 0, { .func_arg = &opt_show_chapters }, "show chapters info" },
     { "count_frames", OPT_BOOL, { &do_count_frames }, "count the number of frames per stream" },
+    { "parse_frames", OPT_BOOL, { &do_parse_frames }, "use parsers instead of decoders to read audio and video frames" },
     { "count_packets", OPT_BOOL, { &do_count_packets }, "count the number of packets per stream" },
     { "show_program_version",  0, { .func_arg = &opt_show_program_version },  "show ffprobe version" },
     { "show_library_versions", 0, { .func_arg = &opt_show_library_versions }, "show library versions" },
@@ -3695,6 +3820,16 @@ int main(int argc, char **argv)
         goto end;
     }
 
+#ifdef S_ISREG
+    /* Flushing after every packet and frame only matters to a reader that
+     * consumes the output while it is produced, which a plain file has not */
+    {
+        struct stat st;
+        if (!fstat(fileno(stdout), &st) && S_ISREG(st.st_mode))
+            flush_entries = 0;
+    }
+#endif
+
     if ((ret = writer_open(&wctx, w, w_args,
                            sections, FF_ARRAY_ELEMS(sections))) >= 0) {
         if (w == &xml_writer)
@@ -43,6 +43,7 @@
 typedef struct A64Context {
     /* variables for multicolor modes */
     AVLFG randctx;
+    ELBGThreadContext *elbg_threads;
     int mc_lifetime;
     int mc_use_5col;
     unsigned mc_frame_counter;
@@ -197,13 +198,14 @@ static av_cold int a64multi_close_encoder(AVCodecContext *avctx)
     av_freep(&c->mc_charset);
     av_freep(&c->mc_charmap);
     av_freep(&c->mc_colram);
+    avpriv_elbg_thread_free(&c->elbg_threads);
     return 0;
 }
 
 static av_cold int a64multi_encode_init(AVCodecContext *avctx)
 {
     A64Context *c = avctx->priv_data;
-    int a;
+    int a, ret;
     av_lfg_init(&c->randctx, 1);
 
     if (avctx->global_quality < 1) {
@@ -234,6 +236,9 @@ static av_cold int a64multi_encode_init(AVCodecContext *avctx)
         return AVERROR(ENOMEM);
     }
 
+    if ((ret = avpriv_elbg_thread_alloc(&c->elbg_threads, avctx->thread_count)) < 0)
+        return ret;
+
     /* set up extradata */
     if (!(avctx->extradata = av_mallocz(8 * 4 + AV_INPUT_BUFFER_PADDING_SIZE))) {
         av_log(avctx, AV_LOG_ERROR, "Failed to allocate memory for extradata.\n");
@@ -333,12 +338,12 @@ static int a64multi_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             buf = pkt->data;
 
             /* calc optimal new charset + charmaps */
-            ret = avpriv_init_elbg(meta, 32, 1000 * c->mc_lifetime, best_cb,
-                               CHARSET_CHARS, 50, charmap, &c->randctx);
+            ret = avpriv_init_elbg2(c->elbg_threads, meta, 32, 1000 * c->mc_lifetime,
+                                    best_cb, CHARSET_CHARS, 50, charmap, &c->randctx);
             if (ret < 0)
                 return ret;
-            ret = avpriv_do_elbg(meta, 32, 1000 * c->mc_lifetime, best_cb,
-                             CHARSET_CHARS, 50, charmap, &c->randctx);
+            ret = avpriv_do_elbg2(c->elbg_threads, meta, 32, 1000 * c->mc_lifetime,
+                                  best_cb, CHARSET_CHARS, 50, charmap, &c->randctx);
             if (ret < 0)
                 return ret;
 
@@ -406,7 +411,7 @@ AVCodec ff_a64multi_encoder = {
     .encode2        = a64multi_encode_frame,
     .close          = a64multi_close_encoder,
     .pix_fmts       = (const enum AVPixelFormat[]) {AV_PIX_FMT_GRAY8, AV_PIX_FMT_NONE},
-    .capabilities   = AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_AUTO_THREADS,
 };
 #endif
 #if CONFIG_A64MULTI5_ENCODER
@@ -420,6 +425,6 @@ AVCodec ff_a64multi5_encoder = {
     .encode2        = a64multi_encode_frame,
     .close          = a64multi_close_encoder,
     .pix_fmts       = (const enum AVPixelFormat[]) {AV_PIX_FMT_GRAY8, AV_PIX_FMT_NONE},
-    .capabilities   = AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_AUTO_THREADS,
 };
 #endif
@@ -49,6 +49,8 @@ typedef struct AV1MetadataContext {
     int num_ticks_per_picture;
 
     int delete_padding;
+
+    int full_decompose;
 } AV1MetadataContext;
 
 
@@ -232,6 +234,10 @@ fail:
     return err;
 }
 
+static const CodedBitstreamUnitType av1_metadata_decompose_types[] = {
+    AV1_OBU_SEQUENCE_HEADER,
+};
+
 static int av1_metadata_init(AVBSFContext *bsf)
 {
     AV1MetadataContext *ctx = bsf->priv_data;
@@ -243,6 +249,14 @@ static int av1_metadata_init(AVBSFContext *bsf)
     if (err < 0)
         return err;
 
+    // Only sequence headers are ever modified.
+    if (!ctx->full_decompose) {
+        ctx->cbc->decompose_unit_types    =
+            (CodedBitstreamUnitType*)av1_metadata_decompose_types;
+        ctx->cbc->nb_decompose_unit_types =
+            FF_ARRAY_ELEMS(av1_metadata_decompose_types);
+    }
+
     if (bsf->par_in->extradata) {
         err = ff_cbs_read_extradata(ctx->cbc, frag, bsf->par_in);
         if (err < 0) {
@@ -332,6 +346,10 @@ static const AVOption av1_metadata_options[] = {
         OFFSET(delete_padding), AV_OPT_TYPE_BOOL,
         { .i64 = 0 }, 0, 1, FLAGS},
 
+    { "full_decompose", "Decompose all units, not only those options modify",
+        OFFSET(full_decompose), AV_OPT_TYPE_BOOL,
+        { .i64 = 0 }, 0, 1, FLAGS },
+
     { NULL }
 };
 
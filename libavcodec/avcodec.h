@@ -374,6 +374,10 @@ typedef struct RcOverride{
  * Show all frames before the first keyframe
  */
 #define AV_CODEC_FLAG2_SHOW_ALL       (1 << 22)
+/**
+ * Recycle the packet buffers the codec allocates through per-context pools
+ */
+#define AV_CODEC_FLAG2_POOL_PACKETS   (1 << 23)
 /**
  * Export motion vectors through frame side data
  */
@@ -771,3 +771,170 @@ int ff_side_data_set_prft(AVPacket *pkt, int64_t timestamp)
 
     return 0;
 }
+
+struct FFPacketPool {
+    AVBufferPool *pools[27];
+    /* Only updated by packet_pool_get(), i.e. by the thread owning the pool:
+     * the allocation callback is called synchronously from
+     * av_buffer_pool_get(), while buffers returned from other threads do
+     * not touch the counters. */
+    uint64_t nb_requests;
+    uint64_t nb_allocs;
+};
+
+static AVBufferRef *packet_pool_alloc_buffer(void *opaque, int size)
+{
+    FFPacketPool *pool = opaque;
+
+    pool->nb_allocs++;
+    return av_buffer_alloc(size);
+}
+
+FFPacketPool *avpriv_packet_pool_alloc(void)
+{
+    return av_mallocz(sizeof(FFPacketPool));
+}
+
+void avpriv_packet_pool_free(FFPacketPool **ppool, void *logctx)
+{
+    FFPacketPool *pool = *ppool;
+    int i;
+
+    if (!pool)
+        return;
+
+    av_log(logctx, AV_LOG_DEBUG, "Packet pool: %"PRIu64" buffers requested, "
+           "%"PRIu64" allocated\n", pool->nb_requests, pool->nb_allocs);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(pool->pools); i++)
+        av_buffer_pool_uninit(&pool->pools[i]);
+    av_freep(ppool);
+}
+
+static int packet_pool_get(FFPacketPool *pool, AVBufferRef **buf, int size)
+{
+    int index;
+
+    if (size < 0 || size >= INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR(EINVAL);
+
+    index = av_log2(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (index >= FF_ARRAY_ELEMS(pool->pools))
+        return packet_alloc(buf, size);
+
+    if (!pool->pools[index]) {
+        pool->pools[index] = av_buffer_pool_init2(2 << index, pool,
+                                                  packet_pool_alloc_buffer, NULL);
+        if (!pool->pools[index])
+            return AVERROR(ENOMEM);
+    }
+    *buf = av_buffer_pool_get(pool->pools[index]);
+    if (!*buf)
+        return AVERROR(ENOMEM);
+    pool->nb_requests++;
+
+    memset((*buf)->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    return 0;
+}
+
+int avpriv_packet_pool_new_packet(FFPacketPool *pool, AVPacket *pkt, int size)
+{
+    AVBufferRef *buf = NULL;
+    int ret;
+
+    if (!pool)
+        return av_new_packet(pkt, size);
+
+    ret = packet_pool_get(pool, &buf, size);
+    if (ret < 0)
+        return ret;
+
+    av_init_packet(pkt);
+    pkt->buf      = buf;
+    pkt->data     = buf->data;
+    pkt->size     = size;
+
+    return 0;
+}
+
+int avpriv_packet_pool_grow_packet(FFPacketPool *pool, AVPacket *pkt, int grow_by)
+{
+    AVBufferRef *buf = NULL;
+    int new_size, ret;
+
+    if (!pool)
+        return av_grow_packet(pkt, grow_by);
+
+    if ((unsigned)grow_by >
+        INT_MAX - (pkt->size + AV_INPUT_BUFFER_PADDING_SIZE))
+        return AVERROR(ENOMEM);
+    new_size = pkt->size + grow_by;
+
+    /* Pooled buffers are rounded up to a power of two, so the packet can
+     * often grow in place. */
+    if (!pkt->buf || !av_buffer_is_writable(pkt->buf) ||
+        pkt->buf->data + pkt->buf->size - pkt->data <
+        new_size + AV_INPUT_BUFFER_PADDING_SIZE) {
+        ret = packet_pool_get(pool, &buf, new_size);
+        if (ret < 0)
+            return ret;
+        if (pkt->size)
+            memcpy(buf->data, pkt->data, pkt->size);
+        av_buffer_unref(&pkt->buf);
+        pkt->buf  = buf;
+        pkt->data = buf->data;
+    }
+    pkt->size = new_size;
+    memset(pkt->data + new_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    return 0;
+}
+
+int avpriv_packet_pool_make_refcounted(FFPacketPool *pool, AVPacket *pkt)
+{
+    int ret;
+
+    if (!pool)
+        return av_packet_make_refcounted(pkt);
+    if (pkt->buf)
+        return 0;
+
+    ret = packet_pool_get(pool, &pkt->buf, pkt->size);
+    if (ret < 0)
+        return ret;
+    if (pkt->size)
+        memcpy(pkt->buf->data, pkt->data, pkt->size);
+
+    pkt->data = pkt->buf->data;
+
+    return 0;
+}
+
+int avpriv_packet_pool_ref(FFPacketPool *pool, AVPacket *dst, const AVPacket *src)
+{
+    int ret;
+
+    if (!pool || src->buf)
+        return av_packet_ref(dst, src);
+
+    dst->buf = NULL;
+
+    ret = av_packet_copy_props(dst, src);
+    if (ret < 0)
+        goto fail;
+
+    ret = packet_pool_get(pool, &dst->buf, src->size);
+    if (ret < 0)
+        goto fail;
+    if (src->size)
+        memcpy(dst->buf->data, src->data, src->size);
+
+    dst->data = dst->buf->data;
+    dst->size = src->size;
+
+    return 0;
+fail:
+    av_packet_unref(dst);
+    return ret;
+}
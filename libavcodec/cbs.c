@@ -150,6 +150,7 @@ void ff_cbs_fragment_reset(CodedBitstreamFragment *frag)
     frag->data             = NULL;
     frag->data_size        = 0;
     frag->data_bit_padding = 0;
+    frag->data_unmodified  = 0;
 }
 
 void ff_cbs_fragment_free(CodedBitstreamFragment *frag)
@@ -228,6 +229,8 @@ int ff_cbs_read_extradata(CodedBitstreamContext *ctx,
     if (err < 0)
         return err;
 
+    frag->data_unmodified = 1;
+
     err = ctx->codec->split_fragment(ctx, frag, 1);
     if (err < 0)
         return err;
@@ -255,6 +258,8 @@ int ff_cbs_read_packet(CodedBitstreamContext *ctx,
             return err;
     }
 
+    frag->data_unmodified = 1;
+
     err = ctx->codec->split_fragment(ctx, frag, 0);
     if (err < 0)
         return err;
@@ -272,6 +277,8 @@ int ff_cbs_read(CodedBitstreamContext *ctx,
     if (err < 0)
         return err;
 
+    frag->data_unmodified = 1;
+
     err = ctx->codec->split_fragment(ctx, frag, 0);
     if (err < 0)
         return err;
@@ -338,6 +345,18 @@ int ff_cbs_write_fragment_data(CodedBitstreamContext *ctx,
 {
     int err, i;
 
+    if (frag->data_unmodified && frag->data) {
+        // Nothing to write if no unit has been decomposed: pass the
+        // original bitstream through without copying it.
+        for (i = 0; i < frag->nb_units; i++) {
+            if (frag->units[i].content)
+                break;
+        }
+        if (i >= frag->nb_units)
+            return 0;
+    }
+    frag->data_unmodified = 0;
+
     for (i = 0; i < frag->nb_units; i++) {
         CodedBitstreamUnit *unit = &frag->units[i];
 
@@ -745,6 +764,8 @@ int ff_cbs_insert_unit_content(CodedBitstreamFragment *frag,
     unit->content     = content;
     unit->content_ref = content_ref;
 
+    frag->data_unmodified = 0;
+
     return 0;
 }
 
@@ -784,6 +805,8 @@ int ff_cbs_insert_unit_data(CodedBitstreamFragment *frag,
     unit->data_size = data_size;
     unit->data_ref  = data_ref;
 
+    frag->data_unmodified = 0;
+
     return 0;
 }
 
@@ -796,6 +819,7 @@ void ff_cbs_delete_unit(CodedBitstreamFragment *frag,
     cbs_unit_uninit(&frag->units[position]);
 
     --frag->nb_units;
+    frag->data_unmodified = 0;
 
     if (frag->nb_units > 0)
         memmove(frag->units + position,
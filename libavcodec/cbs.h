@@ -138,6 +138,19 @@ typedef struct CodedBitstreamFragment {
      */
     AVBufferRef *data_ref;
 
+    /**
+     * Set when data still holds the bitstream the fragment was read
+     * from and no unit has been inserted or deleted since.
+     *
+     * If no unit has content either, writing the fragment then reuses
+     * data by reference instead of reassembling it.  Cleared by
+     * ff_cbs_insert_unit_content(), ff_cbs_insert_unit_data() and
+     * ff_cbs_delete_unit(); codecs
+     * clear it in split_fragment() when the input form differs from the
+     * one assemble_fragment() writes.
+     */
+    int data_unmodified;
+
     /**
      * Number of units in this fragment.
      *
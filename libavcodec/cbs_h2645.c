@@ -756,6 +756,11 @@ static int cbs_h2645_split_fragment(CodedBitstreamContext *ctx,
             return err;
     }
 
+    // Fragments are always assembled in Annex B form, so MP4 input
+    // can't be passed through unchanged.
+    if (priv->mp4)
+        frag->data_unmodified = 0;
+
     return 0;
 }
 
@@ -1442,6 +1447,19 @@ static int cbs_h2645_assemble_fragment(CodedBitstreamContext *ctx,
 
         zero_run = 0;
         for (sp = 0; sp < unit->data_size; sp++) {
+            if (zero_run == 0) {
+                // Nothing can need escaping before the next zero byte,
+                // so copy up to it in one go.
+                const uint8_t *zero = memchr(unit->data + sp, 0,
+                                             unit->data_size - sp);
+                size_t run = zero ? zero - (unit->data + sp)
+                                  : unit->data_size - sp;
+                memcpy(data + dp, unit->data + sp, run);
+                dp += run;
+                sp += run;
+                if (sp >= unit->data_size)
+                    break;
+            }
             if (zero_run < 2) {
                 if (unit->data[sp] == 0)
                     ++zero_run;
@@ -75,6 +75,8 @@ static av_cold int cfhd_init(AVCodecContext *avctx)
     avctx->bits_per_raw_sample = 10;
     s->avctx                   = avctx;
 
+    ff_cfhddsp_init(&s->dsp);
+
     return ff_cfhd_init_vlcs(s);
 }
 
@@ -203,49 +205,6 @@ static inline void process_bayer(AVFrame *frame)
     }
 }
 
-static inline void filter(int16_t *output, ptrdiff_t out_stride,
-                          int16_t *low, ptrdiff_t low_stride,
-                          int16_t *high, ptrdiff_t high_stride,
-                          int len, int clip)
-{
-    int16_t tmp;
-    int i;
-
-    for (i = 0; i < len; i++) {
-        if (i == 0) {
-            tmp = (11*low[0*low_stride] - 4*low[1*low_stride] + low[2*low_stride] + 4) >> 3;
-            output[(2*i+0)*out_stride] = (tmp + high[0*high_stride]) >> 1;
-            if (clip)
-                output[(2*i+0)*out_stride] = av_clip_uintp2_c(output[(2*i+0)*out_stride], clip);
-
-            tmp = ( 5*low[0*low_stride] + 4*low[1*low_stride] - low[2*low_stride] + 4) >> 3;
-            output[(2*i+1)*out_stride] = (tmp - high[0*high_stride]) >> 1;
-            if (clip)
-                output[(2*i+1)*out_stride] = av_clip_uintp2_c(output[(2*i+1)*out_stride], clip);
-        } else if (i == len-1) {
-            tmp = ( 5*low[i*low_stride] + 4*low[(i-1)*low_stride] - low[(i-2)*low_stride] + 4) >> 3;
-            output[(2*i+0)*out_stride] = (tmp + high[i*high_stride]) >> 1;
-            if (clip)
-                output[(2*i+0)*out_stride] = av_clip_uintp2_c(output[(2*i+0)*out_stride], clip);
-
-            tmp = (11*low[i*low_stride] - 4*low[(i-1)*low_stride] + low[(i-2)*low_stride] + 4) >> 3;
-            output[(2*i+1)*out_stride] = (tmp - high[i*high_stride]) >> 1;
-            if (clip)
-                output[(2*i+1)*out_stride] = av_clip_uintp2_c(output[(2*i+1)*out_stride], clip);
-        } else {
-            tmp = (low[(i-1)*low_stride] - low[(i+1)*low_stride] + 4) >> 3;
-            output[(2*i+0)*out_stride] = (tmp + low[i*low_stride] + high[i*high_stride]) >> 1;
-            if (clip)
-                output[(2*i+0)*out_stride] = av_clip_uintp2_c(output[(2*i+0)*out_stride], clip);
-
-            tmp = (low[(i+1)*low_stride] - low[(i-1)*low_stride] + 4) >> 3;
-            output[(2*i+1)*out_stride] = (tmp + low[i*low_stride] - high[i*high_stride]) >> 1;
-            if (clip)
-                output[(2*i+1)*out_stride] = av_clip_uintp2_c(output[(2*i+1)*out_stride], clip);
-        }
-    }
-}
-
 static inline void interlaced_vertical_filter(int16_t *output, int16_t *low, int16_t *high,
                          int width, int linesize, int plane)
 {
@@ -258,30 +217,6 @@ static inline void interlaced_vertical_filter(int16_t *output, int16_t *low, int
         output[i + linesize] = av_clip_uintp2(odd, 10);
     }
 }
-static void horiz_filter(int16_t *output, int16_t *low, int16_t *high,
-                         int width)
-{
-    filter(output, 1, low, 1, high, 1, width, 0);
-}
-
-static void horiz_filter_clip(int16_t *output, int16_t *low, int16_t *high,
-                              int width, int clip)
-{
-    filter(output, 1, low, 1, high, 1, width, clip);
-}
-
-static void horiz_filter_clip_bayer(int16_t *output, int16_t *low, int16_t *high,
-                                    int width, int clip)
-{
-    filter(output, 2, low, 1, high, 1, width, clip);
-}
-
-static void vert_filter(int16_t *output, ptrdiff_t out_stride,
-                        int16_t *low, ptrdiff_t low_stride,
-                        int16_t *high, ptrdiff_t high_stride, int len)
-{
-    filter(output, out_stride, low, low_stride, high, high_stride, len, 0);
-}
 
 static void free_buffers(CFHDContext *s)
 {
@@ -389,6 +324,201 @@ static int alloc_buffers(AVCodecContext *avctx)
     return 0;
 }
 
+/** Inverse wavelet transform of one plane; planes are independent. */
+static int reconstruct_plane(AVCodecContext *avctx, void *arg,
+                             int plane, int threadnr)
+{
+    CFHDContext *s = avctx->priv_data;
+    AVFrame *pic   = arg;
+    int i, j;
+
+    /* level 1 */
+    int lowpass_height  = s->plane[plane].band[0][0].height;
+    int lowpass_width   = s->plane[plane].band[0][0].width;
+    int highpass_stride = s->plane[plane].band[0][1].stride;
+    int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
+    ptrdiff_t dst_linesize;
+    int16_t *low, *high, *output, *dst;
+
+    if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+        act_plane = 0;
+        dst_linesize = pic->linesize[act_plane];
+    } else {
+        dst_linesize = pic->linesize[act_plane] / 2;
+    }
+
+    if (lowpass_height > s->plane[plane].band[0][0].a_height || lowpass_width > s->plane[plane].band[0][0].a_width ||
+        !highpass_stride || s->plane[plane].band[0][1].width > s->plane[plane].band[0][1].a_width) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = s->plane[plane].subband[0];
+    high   = s->plane[plane].subband[2];
+    output = s->plane[plane].l_h[0];
+    s->dsp.vert_filter(output, lowpass_width, low, lowpass_width, high, highpass_stride,
+                       lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].subband[1];
+    high   = s->plane[plane].subband[3];
+    output = s->plane[plane].l_h[1];
+
+    // note the stride of "low" is highpass_stride
+    s->dsp.vert_filter(output, lowpass_width, low, highpass_stride, high, highpass_stride,
+                       lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].l_h[0];
+    high   = s->plane[plane].l_h[1];
+    output = s->plane[plane].subband[0];
+    for (i = 0; i < lowpass_height * 2; i++) {
+        s->dsp.horiz_filter(output, low, high, lowpass_width);
+        low    += lowpass_width;
+        high   += lowpass_width;
+        output += lowpass_width * 2;
+    }
+    if (s->bpc == 12) {
+        output = s->plane[plane].subband[0];
+        for (i = 0; i < lowpass_height * 2; i++) {
+            for (j = 0; j < lowpass_width * 2; j++)
+                output[j] *= 4;
+
+            output += lowpass_width * 2;
+        }
+    }
+
+    /* level 2 */
+    lowpass_height  = s->plane[plane].band[1][1].height;
+    lowpass_width   = s->plane[plane].band[1][1].width;
+    highpass_stride = s->plane[plane].band[1][1].stride;
+
+    if (lowpass_height > s->plane[plane].band[1][1].a_height || lowpass_width > s->plane[plane].band[1][1].a_width ||
+        !highpass_stride || s->plane[plane].band[1][1].width > s->plane[plane].band[1][1].a_width) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Level 2 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = s->plane[plane].subband[0];
+    high   = s->plane[plane].subband[5];
+    output = s->plane[plane].l_h[3];
+    s->dsp.vert_filter(output, lowpass_width, low, lowpass_width, high, highpass_stride,
+                       lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].subband[4];
+    high   = s->plane[plane].subband[6];
+    output = s->plane[plane].l_h[4];
+    s->dsp.vert_filter(output, lowpass_width, low, highpass_stride, high, highpass_stride,
+                       lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].l_h[3];
+    high   = s->plane[plane].l_h[4];
+    output = s->plane[plane].subband[0];
+    for (i = 0; i < lowpass_height * 2; i++) {
+        s->dsp.horiz_filter(output, low, high, lowpass_width);
+        low    += lowpass_width;
+        high   += lowpass_width;
+        output += lowpass_width * 2;
+    }
+
+    output = s->plane[plane].subband[0];
+    for (i = 0; i < lowpass_height * 2; i++) {
+        for (j = 0; j < lowpass_width * 2; j++)
+            output[j] *= 4;
+
+        output += lowpass_width * 2;
+    }
+
+    /* level 3 */
+    lowpass_height  = s->plane[plane].band[2][1].height;
+    lowpass_width   = s->plane[plane].band[2][1].width;
+    highpass_stride = s->plane[plane].band[2][1].stride;
+
+    if (lowpass_height > s->plane[plane].band[2][1].a_height || lowpass_width > s->plane[plane].band[2][1].a_width ||
+        !highpass_stride || s->plane[plane].band[2][1].width > s->plane[plane].band[2][1].a_width) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Level 3 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+    if (s->progressive) {
+        low    = s->plane[plane].subband[0];
+        high   = s->plane[plane].subband[8];
+        output = s->plane[plane].l_h[6];
+        s->dsp.vert_filter(output, lowpass_width, low, lowpass_width, high, highpass_stride,
+                           lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].subband[7];
+        high   = s->plane[plane].subband[9];
+        output = s->plane[plane].l_h[7];
+        s->dsp.vert_filter(output, lowpass_width, low, highpass_stride, high, highpass_stride,
+                           lowpass_width, lowpass_height);
+
+        dst = (int16_t *)pic->data[act_plane];
+        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+            if (plane & 1)
+                dst++;
+            if (plane > 1)
+                dst += pic->linesize[act_plane] >> 1;
+        }
+        low  = s->plane[plane].l_h[6];
+        high = s->plane[plane].l_h[7];
+
+        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
+            (lowpass_height * 2 > avctx->coded_height / 2 ||
+             lowpass_width  * 2 > avctx->coded_width  / 2    )
+            ) {
+            return AVERROR_INVALIDDATA;
+        }
+
+        for (i = 0; i < lowpass_height * 2; i++) {
+            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16)
+                s->dsp.horiz_filter_clip_bayer(dst, low, high, lowpass_width, s->bpc);
+            else
+                s->dsp.horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
+            if (avctx->pix_fmt == AV_PIX_FMT_GBRAP12 && act_plane == 3)
+                process_alpha(dst, lowpass_width * 2);
+            low  += lowpass_width;
+            high += lowpass_width;
+            dst  += dst_linesize;
+        }
+    } else {
+        low    = s->plane[plane].subband[0];
+        high   = s->plane[plane].subband[7];
+        output = s->plane[plane].l_h[6];
+        for (i = 0; i < lowpass_height; i++) {
+            s->dsp.horiz_filter(output, low, high, lowpass_width);
+            low    += lowpass_width;
+            high   += lowpass_width;
+            output += lowpass_width * 2;
+        }
+
+        low    = s->plane[plane].subband[8];
+        high   = s->plane[plane].subband[9];
+        output = s->plane[plane].l_h[7];
+        for (i = 0; i < lowpass_height; i++) {
+            s->dsp.horiz_filter(output, low, high, lowpass_width);
+            low    += lowpass_width;
+            high   += lowpass_width;
+            output += lowpass_width * 2;
+        }
+
+        dst  = (int16_t *)pic->data[act_plane];
+        low  = s->plane[plane].l_h[6];
+        high = s->plane[plane].l_h[7];
+        for (i = 0; i < lowpass_height; i++) {
+            interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
+            low  += lowpass_width * 2;
+            high += lowpass_width * 2;
+            dst  += pic->linesize[act_plane];
+        }
+    }
+
+    return 0;
+}
+
 static int cfhd_decode(AVCodecContext *avctx, void *data, int *got_frame,
                        AVPacket *avpkt)
 {
@@ -397,6 +527,7 @@ static int cfhd_decode(AVCodecContext *avctx, void *data, int *got_frame,
     ThreadFrame frame = { .f = data };
     AVFrame *pic = data;
     int ret = 0, i, j, planes, plane, got_buffer = 0;
+    int plane_ret[4];
     int16_t *coeff_data;
 
     s->coded_format = AV_PIX_FMT_YUV422P10;
@@ -816,223 +947,19 @@ static int cfhd_decode(AVCodecContext *avctx, void *data, int *got_frame,
         planes = 4;
     }
 
-    for (plane = 0; plane < planes && !ret; plane++) {
-        /* level 1 */
-        int lowpass_height  = s->plane[plane].band[0][0].height;
-        int lowpass_width   = s->plane[plane].band[0][0].width;
-        int highpass_stride = s->plane[plane].band[0][1].stride;
-        int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
-        ptrdiff_t dst_linesize;
-        int16_t *low, *high, *output, *dst;
-
-        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-            act_plane = 0;
-            dst_linesize = pic->linesize[act_plane];
-        } else {
-            dst_linesize = pic->linesize[act_plane] / 2;
-        }
-
-        if (lowpass_height > s->plane[plane].band[0][0].a_height || lowpass_width > s->plane[plane].band[0][0].a_width ||
-            !highpass_stride || s->plane[plane].band[0][1].width > s->plane[plane].band[0][1].a_width) {
-            av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-            ret = AVERROR(EINVAL);
-            goto end;
-        }
-
-        av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-        low    = s->plane[plane].subband[0];
-        high   = s->plane[plane].subband[2];
-        output = s->plane[plane].l_h[0];
-        for (i = 0; i < lowpass_width; i++) {
-            vert_filter(output, lowpass_width, low, lowpass_width, high, highpass_stride, lowpass_height);
-            low++;
-            high++;
-            output++;
-        }
-
-        low    = s->plane[plane].subband[1];
-        high   = s->plane[plane].subband[3];
-        output = s->plane[plane].l_h[1];
-
-        for (i = 0; i < lowpass_width; i++) {
-            // note the stride of "low" is highpass_stride
-            vert_filter(output, lowpass_width, low, highpass_stride, high, highpass_stride, lowpass_height);
-            low++;
-            high++;
-            output++;
-        }
-
-        low    = s->plane[plane].l_h[0];
-        high   = s->plane[plane].l_h[1];
-        output = s->plane[plane].subband[0];
-        for (i = 0; i < lowpass_height * 2; i++) {
-            horiz_filter(output, low, high, lowpass_width);
-            low    += lowpass_width;
-            high   += lowpass_width;
-            output += lowpass_width * 2;
-        }
-        if (s->bpc == 12) {
-            output = s->plane[plane].subband[0];
-            for (i = 0; i < lowpass_height * 2; i++) {
-                for (j = 0; j < lowpass_width * 2; j++)
-                    output[j] *= 4;
-
-                output += lowpass_width * 2;
-            }
-        }
-
-        /* level 2 */
-        lowpass_height  = s->plane[plane].band[1][1].height;
-        lowpass_width   = s->plane[plane].band[1][1].width;
-        highpass_stride = s->plane[plane].band[1][1].stride;
-
-        if (lowpass_height > s->plane[plane].band[1][1].a_height || lowpass_width > s->plane[plane].band[1][1].a_width ||
-            !highpass_stride || s->plane[plane].band[1][1].width > s->plane[plane].band[1][1].a_width) {
-            av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-            ret = AVERROR(EINVAL);
-            goto end;
-        }
-
-        av_log(avctx, AV_LOG_DEBUG, "Level 2 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-        low    = s->plane[plane].subband[0];
-        high   = s->plane[plane].subband[5];
-        output = s->plane[plane].l_h[3];
-        for (i = 0; i < lowpass_width; i++) {
-            vert_filter(output, lowpass_width, low, lowpass_width, high, highpass_stride, lowpass_height);
-            low++;
-            high++;
-            output++;
-        }
-
-        low    = s->plane[plane].subband[4];
-        high   = s->plane[plane].subband[6];
-        output = s->plane[plane].l_h[4];
-        for (i = 0; i < lowpass_width; i++) {
-            vert_filter(output, lowpass_width, low, highpass_stride, high, highpass_stride, lowpass_height);
-            low++;
-            high++;
-            output++;
-        }
-
-        low    = s->plane[plane].l_h[3];
-        high   = s->plane[plane].l_h[4];
-        output = s->plane[plane].subband[0];
-        for (i = 0; i < lowpass_height * 2; i++) {
-            horiz_filter(output, low, high, lowpass_width);
-            low    += lowpass_width;
-            high   += lowpass_width;
-            output += lowpass_width * 2;
-        }
-
-        output = s->plane[plane].subband[0];
-        for (i = 0; i < lowpass_height * 2; i++) {
-            for (j = 0; j < lowpass_width * 2; j++)
-                output[j] *= 4;
-
-            output += lowpass_width * 2;
-        }
-
-        /* level 3 */
-        lowpass_height  = s->plane[plane].band[2][1].height;
-        lowpass_width   = s->plane[plane].band[2][1].width;
-        highpass_stride = s->plane[plane].band[2][1].stride;
+    if (!s->progressive) {
+        av_log(avctx, AV_LOG_DEBUG, "interlaced frame ? %d", pic->interlaced_frame);
+        pic->interlaced_frame = 1;
+    }
 
-        if (lowpass_height > s->plane[plane].band[2][1].a_height || lowpass_width > s->plane[plane].band[2][1].a_width ||
-            !highpass_stride || s->plane[plane].band[2][1].width > s->plane[plane].band[2][1].a_width) {
-            av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-            ret = AVERROR(EINVAL);
+    avctx->execute2(avctx, reconstruct_plane, pic, plane_ret, planes);
+    for (plane = 0; plane < planes; plane++) {
+        if (plane_ret[plane] < 0) {
+            ret = plane_ret[plane];
             goto end;
         }
-
-        av_log(avctx, AV_LOG_DEBUG, "Level 3 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-        if (s->progressive) {
-            low    = s->plane[plane].subband[0];
-            high   = s->plane[plane].subband[8];
-            output = s->plane[plane].l_h[6];
-            for (i = 0; i < lowpass_width; i++) {
-                vert_filter(output, lowpass_width, low, lowpass_width, high, highpass_stride, lowpass_height);
-                low++;
-                high++;
-                output++;
-            }
-
-            low    = s->plane[plane].subband[7];
-            high   = s->plane[plane].subband[9];
-            output = s->plane[plane].l_h[7];
-            for (i = 0; i < lowpass_width; i++) {
-                vert_filter(output, lowpass_width, low, highpass_stride, high, highpass_stride, lowpass_height);
-                low++;
-                high++;
-                output++;
-            }
-
-            dst = (int16_t *)pic->data[act_plane];
-            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                if (plane & 1)
-                    dst++;
-                if (plane > 1)
-                    dst += pic->linesize[act_plane] >> 1;
-            }
-            low  = s->plane[plane].l_h[6];
-            high = s->plane[plane].l_h[7];
-
-            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
-                (lowpass_height * 2 > avctx->coded_height / 2 ||
-                 lowpass_width  * 2 > avctx->coded_width  / 2    )
-                ) {
-                ret = AVERROR_INVALIDDATA;
-                goto end;
-            }
-
-            for (i = 0; i < lowpass_height * 2; i++) {
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16)
-                    horiz_filter_clip_bayer(dst, low, high, lowpass_width, s->bpc);
-                else
-                    horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
-                if (avctx->pix_fmt == AV_PIX_FMT_GBRAP12 && act_plane == 3)
-                    process_alpha(dst, lowpass_width * 2);
-                low  += lowpass_width;
-                high += lowpass_width;
-                dst  += dst_linesize;
-            }
-        } else {
-            av_log(avctx, AV_LOG_DEBUG, "interlaced frame ? %d", pic->interlaced_frame);
-            pic->interlaced_frame = 1;
-            low    = s->plane[plane].subband[0];
-            high   = s->plane[plane].subband[7];
-            output = s->plane[plane].l_h[6];
-            for (i = 0; i < lowpass_height; i++) {
-                horiz_filter(output, low, high, lowpass_width);
-                low    += lowpass_width;
-                high   += lowpass_width;
-                output += lowpass_width * 2;
-            }
-
-            low    = s->plane[plane].subband[8];
-            high   = s->plane[plane].subband[9];
-            output = s->plane[plane].l_h[7];
-            for (i = 0; i < lowpass_height; i++) {
-                horiz_filter(output, low, high, lowpass_width);
-                low    += lowpass_width;
-                high   += lowpass_width;
-                output += lowpass_width * 2;
-            }
-
-            dst  = (int16_t *)pic->data[act_plane];
-            low  = s->plane[plane].l_h[6];
-            high = s->plane[plane].l_h[7];
-            for (i = 0; i < lowpass_height; i++) {
-                interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
-                low  += lowpass_width * 2;
-                high += lowpass_width * 2;
-                dst  += pic->linesize[act_plane];
-            }
-        }
     }
 
-
     if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16)
         process_bayer(pic);
 end:
@@ -1064,6 +991,7 @@ AVCodec ff_cfhd_decoder = {
     .init             = cfhd_init,
     .close            = cfhd_close,
     .decode           = cfhd_decode,
-    .capabilities     = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
+    .capabilities     = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                        AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal    = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_INIT_CLEANUP,
 };
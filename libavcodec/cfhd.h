@@ -27,6 +27,7 @@
 
 #include "avcodec.h"
 #include "bytestream.h"
+#include "cfhddsp.h"
 #include "get_bits.h"
 #include "vlc.h"
 
@@ -114,6 +115,8 @@ typedef struct CFHDContext {
     uint8_t prescale_shift[3];
     Plane plane[4];
     Peak peak;
+
+    CFHDDSPContext dsp;
 } CFHDContext;
 
 int ff_cfhd_init_vlcs(CFHDContext *s);
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2015-2016 Kieran Kunhya <kieran@kunhya.com>
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+
+#include "cfhddsp.h"
+
+static inline void filter(int16_t *output, ptrdiff_t out_stride,
+                          const int16_t *low, ptrdiff_t low_stride,
+                          const int16_t *high, ptrdiff_t high_stride,
+                          int len, int clip)
+{
+    int16_t tmp;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        if (i == 0) {
+            tmp = (11*low[0*low_stride] - 4*low[1*low_stride] + low[2*low_stride] + 4) >> 3;
+            output[(2*i+0)*out_stride] = (tmp + high[0*high_stride]) >> 1;
+            if (clip)
+                output[(2*i+0)*out_stride] = av_clip_uintp2_c(output[(2*i+0)*out_stride], clip);
+
+            tmp = ( 5*low[0*low_stride] + 4*low[1*low_stride] - low[2*low_stride] + 4) >> 3;
+            output[(2*i+1)*out_stride] = (tmp - high[0*high_stride]) >> 1;
+            if (clip)
+                output[(2*i+1)*out_stride] = av_clip_uintp2_c(output[(2*i+1)*out_stride], clip);
+        } else if (i == len-1) {
+            tmp = ( 5*low[i*low_stride] + 4*low[(i-1)*low_stride] - low[(i-2)*low_stride] + 4) >> 3;
+            output[(2*i+0)*out_stride] = (tmp + high[i*high_stride]) >> 1;
+            if (clip)
+                output[(2*i+0)*out_stride] = av_clip_uintp2_c(output[(2*i+0)*out_stride], clip);
+
+            tmp = (11*low[i*low_stride] - 4*low[(i-1)*low_stride] + low[(i-2)*low_stride] + 4) >> 3;
+            output[(2*i+1)*out_stride] = (tmp - high[i*high_stride]) >> 1;
+            if (clip)
+                output[(2*i+1)*out_stride] = av_clip_uintp2_c(output[(2*i+1)*out_stride], clip);
+        } else {
+            tmp = (low[(i-1)*low_stride] - low[(i+1)*low_stride] + 4) >> 3;
+            output[(2*i+0)*out_stride] = (tmp + low[i*low_stride] + high[i*high_stride]) >> 1;
+            if (clip)
+                output[(2*i+0)*out_stride] = av_clip_uintp2_c(output[(2*i+0)*out_stride], clip);
+
+            tmp = (low[(i+1)*low_stride] - low[(i-1)*low_stride] + 4) >> 3;
+            output[(2*i+1)*out_stride] = (tmp + low[i*low_stride] - high[i*high_stride]) >> 1;
+            if (clip)
+                output[(2*i+1)*out_stride] = av_clip_uintp2_c(output[(2*i+1)*out_stride], clip);
+        }
+    }
+}
+
+static void horiz_filter(int16_t *output, const int16_t *low,
+                         const int16_t *high, int width)
+{
+    filter(output, 1, low, 1, high, 1, width, 0);
+}
+
+static void horiz_filter_clip(int16_t *output, const int16_t *low,
+                              const int16_t *high, int width, int clip)
+{
+    filter(output, 1, low, 1, high, 1, width, clip);
+}
+
+static void horiz_filter_clip_bayer(int16_t *output, const int16_t *low,
+                                    const int16_t *high, int width, int clip)
+{
+    filter(output, 2, low, 1, high, 1, width, clip);
+}
+
+/* Same as filter() applied to each column, but walks the rows so that
+ * all memory accesses are contiguous. */
+static void vert_filter(int16_t *output, ptrdiff_t out_stride,
+                        const int16_t *low, ptrdiff_t low_stride,
+                        const int16_t *high, ptrdiff_t high_stride,
+                        int width, int height)
+{
+    int16_t tmp;
+    int i, x;
+
+    for (i = 0; i < height; i++) {
+        int16_t *out0 = output + 2 * i * out_stride;
+        int16_t *out1 = out0 + out_stride;
+        const int16_t *l = low  + i * low_stride;
+        const int16_t *h = high + i * high_stride;
+
+        if (i == 0) {
+            for (x = 0; x < width; x++) {
+                tmp = (11*l[x] - 4*l[x + low_stride] + l[x + 2*low_stride] + 4) >> 3;
+                out0[x] = (tmp + h[x]) >> 1;
+                tmp = ( 5*l[x] + 4*l[x + low_stride] - l[x + 2*low_stride] + 4) >> 3;
+                out1[x] = (tmp - h[x]) >> 1;
+            }
+        } else if (i == height - 1) {
+            for (x = 0; x < width; x++) {
+                tmp = ( 5*l[x] + 4*l[x - low_stride] - l[x - 2*low_stride] + 4) >> 3;
+                out0[x] = (tmp + h[x]) >> 1;
+                tmp = (11*l[x] - 4*l[x - low_stride] + l[x - 2*low_stride] + 4) >> 3;
+                out1[x] = (tmp - h[x]) >> 1;
+            }
+        } else {
+            for (x = 0; x < width; x++) {
+                tmp = (l[x - low_stride] - l[x + low_stride] + 4) >> 3;
+                out0[x] = (tmp + l[x] + h[x]) >> 1;
+                tmp = (l[x + low_stride] - l[x - low_stride] + 4) >> 3;
+                out1[x] = (tmp + l[x] - h[x]) >> 1;
+            }
+        }
+    }
+}
+
+av_cold void ff_cfhddsp_init(CFHDDSPContext *c)
+{
+    c->horiz_filter            = horiz_filter;
+    c->horiz_filter_clip       = horiz_filter_clip;
+    c->horiz_filter_clip_bayer = horiz_filter_clip_bayer;
+    c->vert_filter             = vert_filter;
+
+    if (ARCH_X86)
+        ff_cfhddsp_init_x86(c);
+}
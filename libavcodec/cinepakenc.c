@@ -114,6 +114,7 @@ typedef struct CinepakEncContext {
     int frame_buf_size;
     int curframe, keyint;
     AVLFG randctx;
+    ELBGThreadContext *elbg_threads;
     uint64_t lambda;
     int *codebook_input;
     int *codebook_closest;
@@ -154,7 +155,7 @@ static const AVClass cinepak_class = {
 static av_cold int cinepak_encode_init(AVCodecContext *avctx)
 {
     CinepakEncContext *s = avctx->priv_data;
-    int x, mb_count, strip_buf_size, frame_buf_size;
+    int x, mb_count, strip_buf_size, frame_buf_size, ret = AVERROR(ENOMEM);
 
     if (avctx->width & 3 || avctx->height & 3) {
         av_log(avctx, AV_LOG_ERROR, "width and height must be multiples of four (got %ix%i)\n",
@@ -171,22 +172,22 @@ static av_cold int cinepak_encode_init(AVCodecContext *avctx)
     if (!(s->last_frame = av_frame_alloc()))
         return AVERROR(ENOMEM);
     if (!(s->best_frame = av_frame_alloc()))
-        goto enomem;
+        goto fail;
     if (!(s->scratch_frame = av_frame_alloc()))
-        goto enomem;
+        goto fail;
     if (avctx->pix_fmt == AV_PIX_FMT_RGB24)
         if (!(s->input_frame = av_frame_alloc()))
-            goto enomem;
+            goto fail;
 
     if (!(s->codebook_input = av_malloc_array((avctx->pix_fmt == AV_PIX_FMT_RGB24 ? 6 : 4) * (avctx->width * avctx->height) >> 2, sizeof(*s->codebook_input))))
-        goto enomem;
+        goto fail;
 
     if (!(s->codebook_closest = av_malloc_array((avctx->width * avctx->height) >> 2, sizeof(*s->codebook_closest))))
-        goto enomem;
+        goto fail;
 
     for (x = 0; x < (avctx->pix_fmt == AV_PIX_FMT_RGB24 ? 4 : 3); x++)
         if (!(s->pict_bufs[x] = av_malloc((avctx->pix_fmt == AV_PIX_FMT_RGB24 ? 6 : 4) * (avctx->width * avctx->height) >> 2)))
-            goto enomem;
+            goto fail;
 
     mb_count = avctx->width * avctx->height / MB_AREA;
 
@@ -199,13 +200,16 @@ static av_cold int cinepak_encode_init(AVCodecContext *avctx)
     frame_buf_size = CVID_HEADER_SIZE + s->max_max_strips * strip_buf_size;
 
     if (!(s->strip_buf = av_malloc(strip_buf_size)))
-        goto enomem;
+        goto fail;
 
     if (!(s->frame_buf = av_malloc(frame_buf_size)))
-        goto enomem;
+        goto fail;
 
     if (!(s->mb = av_malloc_array(mb_count, sizeof(mb_info))))
-        goto enomem;
+        goto fail;
+
+    if ((ret = avpriv_elbg_thread_alloc(&s->elbg_threads, avctx->thread_count)) < 0)
+        goto fail;
 
     av_lfg_init(&s->randctx, 1);
     s->avctx          = avctx;
@@ -253,7 +257,7 @@ static av_cold int cinepak_encode_init(AVCodecContext *avctx)
 
     return 0;
 
-enomem:
+fail:
     av_frame_free(&s->last_frame);
     av_frame_free(&s->best_frame);
     av_frame_free(&s->scratch_frame);
@@ -268,7 +272,7 @@ enomem:
     for (x = 0; x < (avctx->pix_fmt == AV_PIX_FMT_RGB24 ? 4 : 3); x++)
         av_freep(&s->pict_bufs[x]);
 
-    return AVERROR(ENOMEM);
+    return ret;
 }
 
 static int64_t calculate_mode_score(CinepakEncContext *s, int h,
@@ -716,7 +720,7 @@ static int quantize(CinepakEncContext *s, int h, uint8_t *data[4],
                     int linesize[4], int v1mode, strip_info *info,
                     mb_encoding encoding)
 {
-    int x, y, i, j, k, x2, y2, x3, y3, plane, shift, mbn;
+    int x, y, i, j, k, x2, y2, x3, y3, plane, shift, mbn, ret;
     int entry_size      = s->pix_fmt == AV_PIX_FMT_RGB24 ? 6 : 4;
     int *codebook       = v1mode ? info->v1_codebook : info->v4_codebook;
     int size            = v1mode ? info->v1_size : info->v4_size;
@@ -777,8 +781,9 @@ static int quantize(CinepakEncContext *s, int h, uint8_t *data[4],
     if (i < size)
         size = i;
 
-    avpriv_init_elbg(s->codebook_input, entry_size, i, codebook, size, 1, s->codebook_closest, &s->randctx);
-    avpriv_do_elbg(s->codebook_input, entry_size, i, codebook, size, 1, s->codebook_closest, &s->randctx);
+    if ((ret = avpriv_init_elbg2(s->elbg_threads, s->codebook_input, entry_size, i, codebook, size, 1, s->codebook_closest, &s->randctx)) < 0 ||
+        (ret = avpriv_do_elbg2(s->elbg_threads, s->codebook_input, entry_size, i, codebook, size, 1, s->codebook_closest, &s->randctx)) < 0)
+        return ret;
 
     // set up vq_data, which contains a single MB
     vq_data[0]     = vq_pict_buf;
@@ -905,6 +910,8 @@ static int rd_strip(CinepakEncContext *s, int y, int h, int keyframe,
                     // the size may shrink even before optimizations if the input is short:
                     info.v1_size = quantize(s, h, data, linesize, 1,
                                             &info, ENC_UNCERTAIN);
+                    if (info.v1_size < 0)
+                        return info.v1_size;
                     if (info.v1_size < v1_size)
                         // too few eligible blocks, no sense in trying bigger sizes
                         v1enough = 1;
@@ -919,6 +926,8 @@ static int rd_strip(CinepakEncContext *s, int y, int h, int keyframe,
                         info.v4_size = v4_size;
                         info.v4_size = quantize(s, h, data, linesize, 0,
                                                 &info, ENC_UNCERTAIN);
+                        if (info.v4_size < 0)
+                            return info.v4_size;
                         if (info.v4_size < v4_size)
                             // too few eligible blocks, no sense in trying bigger sizes
                             v4enough = 1;
@@ -936,11 +945,15 @@ static int rd_strip(CinepakEncContext *s, int y, int h, int keyframe,
                     // we assume we _may_ come here with more blocks to encode than before
                     info.v1_size = v1_size;
                     new_v1_size = quantize(s, h, data, linesize, 1, &info, ENC_V1);
+                    if (new_v1_size < 0)
+                        return new_v1_size;
                     if (new_v1_size < info.v1_size)
                         info.v1_size = new_v1_size;
                     // we assume we _may_ come here with more blocks to encode than before
                     info.v4_size = v4_size;
                     new_v4_size = quantize(s, h, data, linesize, 0, &info, ENC_V4);
+                    if (new_v4_size < 0)
+                        return new_v4_size;
                     if (new_v4_size < info.v4_size)
                         info.v4_size = new_v4_size;
                     // calculate the resulting score
@@ -957,12 +970,16 @@ static int rd_strip(CinepakEncContext *s, int y, int h, int keyframe,
                         if (v1shrunk) {
                             info.v1_size = v1_size;
                             new_v1_size = quantize(s, h, data, linesize, 1, &info, ENC_V1);
+                            if (new_v1_size < 0)
+                                return new_v1_size;
                             if (new_v1_size < info.v1_size)
                                 info.v1_size = new_v1_size;
                         }
                         if (v4shrunk) {
                             info.v4_size = v4_size;
                             new_v4_size = quantize(s, h, data, linesize, 0, &info, ENC_V4);
+                            if (new_v4_size < 0)
+                                return new_v4_size;
                             if (new_v4_size < info.v4_size)
                                 info.v4_size = new_v4_size;
                         }
@@ -1160,6 +1177,8 @@ static int cinepak_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     if ((ret = ff_alloc_packet2(avctx, pkt, s->frame_buf_size, 0)) < 0)
         return ret;
     ret       = rd_frame(s, frame, (s->curframe == 0), pkt->data, s->frame_buf_size);
+    if (ret < 0)
+        return ret;
     pkt->size = ret;
     if (s->curframe == 0)
         pkt->flags |= AV_PKT_FLAG_KEY;
@@ -1188,6 +1207,7 @@ static av_cold int cinepak_encode_end(AVCodecContext *avctx)
     av_freep(&s->strip_buf);
     av_freep(&s->frame_buf);
     av_freep(&s->mb);
+    avpriv_elbg_thread_free(&s->elbg_threads);
 
     for (x = 0; x < (avctx->pix_fmt == AV_PIX_FMT_RGB24 ? 4 : 3); x++)
         av_freep(&s->pict_bufs[x]);
@@ -1204,6 +1224,7 @@ AVCodec ff_cinepak_encoder = {
     .init           = cinepak_encode_init,
     .encode2        = cinepak_encode_frame,
     .close          = cinepak_encode_end,
+    .capabilities   = AV_CODEC_CAP_AUTO_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]) { AV_PIX_FMT_RGB24, AV_PIX_FMT_GRAY8, AV_PIX_FMT_NONE },
     .priv_class     = &cinepak_class,
 };
@@ -599,7 +599,7 @@ int attribute_align_arg avcodec_send_packet(AVCodecContext *avctx, const AVPacke
 
     av_packet_unref(avci->buffer_pkt);
     if (avpkt && (avpkt->data || avpkt->side_data_elems)) {
-        ret = av_packet_ref(avci->buffer_pkt, avpkt);
+        ret = avpriv_packet_pool_ref(avci->packet_pool, avci->buffer_pkt, avpkt);
         if (ret < 0)
             return ret;
     }
@@ -28,10 +28,13 @@
 #include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/slicethread.h"
 #include "elbg.h"
 #include "avcodec.h"
 
 #define DELTA_ERR_MAX 0.1  ///< Precision of the ELBG algorithm (as percentage error)
+#define MIN_POINTS_PER_JOB 256  ///< Below this, the search is not worth splitting
 
 /**
  * In the ELBG jargon, a cell is the set of points that are closest to a
@@ -58,10 +61,35 @@ typedef struct elbg_data {
     int *scratchbuf;
 } elbg_data;
 
-static inline int distance_limited(int *a, int *b, int dim, int limit)
+struct ELBGThreadContext {
+    AVSliceThread *slicethread;
+    int nb_threads;
+
+    /* search of the current step */
+    const int *points;
+    const int *codebook;
+    int dim;
+    int numpoints;
+    int numCB;
+    int first_idx;
+    int *nearest_cb;
+    int *dist_cb;
+};
+
+static inline int distance_limited(const int *a, const int *b, int dim, int limit)
 {
     int i, dist=0;
-    for (i=0; i<dim; i++) {
+    /* The partial sums only grow, so checking the limit every 4 terms gives
+     * the same result and lets the compiler vectorize the groups. */
+    for (i=0; i + 3 < dim; i += 4) {
+        dist += (a[i    ] - b[i    ])*(a[i    ] - b[i    ]) +
+                (a[i + 1] - b[i + 1])*(a[i + 1] - b[i + 1]) +
+                (a[i + 2] - b[i + 2])*(a[i + 2] - b[i + 2]) +
+                (a[i + 3] - b[i + 3])*(a[i + 3] - b[i + 3]);
+        if (dist > limit)
+            return INT_MAX;
+    }
+    for (; i<dim; i++) {
         dist += (a[i] - b[i])*(a[i] - b[i]);
         if (dist > limit)
             return INT_MAX;
@@ -70,6 +98,123 @@ static inline int distance_limited(int *a, int *b, int dim, int limit)
     return dist;
 }
 
+/**
+ * Find the codebook entry closest to point, starting the search from the
+ * entry start. Ties are resolved in favour of start, then of the lowest
+ * index, so the result only depends on start.
+ */
+static inline int find_nearest_cb(const int *point, const int *codebook,
+                                  int dim, int numCB, int start, int *pdist)
+{
+    int k, dist, best_idx = start;
+    int best_dist = distance_limited(point, codebook + start*dim, dim, INT_MAX);
+
+    for (k=0; k < numCB && best_dist; k++) {
+        dist = distance_limited(point, codebook + k*dim, dim, best_dist);
+        if (dist < best_dist) {
+            best_dist = dist;
+            best_idx = k;
+        }
+    }
+    *pdist = best_dist;
+
+    return best_idx;
+}
+
+static void search_worker(void *priv, int jobnr, int threadnr,
+                          int nb_jobs, int nb_threads)
+{
+    ELBGThreadContext *ctx = priv;
+    int i   = (int64_t)ctx->numpoints *  jobnr      / nb_jobs;
+    int end = (int64_t)ctx->numpoints * (jobnr + 1) / nb_jobs;
+    int idx = jobnr ? 0 : ctx->first_idx;
+
+    for (; i < end; i++) {
+        idx = find_nearest_cb(ctx->points + i*ctx->dim, ctx->codebook, ctx->dim,
+                              ctx->numCB, idx, &ctx->dist_cb[i]);
+        ctx->nearest_cb[i] = idx;
+    }
+}
+
+/**
+ * Assign each point to its closest codebook entry on the worker threads.
+ *
+ * The search for a point starts from the entry of the previous point, which
+ * decides ties. All jobs but the first guess that entry, so their first
+ * points are searched again here with the actual one. This goes on until the
+ * result no longer changes, from which point the job's results are the
+ * serial ones.
+ */
+static void search_threaded(ELBGThreadContext *ctx, const int *points, int dim,
+                            int numpoints, const int *codebook, int numCB,
+                            int first_idx, int *nearest_cb, int *dist_cb)
+{
+    int nb_jobs = FFMIN(ctx->nb_threads, numpoints / MIN_POINTS_PER_JOB);
+    int j;
+
+    ctx->points     = points;
+    ctx->codebook   = codebook;
+    ctx->dim        = dim;
+    ctx->numpoints  = numpoints;
+    ctx->numCB      = numCB;
+    ctx->first_idx  = first_idx;
+    ctx->nearest_cb = nearest_cb;
+    ctx->dist_cb    = dist_cb;
+
+    avpriv_slicethread_execute(ctx->slicethread, nb_jobs, 0);
+
+    for (j = 1; j < nb_jobs; j++) {
+        int i   = (int64_t)numpoints *  j      / nb_jobs;
+        int end = (int64_t)numpoints * (j + 1) / nb_jobs;
+        int idx = nearest_cb[i - 1];
+
+        if (!idx) // the job guessed right
+            continue;
+        for (; i < end; i++) {
+            int dist;
+            idx = find_nearest_cb(points + i*dim, codebook, dim, numCB, idx, &dist);
+            if (idx == nearest_cb[i])
+                break;
+            nearest_cb[i] = idx;
+            dist_cb[i]    = dist;
+        }
+    }
+}
+
+int avpriv_elbg_thread_alloc(ELBGThreadContext **pctx, int nb_threads)
+{
+    ELBGThreadContext *ctx;
+    int ret;
+
+    *pctx = NULL;
+    if (nb_threads == 1)
+        return 1;
+
+    ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+
+    ret = avpriv_slicethread_create(&ctx->slicethread, ctx, search_worker,
+                                    NULL, nb_threads);
+    if (ret <= 1) {
+        avpriv_slicethread_free(&ctx->slicethread);
+        av_free(ctx);
+        return ret == AVERROR(ENOSYS) ? 1 : ret;
+    }
+    ctx->nb_threads = ret;
+    *pctx = ctx;
+
+    return ret;
+}
+
+void avpriv_elbg_thread_free(ELBGThreadContext **pctx)
+{
+    if (!*pctx)
+        return;
+    avpriv_slicethread_free(&(*pctx)->slicethread);
+    av_freep(pctx);
+}
+
 static inline void vect_division(int *res, int *vect, int div, int dim)
 {
     int i;
@@ -337,6 +482,14 @@ static void do_shiftings(elbg_data *elbg)
 int avpriv_init_elbg(int *points, int dim, int numpoints, int *codebook,
                  int numCB, int max_steps, int *closest_cb,
                  AVLFG *rand_state)
+{
+    return avpriv_init_elbg2(NULL, points, dim, numpoints, codebook, numCB,
+                             max_steps, closest_cb, rand_state);
+}
+
+int avpriv_init_elbg2(ELBGThreadContext *ctx, int *points, int dim,
+                      int numpoints, int *codebook, int numCB, int max_steps,
+                      int *closest_cb, AVLFG *rand_state)
 {
     int i, k, ret = 0;
 
@@ -351,14 +504,14 @@ int avpriv_init_elbg(int *points, int dim, int numpoints, int *codebook,
             memcpy(temp_points + i*dim, points + k*dim, dim*sizeof(int));
         }
 
-        ret = avpriv_init_elbg(temp_points, dim, numpoints / 8, codebook,
-                               numCB, 2 * max_steps, closest_cb, rand_state);
+        ret = avpriv_init_elbg2(ctx, temp_points, dim, numpoints / 8, codebook,
+                                numCB, 2 * max_steps, closest_cb, rand_state);
         if (ret < 0) {
             av_freep(&temp_points);
             return ret;
         }
-        ret = avpriv_do_elbg(temp_points, dim, numpoints / 8, codebook,
-                             numCB, 2 * max_steps, closest_cb, rand_state);
+        ret = avpriv_do_elbg2(ctx, temp_points, dim, numpoints / 8, codebook,
+                              numCB, 2 * max_steps, closest_cb, rand_state);
         av_free(temp_points);
 
     } else  // If not, initialize the codebook with random positions
@@ -372,15 +525,22 @@ int avpriv_do_elbg(int *points, int dim, int numpoints, int *codebook,
                 int numCB, int max_steps, int *closest_cb,
                 AVLFG *rand_state)
 {
-    int dist;
+    return avpriv_do_elbg2(NULL, points, dim, numpoints, codebook, numCB,
+                           max_steps, closest_cb, rand_state);
+}
+
+int avpriv_do_elbg2(ELBGThreadContext *ctx, int *points, int dim,
+                    int numpoints, int *codebook, int numCB, int max_steps,
+                    int *closest_cb, AVLFG *rand_state)
+{
     elbg_data elbg_d;
     elbg_data *elbg = &elbg_d;
-    int i, j, k, last_error, steps = 0, ret = 0;
+    int i, j, last_error, steps = 0, ret = 0;
     int *dist_cb = av_malloc_array(numpoints, sizeof(int));
     int *size_part = av_malloc_array(numCB, sizeof(int));
     cell *list_buffer = av_malloc_array(numpoints, sizeof(cell));
     cell *free_cells;
-    int best_dist, best_idx = 0;
+    int best_idx = 0;
 
     elbg->error = INT_MAX;
     elbg->dim = dim;
@@ -412,17 +572,19 @@ int avpriv_do_elbg(int *points, int dim, int numpoints, int *codebook,
 
         /* This loop evaluate the actual Voronoi partition. It is the most
            costly part of the algorithm. */
-        for (i=0; i < numpoints; i++) {
-            best_dist = distance_limited(elbg->points + i*elbg->dim, elbg->codebook + best_idx*elbg->dim, dim, INT_MAX);
-            for (k=0; k < elbg->numCB; k++) {
-                dist = distance_limited(elbg->points + i*elbg->dim, elbg->codebook + k*elbg->dim, dim, best_dist);
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    best_idx = k;
-                }
+        if (ctx && numpoints >= 2 * MIN_POINTS_PER_JOB) {
+            search_threaded(ctx, elbg->points, dim, numpoints, elbg->codebook,
+                            numCB, best_idx, elbg->nearest_cb, dist_cb);
+            best_idx = elbg->nearest_cb[numpoints - 1];
+        } else {
+            for (i=0; i < numpoints; i++) {
+                best_idx = find_nearest_cb(elbg->points + i*dim, elbg->codebook,
+                                           dim, numCB, best_idx, &dist_cb[i]);
+                elbg->nearest_cb[i] = best_idx;
             }
-            elbg->nearest_cb[i] = best_idx;
-            dist_cb[i] = best_dist;
+        }
+
+        for (i=0; i < numpoints; i++) {
             elbg->error += dist_cb[i];
             elbg->utility[elbg->nearest_cb[i]] += dist_cb[i];
             free_cells->index = i;
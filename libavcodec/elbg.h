@@ -54,4 +54,36 @@ int avpriv_init_elbg(int *points, int dim, int numpoints, int *codebook,
                  int numCB, int num_steps, int *closest_cb,
                  AVLFG *rand_state);
 
+/**
+ * Worker threads for the nearest codebook search of the ELBG functions.
+ * The results do not depend on the number of threads.
+ */
+typedef struct ELBGThreadContext ELBGThreadContext;
+
+/**
+ * Allocate an ELBGThreadContext.
+ * @param nb_threads number of threads, 0 for automatic
+ * @return < 0 in case of error, the number of threads otherwise;
+ *         *ctx is left NULL if only one thread would be used
+ */
+int avpriv_elbg_thread_alloc(ELBGThreadContext **ctx, int nb_threads);
+
+void avpriv_elbg_thread_free(ELBGThreadContext **ctx);
+
+/**
+ * Same as avpriv_do_elbg(), with the search spread over the threads of ctx,
+ * which may be NULL.
+ */
+int avpriv_do_elbg2(ELBGThreadContext *ctx, int *points, int dim,
+                    int numpoints, int *codebook, int numCB, int num_steps,
+                    int *closest_cb, AVLFG *rand_state);
+
+/**
+ * Same as avpriv_init_elbg(), with the search spread over the threads of ctx,
+ * which may be NULL.
+ */
+int avpriv_init_elbg2(ELBGThreadContext *ctx, int *points, int dim,
+                      int numpoints, int *codebook, int numCB, int num_steps,
+                      int *closest_cb, AVLFG *rand_state);
+
 #endif /* AVCODEC_ELBG_H */
@@ -166,7 +166,7 @@ static int encode_simple_internal(AVCodecContext *avctx, AVPacket *avpkt)
 
     if (!ret && got_packet) {
         if (avpkt->data) {
-            ret = av_packet_make_refcounted(avpkt);
+            ret = avpriv_packet_pool_make_refcounted(avci->packet_pool, avpkt);
             if (ret < 0)
                 goto end;
         }
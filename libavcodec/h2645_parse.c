@@ -26,11 +26,35 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 
-#include "bytestream.h"
 #include "hevc.h"
 #include "h264.h"
 #include "h2645_parse.h"
 
+/**
+ * Find the first position i >= start with src[i] == src[i + 1] == 0 and
+ * src[i + 2] <= 3, which starts an emulation prevention sequence or a
+ * start code. Zero bytes are located with memchr(), which libc implements
+ * with wide vector loads.
+ *
+ * @return that position, or length if there is none
+ */
+static int find_escape_candidate(const uint8_t *src, int start, int length)
+{
+    int i = start;
+
+    while (i + 2 < length) {
+        const uint8_t *zero = memchr(src + i, 0, length - 2 - i);
+
+        if (!zero)
+            break;
+        i = zero - src;
+        if (!src[i + 1] && src[i + 2] <= 3)
+            return i;
+        i += 1 + !!src[i + 1];
+    }
+    return length;
+}
+
 int ff_h2645_extract_rbsp(const uint8_t *src, int length,
                           H2645RBSP *rbsp, H2645NAL *nal, int small_padding)
 {
@@ -38,50 +62,12 @@ int ff_h2645_extract_rbsp(const uint8_t *src, int length,
     uint8_t *dst;
 
     nal->skipped_bytes = 0;
-#define STARTCODE_TEST                                                  \
-        if (i + 2 < length && src[i + 1] == 0 && src[i + 2] <= 3) {     \
-            if (src[i + 2] != 3 && src[i + 2] != 0) {                   \
-                /* startcode, so we must be past the end */             \
-                length = i;                                             \
-            }                                                           \
-            break;                                                      \
-        }
-#if HAVE_FAST_UNALIGNED
-#define FIND_FIRST_ZERO                                                 \
-        if (i > 0 && !src[i])                                           \
-            i--;                                                        \
-        while (src[i])                                                  \
-            i++
-#if HAVE_FAST_64BIT
-    for (i = 0; i + 1 < length; i += 9) {
-        if (!((~AV_RN64(src + i) &
-               (AV_RN64(src + i) - 0x0100010001000101ULL)) &
-              0x8000800080008080ULL))
-            continue;
-        FIND_FIRST_ZERO;
-        STARTCODE_TEST;
-        i -= 7;
-    }
-#else
-    for (i = 0; i + 1 < length; i += 5) {
-        if (!((~AV_RN32(src + i) &
-               (AV_RN32(src + i) - 0x01000101U)) &
-              0x80008080U))
-            continue;
-        FIND_FIRST_ZERO;
-        STARTCODE_TEST;
-        i -= 3;
-    }
-#endif /* HAVE_FAST_64BIT */
-#else
-    for (i = 0; i + 1 < length; i += 2) {
-        if (src[i])
-            continue;
-        if (i > 0 && src[i - 1] == 0)
-            i--;
-        STARTCODE_TEST;
+
+    i = find_escape_candidate(src, 0, length);
+    if (i < length && src[i + 2] != 3 && src[i + 2] != 0) {
+        /* startcode, so we must be past the end */
+        length = i;
     }
-#endif /* HAVE_FAST_UNALIGNED */
 
     if (i >= length - 1 && small_padding) { // no escaped 0
         nal->data     =
@@ -89,8 +75,7 @@ int ff_h2645_extract_rbsp(const uint8_t *src, int length,
         nal->size     =
         nal->raw_size = length;
         return length;
-    } else if (i > length)
-        i = length;
+    }
 
     nal->rbsp_buffer = &rbsp->rbsp_buffer[rbsp->rbsp_buffer_size];
     dst = nal->rbsp_buffer;
@@ -98,38 +83,41 @@ int ff_h2645_extract_rbsp(const uint8_t *src, int length,
     memcpy(dst, src, i);
     si = di = i;
     while (si + 2 < length) {
-        // remove escapes (very rare 1:2^22)
-        if (src[si + 2] > 3) {
-            dst[di++] = src[si++];
-            dst[di++] = src[si++];
-        } else if (src[si] == 0 && src[si + 1] == 0 && src[si + 2] != 0) {
-            if (src[si + 2] == 3) { // escape
-                dst[di++] = 0;
-                dst[di++] = 0;
-                si       += 3;
-
-                if (nal->skipped_bytes_pos) {
-                    nal->skipped_bytes++;
-                    if (nal->skipped_bytes_pos_size < nal->skipped_bytes) {
-                        nal->skipped_bytes_pos_size *= 2;
-                        av_assert0(nal->skipped_bytes_pos_size >= nal->skipped_bytes);
-                        av_reallocp_array(&nal->skipped_bytes_pos,
-                                nal->skipped_bytes_pos_size,
-                                sizeof(*nal->skipped_bytes_pos));
-                        if (!nal->skipped_bytes_pos) {
-                            nal->skipped_bytes_pos_size = 0;
-                            return AVERROR(ENOMEM);
-                        }
+        int next;
+
+        /* src + si is an escape candidate, see find_escape_candidate() */
+        if (src[si + 2] == 3) { // escape
+            dst[di++] = 0;
+            dst[di++] = 0;
+            si       += 3;
+
+            if (nal->skipped_bytes_pos) {
+                nal->skipped_bytes++;
+                if (nal->skipped_bytes_pos_size < nal->skipped_bytes) {
+                    nal->skipped_bytes_pos_size *= 2;
+                    av_assert0(nal->skipped_bytes_pos_size >= nal->skipped_bytes);
+                    av_reallocp_array(&nal->skipped_bytes_pos,
+                            nal->skipped_bytes_pos_size,
+                            sizeof(*nal->skipped_bytes_pos));
+                    if (!nal->skipped_bytes_pos) {
+                        nal->skipped_bytes_pos_size = 0;
+                        return AVERROR(ENOMEM);
                     }
-                    if (nal->skipped_bytes_pos)
-                        nal->skipped_bytes_pos[nal->skipped_bytes-1] = di - 1;
                 }
-                continue;
-            } else // next start code
-                goto nsc;
+                if (nal->skipped_bytes_pos)
+                    nal->skipped_bytes_pos[nal->skipped_bytes-1] = di - 1;
+            }
+        } else if (src[si + 2]) { // next start code
+            goto nsc;
+        } else {
+            dst[di++] = src[si++];
         }
 
-        dst[di++] = src[si++];
+        // copy everything up to the next candidate (very rare 1:2^22)
+        next = find_escape_candidate(src, si, length);
+        memcpy(dst + di, src + si, next - si);
+        di += next - si;
+        si  = next;
     }
     while (si < length)
         dst[di++] = src[si++];
@@ -329,13 +317,20 @@ static int h264_parse_nal_header(H2645NAL *nal, void *logctx)
 
 static int find_next_start_code(const uint8_t *buf, const uint8_t *next_avc)
 {
-    int i = 0;
+    int i = 0, end = next_avc - buf - 3;
 
-    if (buf + 3 >= next_avc)
+    if (end <= 0)
         return next_avc - buf;
 
-    while (buf + i + 3 < next_avc) {
-        if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1)
+    while (i < end) {
+        const uint8_t *zero = memchr(buf + i, 0, end - i);
+
+        if (!zero) {
+            i = end;
+            break;
+        }
+        i = zero - buf;
+        if (buf[i + 1] == 0 && buf[i + 2] == 1)
             break;
         i++;
     }
@@ -389,16 +384,80 @@ fail:
     return;
 }
 
+void ff_h2645_nal_walk_init(H2645NALWalker *w, const uint8_t *buf, int length,
+                            int is_nalff, int nal_length_size, void *logctx)
+{
+    w->buf             = buf;
+    w->length          = length;
+    w->pos             = 0;
+    w->next_avc        = is_nalff ? 0 : length;
+    w->nal_length_size = nal_length_size;
+    w->no_start_code   = 0;
+    w->logctx          = logctx;
+}
+
+int ff_h2645_nal_walk_next(H2645NALWalker *w)
+{
+    while (w->length - w->pos >= 4) {
+        int skip;
+
+        if (w->pos == w->next_avc) {
+            int i = 0;
+            int nalsize = get_nalsize(w->nal_length_size, w->buf + w->pos,
+                                      w->length - w->pos, &i, w->logctx);
+            if (nalsize < 0)
+                return nalsize;
+
+            w->pos     += w->nal_length_size;
+            w->next_avc = w->pos + nalsize;
+            return nalsize;
+        }
+
+        if (w->pos > w->next_avc)
+            av_log(w->logctx, AV_LOG_WARNING, "Exceeded next NALFF position, re-syncing.\n");
+
+        /* search start code */
+        skip    = find_next_start_code(w->buf + w->pos, w->buf + w->next_avc);
+        w->pos += FFMIN((unsigned)skip, w->length - w->pos);
+
+        if (w->pos == w->length) {
+            w->no_start_code = 1;
+            return 0;
+        }
+
+        if (w->pos < w->next_avc)
+            return FFMIN(w->length, w->next_avc) - w->pos;
+
+        /* at the start of the next NAL, or past it, in which case the
+         * rest of the buffer is skipped */
+        if (w->pos > w->next_avc)
+            w->pos = w->length;
+    }
+
+    return 0;
+}
+
+void ff_h2645_nal_walk_consume(H2645NALWalker *w, H2645NAL *nal, int consumed)
+{
+    int skip_trailing_zeros = 1;
+
+    w->pos += consumed;
+
+    /* see commit 3566042a0 */
+    if (w->length - w->pos >= 4 && AV_RB32(w->buf + w->pos) == 0x000001E0)
+        skip_trailing_zeros = 0;
+
+    nal->size_bits = get_bit_length(nal, skip_trailing_zeros);
+}
+
 int ff_h2645_packet_split(H2645Packet *pkt, const uint8_t *buf, int length,
                           void *logctx, int is_nalff, int nal_length_size,
                           enum AVCodecID codec_id, int small_padding, int use_ref)
 {
-    GetByteContext bc;
+    H2645NALWalker walk;
     int consumed, ret = 0;
-    int next_avc = is_nalff ? 0 : length;
     int64_t padding = small_padding ? 0 : MAX_MBPAIR_SIZE;
 
-    bytestream2_init(&bc, buf, length);
     alloc_rbsp_buffer(&pkt->rbsp, length + padding, use_ref);
 
     if (!pkt->rbsp.rbsp_buffer)
@@ -406,50 +465,21 @@ int ff_h2645_packet_split(H2645Packet *pkt, const uint8_t *buf, int length,
 
     pkt->rbsp.rbsp_buffer_size = 0;
     pkt->nb_nals = 0;
-    while (bytestream2_get_bytes_left(&bc) >= 4) {
+    ff_h2645_nal_walk_init(&walk, buf, length, is_nalff, nal_length_size, logctx);
+    for (;;) {
         H2645NAL *nal;
-        int extract_length = 0;
-        int skip_trailing_zeros = 1;
-
-        if (bytestream2_tell(&bc) == next_avc) {
-            int i = 0;
-            extract_length = get_nalsize(nal_length_size,
-                                         bc.buffer, bytestream2_get_bytes_left(&bc), &i, logctx);
-            if (extract_length < 0)
-                return extract_length;
-
-            bytestream2_skip(&bc, nal_length_size);
-
-            next_avc = bytestream2_tell(&bc) + extract_length;
-        } else {
-            int buf_index;
-
-            if (bytestream2_tell(&bc) > next_avc)
-                av_log(logctx, AV_LOG_WARNING, "Exceeded next NALFF position, re-syncing.\n");
-
-            /* search start code */
-            buf_index = find_next_start_code(bc.buffer, buf + next_avc);
-
-            bytestream2_skip(&bc, buf_index);
-
-            if (!bytestream2_get_bytes_left(&bc)) {
-                if (pkt->nb_nals > 0) {
-                    // No more start codes: we discarded some irrelevant
-                    // bytes at the end of the packet.
-                    return 0;
-                } else {
-                    av_log(logctx, AV_LOG_ERROR, "No start code is found.\n");
-                    return AVERROR_INVALIDDATA;
-                }
-            }
-
-            extract_length = FFMIN(bytestream2_get_bytes_left(&bc), next_avc - bytestream2_tell(&bc));
-
-            if (bytestream2_tell(&bc) >= next_avc) {
-                /* skip to the start of the next NAL */
-                bytestream2_skip(&bc, next_avc - bytestream2_tell(&bc));
-                continue;
+        int extract_length = ff_h2645_nal_walk_next(&walk);
+
+        if (extract_length < 0)
+            return extract_length;
+        if (!extract_length) {
+            if (walk.no_start_code && !pkt->nb_nals) {
+                av_log(logctx, AV_LOG_ERROR, "No start code is found.\n");
+                return AVERROR_INVALIDDATA;
             }
+            // No more start codes: we discarded some irrelevant
+            // bytes at the end of the packet.
+            return 0;
         }
 
         if (pkt->nals_allocated < pkt->nb_nals + 1) {
@@ -476,7 +506,7 @@ int ff_h2645_packet_split(H2645Packet *pkt, const uint8_t *buf, int length,
         }
         nal = &pkt->nals[pkt->nb_nals];
 
-        consumed = ff_h2645_extract_rbsp(bc.buffer, extract_length, &pkt->rbsp, nal, small_padding);
+        consumed = ff_h2645_extract_rbsp(buf + walk.pos, extract_length, &pkt->rbsp, nal, small_padding);
         if (consumed < 0)
             return consumed;
 
@@ -487,14 +517,7 @@ int ff_h2645_packet_split(H2645Packet *pkt, const uint8_t *buf, int length,
 
         pkt->nb_nals++;
 
-        bytestream2_skip(&bc, consumed);
-
-        /* see commit 3566042a0 */
-        if (bytestream2_get_bytes_left(&bc) >= 4 &&
-            bytestream2_peek_be32(&bc) == 0x000001E0)
-            skip_trailing_zeros = 0;
-
-        nal->size_bits = get_bit_length(nal, skip_trailing_zeros);
+        ff_h2645_nal_walk_consume(&walk, nal, consumed);
 
         ret = init_get_bits(&nal->gb, nal->data, nal->size_bits);
         if (ret < 0)
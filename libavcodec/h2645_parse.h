@@ -86,6 +86,18 @@ typedef struct H2645Packet {
     unsigned nal_buffer_size;
 } H2645Packet;
 
+/* position in a walk over the NAL units of an input packet */
+typedef struct H2645NALWalker {
+    const uint8_t *buf;
+    int length;
+    int pos;
+    int next_avc;
+    int nal_length_size;
+    /* set when the walk ended because no further start code was found */
+    int no_start_code;
+    void *logctx;
+} H2645NALWalker;
+
 /**
  * Extract the raw (unescaped) bitstream.
  */
@@ -110,6 +122,28 @@ int ff_h2645_packet_split(H2645Packet *pkt, const uint8_t *buf, int length,
                           void *logctx, int is_nalff, int nal_length_size,
                           enum AVCodecID codec_id, int small_padding, int use_ref);
 
+/**
+ * Start a walk over the NAL units of buf, in the same way as
+ * ff_h2645_packet_split() does, without extracting them.
+ */
+void ff_h2645_nal_walk_init(H2645NALWalker *w, const uint8_t *buf, int length,
+                            int is_nalff, int nal_length_size, void *logctx);
+
+/**
+ * Find the next NAL unit, which starts at w->buf + w->pos.
+ *
+ * @return the number of bytes the NAL unit may span, 0 at the end of the
+ *         buffer or a negative error code
+ */
+int ff_h2645_nal_walk_next(H2645NALWalker *w);
+
+/**
+ * Move past the consumed bytes of the NAL unit found by the last
+ * ff_h2645_nal_walk_next() call and set its size_bits, once it has been
+ * extracted to nal with ff_h2645_extract_rbsp().
+ */
+void ff_h2645_nal_walk_consume(H2645NALWalker *w, H2645NAL *nal, int consumed);
+
 /**
  * Free all the allocated memory in the packet.
  */
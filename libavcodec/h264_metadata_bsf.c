@@ -86,6 +86,8 @@ typedef struct H264MetadataContext {
     int flip;
 
     int level;
+
+    int full_decompose;
 } H264MetadataContext;
 
 
@@ -621,6 +623,10 @@ fail:
     return err;
 }
 
+static const CodedBitstreamUnitType h264_metadata_decompose_types[] = {
+    H264_NAL_SPS,
+};
+
 static int h264_metadata_init(AVBSFContext *bsf)
 {
     H264MetadataContext *ctx = bsf->priv_data;
@@ -634,6 +640,17 @@ static int h264_metadata_init(AVBSFContext *bsf)
     if (err < 0)
         return err;
 
+    // Unless slice headers or SEI messages are needed, only the SPS has
+    // to be decomposed; everything else is passed through untouched.
+    if (!ctx->full_decompose &&
+        ctx->aud != INSERT && !ctx->sei_user_data &&
+        !ctx->delete_filler && ctx->display_orientation == PASS) {
+        ctx->input->decompose_unit_types    =
+            (CodedBitstreamUnitType*)h264_metadata_decompose_types;
+        ctx->input->nb_decompose_unit_types =
+            FF_ARRAY_ELEMS(h264_metadata_decompose_types);
+    }
+
     if (bsf->par_in->extradata) {
         err = ff_cbs_read_extradata(ctx->input, au, bsf->par_in);
         if (err < 0) {
@@ -793,6 +810,10 @@ static const AVOption h264_metadata_options[] = {
     { LEVEL("6.2", 62) },
 #undef LEVEL
 
+    { "full_decompose", "Decompose all units, not only those options modify",
+        OFFSET(full_decompose), AV_OPT_TYPE_BOOL,
+        { .i64 = 0 }, 0, 1, FLAGS },
+
     { NULL }
 };
 
@@ -53,6 +53,7 @@ typedef struct H264ParseContext {
     H264DSPContext h264dsp;
     H264POCContext poc;
     H264SEIContext sei;
+    H2645RBSP rbsp;
     int is_avc;
     int nal_length_size;
     int got_first;
@@ -233,6 +234,47 @@ static int scan_mmco_reset(AVCodecParserContext *s, GetBitContext *gb,
     return 0;
 }
 
+/**
+ * Check whether a SPS is a bit-exact repeat of the one already stored
+ * under its id, in which case decoding it again would change nothing.
+ */
+static int is_repeated_sps(const H264ParamSets *ps, const GetBitContext *gb)
+{
+    GetBitContext tmp = *gb;
+    size_t size = gb->buffer_end - gb->buffer;
+    const SPS *sps;
+    unsigned int sps_id;
+
+    skip_bits(&tmp, 24); // profile_idc, constraint_set_flags, level_idc
+    sps_id = get_ue_golomb_31(&tmp);
+    if (sps_id >= MAX_SPS_COUNT || !ps->sps_list[sps_id])
+        return 0;
+    sps = (const SPS*)ps->sps_list[sps_id]->data;
+
+    return sps->data_size == size && !memcmp(sps->data, gb->buffer, size);
+}
+
+/**
+ * Same as is_repeated_sps() for a PPS, which additionally must have been
+ * decoded against the SPS currently stored under its sps_id.
+ */
+static int is_repeated_pps(const H264ParamSets *ps, const GetBitContext *gb)
+{
+    GetBitContext tmp = *gb;
+    size_t size = gb->buffer_end - gb->buffer;
+    const PPS *pps;
+    unsigned int pps_id;
+
+    pps_id = get_ue_golomb(&tmp);
+    if (pps_id >= MAX_PPS_COUNT || !ps->pps_list[pps_id])
+        return 0;
+    pps = (const PPS*)ps->pps_list[pps_id]->data;
+
+    return pps->data_size == size && !memcmp(pps->data, gb->buffer, size) &&
+           ps->sps_list[pps->sps_id] &&
+           pps->sps == (const SPS*)ps->sps_list[pps->sps_id]->data;
+}
+
 /**
  * Parse NAL units of found picture and decode some basic information.
  *
@@ -246,7 +288,7 @@ static inline int parse_nal_units(AVCodecParserContext *s,
                                   const uint8_t * const buf, int buf_size)
 {
     H264ParseContext *p = s->priv_data;
-    H2645RBSP rbsp = { NULL };
+    H2645RBSP *rbsp = &p->rbsp;
     H2645NAL nal = { NULL };
     int buf_index, next_avc;
     unsigned int pps_id;
@@ -267,9 +309,10 @@ static inline int parse_nal_units(AVCodecParserContext *s,
     if (!buf_size)
         return 0;
 
-    av_fast_padded_malloc(&rbsp.rbsp_buffer, &rbsp.rbsp_buffer_alloc_size, buf_size);
-    if (!rbsp.rbsp_buffer)
+    av_fast_padded_malloc(&rbsp->rbsp_buffer, &rbsp->rbsp_buffer_alloc_size, buf_size);
+    if (!rbsp->rbsp_buffer)
         return AVERROR(ENOMEM);
+    rbsp->rbsp_buffer_size = 0;
 
     buf_index     = 0;
     next_avc      = p->is_avc ? 0 : buf_size;
@@ -308,7 +351,7 @@ static inline int parse_nal_units(AVCodecParserContext *s,
             }
             break;
         }
-        consumed = ff_h2645_extract_rbsp(buf + buf_index, src_length, &rbsp, &nal, 1);
+        consumed = ff_h2645_extract_rbsp(buf + buf_index, src_length, rbsp, &nal, 1);
         if (consumed < 0)
             break;
 
@@ -323,11 +366,13 @@ static inline int parse_nal_units(AVCodecParserContext *s,
 
         switch (nal.type) {
         case H264_NAL_SPS:
-            ff_h264_decode_seq_parameter_set(&nal.gb, avctx, &p->ps, 0);
+            if (!is_repeated_sps(&p->ps, &nal.gb))
+                ff_h264_decode_seq_parameter_set(&nal.gb, avctx, &p->ps, 0);
             break;
         case H264_NAL_PPS:
-            ff_h264_decode_picture_parameter_set(&nal.gb, avctx, &p->ps,
-                                                 nal.size_bits);
+            if (!is_repeated_pps(&p->ps, &nal.gb))
+                ff_h264_decode_picture_parameter_set(&nal.gb, avctx, &p->ps,
+                                                     nal.size_bits);
             break;
         case H264_NAL_SEI:
             ff_h264_sei_decode(&p->sei, &nal.gb, &p->ps, avctx);
@@ -551,18 +596,14 @@ static inline int parse_nal_units(AVCodecParserContext *s,
                 p->last_frame_num = p->poc.frame_num;
             }
 
-            av_freep(&rbsp.rbsp_buffer);
             return 0; /* no need to evaluate the rest */
         }
     }
-    if (q264) {
-        av_freep(&rbsp.rbsp_buffer);
+    if (q264)
         return 0;
-    }
     /* didn't find a picture! */
     av_log(avctx, AV_LOG_ERROR, "missing picture in access unit with size %d\n", buf_size);
 fail:
-    av_freep(&rbsp.rbsp_buffer);
     return -1;
 }
 
@@ -687,6 +728,7 @@ static void h264_close(AVCodecParserContext *s)
     ParseContext *pc = &p->pc;
 
     av_freep(&pc->buffer);
+    av_freep(&p->rbsp.rbsp_buffer);
 
     ff_h264_sei_uninit(&p->sei);
     ff_h264_ps_uninit(&p->ps);
@@ -70,6 +70,8 @@ typedef struct H265MetadataContext {
     int level;
     int level_guess;
     int level_warned;
+
+    int full_decompose;
 } H265MetadataContext;
 
 
@@ -490,6 +492,12 @@ fail:
     return err;
 }
 
+static const CodedBitstreamUnitType h265_metadata_decompose_types[] = {
+    HEVC_NAL_VPS,
+    HEVC_NAL_SPS,
+    HEVC_NAL_PPS,
+};
+
 static int h265_metadata_init(AVBSFContext *bsf)
 {
     H265MetadataContext *ctx = bsf->priv_data;
@@ -503,6 +511,15 @@ static int h265_metadata_init(AVBSFContext *bsf)
     if (err < 0)
         return err;
 
+    // AUD insertion looks at the header of every NAL unit; otherwise
+    // only the parameter sets need to be decomposed.
+    if (!ctx->full_decompose && ctx->aud != INSERT) {
+        ctx->input->decompose_unit_types    =
+            (CodedBitstreamUnitType*)h265_metadata_decompose_types;
+        ctx->input->nb_decompose_unit_types =
+            FF_ARRAY_ELEMS(h265_metadata_decompose_types);
+    }
+
     if (bsf->par_in->extradata) {
         err = ff_cbs_read_extradata(ctx->input, au, bsf->par_in);
         if (err < 0) {
@@ -631,6 +648,10 @@ static const AVOption h265_metadata_options[] = {
     { LEVEL("8.5", 255) },
 #undef LEVEL
 
+    { "full_decompose", "Decompose all units, not only those options modify",
+        OFFSET(full_decompose), AV_OPT_TYPE_BOOL,
+        { .i64 = 0 }, 0, 1, FLAGS },
+
     { NULL }
 };
 
@@ -39,7 +39,7 @@
 typedef struct HEVCParserContext {
     ParseContext pc;
 
-    H2645Packet pkt;
+    H2645RBSP rbsp;
     HEVCParamSets ps;
     HEVCSEI sei;
 
@@ -173,6 +173,56 @@ static int hevc_parse_slice_header(AVCodecParserContext *s, H2645NAL *nal,
     return 1; /* no need to evaluate the rest */
 }
 
+/**
+ * Check whether a parameter set is a bit-exact repeat of one already
+ * stored, in which case decoding it again would change nothing.  Since a
+ * replaced VPS or SPS drops the parameter sets depending on it, a stored
+ * copy is always still valid.
+ */
+static int is_repeated_ps(const HEVCParamSets *ps, const H2645NAL *nal)
+{
+    const GetBitContext *gb = &nal->gb;
+    size_t size = gb->buffer_end - gb->buffer;
+    GetBitContext tmp = *gb;
+    unsigned int id;
+    int i;
+
+    switch (nal->type) {
+    case HEVC_NAL_VPS: {
+        const HEVCVPS *vps;
+
+        id = get_bits(&tmp, 4);
+        if (!ps->vps_list[id])
+            return 0;
+        vps = (const HEVCVPS*)ps->vps_list[id]->data;
+        return vps->data_size == size && !memcmp(vps->data, gb->buffer, size);
+    }
+    case HEVC_NAL_SPS:
+        // The id follows the variable-length profile_tier_level,
+        // so just look at all of them.
+        for (i = 0; i < HEVC_MAX_SPS_COUNT; i++) {
+            const HEVCSPS *sps;
+
+            if (!ps->sps_list[i])
+                continue;
+            sps = (const HEVCSPS*)ps->sps_list[i]->data;
+            if (sps->data_size == size && !memcmp(sps->data, gb->buffer, size))
+                return 1;
+        }
+        return 0;
+    case HEVC_NAL_PPS: {
+        const HEVCPPS *pps;
+
+        id = get_ue_golomb_long(&tmp);
+        if (id >= HEVC_MAX_PPS_COUNT || !ps->pps_list[id])
+            return 0;
+        pps = (const HEVCPPS*)ps->pps_list[id]->data;
+        return pps->data_size == size && !memcmp(pps->data, gb->buffer, size);
+    }
+    }
+    return 0;
+}
+
 /**
  * Parse NAL units of found picture and decode some basic information.
  *
@@ -187,7 +237,10 @@ static int parse_nal_units(AVCodecParserContext *s, const uint8_t *buf,
     HEVCParserContext *ctx = s->priv_data;
     HEVCParamSets *ps = &ctx->ps;
     HEVCSEI *sei = &ctx->sei;
-    int ret, i;
+    H2645NAL nal_buf = { NULL }, *nal = &nal_buf;
+    GetBitContext *gb = &nal->gb;
+    H2645NALWalker walk;
+    int src_length, ret;
 
     /* set some sane default values */
     s->pict_type         = AV_PICTURE_TYPE_I;
@@ -196,27 +249,57 @@ static int parse_nal_units(AVCodecParserContext *s, const uint8_t *buf,
 
     ff_hevc_reset_sei(sei);
 
-    ret = ff_h2645_packet_split(&ctx->pkt, buf, buf_size, avctx, ctx->is_avc,
-                                ctx->nal_length_size, AV_CODEC_ID_HEVC, 1, 0);
-    if (ret < 0)
-        return ret;
+    av_fast_padded_malloc(&ctx->rbsp.rbsp_buffer, &ctx->rbsp.rbsp_buffer_alloc_size, buf_size);
+    if (!ctx->rbsp.rbsp_buffer)
+        return AVERROR(ENOMEM);
+    ctx->rbsp.rbsp_buffer_size = 0;
+
+    /* Walk the NAL units one by one rather than splitting the whole access
+     * unit up front: parsing stops at the first slice header, so the slice
+     * data never needs to be unescaped. */
+    ff_h2645_nal_walk_init(&walk, buf, buf_size, ctx->is_avc,
+                           ctx->nal_length_size, avctx);
+    while ((src_length = ff_h2645_nal_walk_next(&walk)) > 0) {
+        const uint8_t *src = buf + walk.pos;
+        int consumed;
+
+        // Only the start of the slice segment header is ever read.
+        if (((src[0] >> 1) & 0x3F) <= HEVC_NAL_RSV_VCL31)
+            src_length = FFMIN(src_length, 64);
+
+        consumed = ff_h2645_extract_rbsp(src, src_length, &ctx->rbsp, nal, 1);
+        if (consumed < 0)
+            return consumed;
+        ff_h2645_nal_walk_consume(&walk, nal, consumed);
+
+        // nothing beyond the NAL unit header
+        if (nal->size_bits <= 16)
+            continue;
 
-    for (i = 0; i < ctx->pkt.nb_nals; i++) {
-        H2645NAL *nal = &ctx->pkt.nals[i];
-        GetBitContext *gb = &nal->gb;
+        ret = init_get_bits(gb, nal->data, nal->size_bits);
+        if (ret < 0)
+            return ret;
 
-        if (nal->nuh_layer_id > 0)
+        if (get_bits1(gb))
+            continue; // forbidden_zero_bit
+        nal->type         = get_bits(gb, 6);
+        nal->nuh_layer_id = get_bits(gb, 6);
+        nal->temporal_id  = get_bits(gb, 3) - 1;
+        if (nal->temporal_id < 0 || nal->nuh_layer_id > 0)
             continue;
 
         switch (nal->type) {
         case HEVC_NAL_VPS:
-            ff_hevc_decode_nal_vps(gb, avctx, ps);
+            if (!is_repeated_ps(ps, nal))
+                ff_hevc_decode_nal_vps(gb, avctx, ps);
             break;
         case HEVC_NAL_SPS:
-            ff_hevc_decode_nal_sps(gb, avctx, ps, 1);
+            if (!is_repeated_ps(ps, nal))
+                ff_hevc_decode_nal_sps(gb, avctx, ps, 1);
             break;
         case HEVC_NAL_PPS:
-            ff_hevc_decode_nal_pps(gb, avctx, ps);
+            if (!is_repeated_ps(ps, nal))
+                ff_hevc_decode_nal_pps(gb, avctx, ps);
             break;
         case HEVC_NAL_SEI_PREFIX:
         case HEVC_NAL_SEI_SUFFIX:
@@ -263,11 +346,29 @@ static int hevc_find_frame_end(AVCodecParserContext *s, const uint8_t *buf,
 {
     HEVCParserContext *ctx = s->priv_data;
     ParseContext       *pc = &ctx->pc;
-    int i;
+    int i, j;
 
     for (i = 0; i < buf_size; i++) {
         int nut;
 
+        if (i >= 5) {
+            // Once the start code can no longer straddle the previous
+            // buffer, skip directly to the next one.
+            const uint8_t *one = buf + i - 3;
+
+            while ((one = memchr(one, 1, buf + buf_size - one)) &&
+                   (one[-1] || one[-2]))
+                one++;
+            j = one ? one - buf + 3 : buf_size;
+            if (j > i) {
+                i = FFMIN(j, buf_size);
+                for (j = i - 6; j < i; j++)
+                    pc->state64 = (pc->state64 << 8) | buf[j];
+                if (i >= buf_size)
+                    break;
+            }
+        }
+
         pc->state64 = (pc->state64 << 8) | buf[i];
 
         if (((pc->state64 >> 3 * 8) & 0xFFFFFF) != START_CODE)
@@ -374,7 +475,7 @@ static void hevc_parser_close(AVCodecParserContext *s)
     HEVCParserContext *ctx = s->priv_data;
 
     ff_hevc_ps_uninit(&ctx->ps);
-    ff_h2645_packet_uninit(&ctx->pkt);
+    av_freep(&ctx->rbsp.rbsp_buffer);
     ff_hevc_reset_sei(&ctx->sei);
 
     av_freep(&ctx->pc.buffer);
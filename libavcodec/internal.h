@@ -32,6 +32,7 @@
 #include "libavutil/pixfmt.h"
 #include "avcodec.h"
 #include "config.h"
+#include "packet_internal.h"
 
 /**
  * The codec does not modify any global variables in the init function,
@@ -152,6 +153,12 @@ typedef struct AVCodecInternal {
     uint8_t *byte_buffer;
     unsigned int byte_buffer_size;
 
+    /**
+     * Pool for the packets copied by the encode and decode queues,
+     * with AV_CODEC_FLAG2_POOL_PACKETS.
+     */
+    FFPacketPool *packet_pool;
+
     void *frame_thread_encoder;
 
     EncodeSimpleContext es;
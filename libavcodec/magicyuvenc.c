@@ -33,6 +33,10 @@
 #include "thread.h"
 #include "lossless_videoencdsp.h"
 
+/* Bytes left between the slices of a plane, as the SIMD predictors
+ * write past the end of the last line */
+#define SLICE_GAP 32
+
 typedef enum Prediction {
     LEFT = 1,
     GRADIENT,
@@ -50,20 +54,26 @@ typedef struct PTable {
     int64_t prob;   ///< number of occurences of this value in input
 } PTable;
 
+typedef struct Slice {
+    unsigned pos;           ///< position of the coded slice in the packet
+    unsigned size;          ///< size of the coded slice in bytes
+    uint32_t counts[256];   ///< usage of the predicted values in the slice
+} Slice;
+
 typedef struct MagicYUVContext {
     const AVClass       *class;
     int                  frame_pred;
     PutBitContext        pb;
     int                  planes;
     uint8_t              format;
-    AVFrame             *p;
+    const AVFrame       *p;
     int                  slice_height;
     int                  nb_slices;
     int                  correlate;
     int                  hshift[4];
     int                  vshift[4];
     uint8_t             *slices[4];
-    unsigned             slice_pos[4];
+    Slice               *slice_info[4];
     unsigned             tables_size;
     HuffEntry            he[4][256];
     LLVidEncDSPContext   llvidencdsp;
@@ -197,12 +207,24 @@ static av_cold int magy_encode_init(AVCodecContext *avctx)
 
     s->planes = av_pix_fmt_count_planes(avctx->pix_fmt);
 
-    s->nb_slices = 1;
+    if (avctx->slices < 0 || avctx->slices > avctx->height) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid number of slices: %d\n",
+               avctx->slices);
+        return AVERROR(EINVAL);
+    }
+
+    /* Slices must hold whole lines of the subsampled planes */
+    s->slice_height = avctx->slices ? FFALIGN((avctx->height + avctx->slices - 1) / avctx->slices,
+                                              1 << s->vshift[1])
+                                    : avctx->height;
+    s->nb_slices    = (avctx->height + s->slice_height - 1) / s->slice_height;
 
     for (i = 0; i < s->planes; i++) {
         s->slices[i] = av_malloc(avctx->width * (avctx->height + 2) +
+                                 s->nb_slices * SLICE_GAP +
                                  AV_INPUT_BUFFER_PADDING_SIZE);
-        if (!s->slices[i]) {
+        s->slice_info[i] = av_malloc_array(s->nb_slices, sizeof(*s->slice_info[i]));
+        if (!s->slices[i] || !s->slice_info[i]) {
             av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer.\n");
             return AVERROR(ENOMEM);
         }
@@ -240,7 +262,7 @@ static av_cold int magy_encode_init(AVCodecContext *avctx)
     bytestream2_put_le32(&pb, avctx->width);
     bytestream2_put_le32(&pb, avctx->height);
     bytestream2_put_le32(&pb, avctx->width);
-    bytestream2_put_le32(&pb, avctx->height);
+    bytestream2_put_le32(&pb, s->slice_height);
 
     return 0;
 }
@@ -274,13 +296,13 @@ static void calculate_codes(HuffEntry *he)
 }
 
 static void count_usage(uint8_t *src, int width,
-                        int height, PTable *counts)
+                        int height, uint32_t *counts)
 {
     int i, j;
 
     for (j = 0; j < height; j++) {
         for (i = 0; i < width; i++) {
-            counts[src[i]].prob++;
+            counts[src[i]]++;
         }
         src += width;
     }
@@ -361,14 +383,17 @@ static void magy_huffman_compute_bits(PTable *prob_table, HuffEntry *distincts,
     }
 }
 
-static int encode_table(AVCodecContext *avctx, uint8_t *dst,
-                        int width, int height,
+static int encode_table(AVCodecContext *avctx, Slice *slice_info,
                         PutBitContext *pb, HuffEntry *he)
 {
+    MagicYUVContext *s = avctx->priv_data;
     PTable counts[256] = { {0} };
-    int i;
+    int i, j;
 
-    count_usage(dst, width, height, counts);
+    /* Merge the usage of values of all slices of the plane */
+    for (j = 0; j < s->nb_slices; j++)
+        for (i = 0; i < 256; i++)
+            counts[i].prob += slice_info[j].counts[i];
 
     for (i = 0; i < 256; i++) {
         counts[i].prob++;
@@ -420,6 +445,71 @@ static int encode_slice(uint8_t *src, uint8_t *dst, int dst_size,
     return count >> 3;
 }
 
+static void get_slice(AVCodecContext *avctx, int plane, int slice,
+                      int *width, int *height, int *sstart, uint8_t **dst)
+{
+    MagicYUVContext *s = avctx->priv_data;
+
+    *width  = AV_CEIL_RSHIFT(avctx->width, s->hshift[plane]);
+    *height = AV_CEIL_RSHIFT(FFMIN(s->slice_height, avctx->height - slice * s->slice_height),
+                             s->vshift[plane]);
+    *sstart = slice * AV_CEIL_RSHIFT(s->slice_height, s->vshift[plane]);
+    *dst    = s->slices[plane] + *sstart * *width + slice * SLICE_GAP;
+}
+
+static int predict_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    MagicYUVContext *s = avctx->priv_data;
+    const AVFrame *frame = s->p;
+    const int plane = jobnr / s->nb_slices;
+    const int slice = jobnr % s->nb_slices;
+    Slice *info = &s->slice_info[plane][slice];
+    int src_plane = plane, width, height, sstart, i;
+    uint8_t *src, *dst;
+
+    get_slice(avctx, plane, slice, &width, &height, &sstart, &dst);
+
+    /* Decorrelated planes are coded in B, G, R order */
+    if (s->correlate && plane < 2)
+        src_plane = !plane;
+    src = frame->data[src_plane] + sstart * frame->linesize[src_plane];
+
+    if (s->correlate && (src_plane == 1 || src_plane == 2)) {
+        uint8_t *row = src, *g = frame->data[0] + sstart * frame->linesize[0];
+
+        for (i = 0; i < height; i++) {
+            s->llvidencdsp.diff_bytes(row, row, g, width);
+            row += frame->linesize[src_plane];
+            g   += frame->linesize[0];
+        }
+    }
+
+    s->predict(s, src, dst, frame->linesize[src_plane], width, height);
+
+    memset(info->counts, 0, sizeof(info->counts));
+    count_usage(dst, width, height, info->counts);
+
+    return 0;
+}
+
+static int encode_slice_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    MagicYUVContext *s = avctx->priv_data;
+    AVPacket *pkt = arg;
+    const int plane = jobnr / s->nb_slices;
+    const int slice = jobnr % s->nb_slices;
+    Slice *info = &s->slice_info[plane][slice];
+    int width, height, sstart;
+    uint8_t *src;
+
+    get_slice(avctx, plane, slice, &width, &height, &sstart, &src);
+
+    encode_slice(src, pkt->data + info->pos, info->size,
+                 width, height, s->he[plane], s->frame_pred);
+
+    return 0;
+}
+
 static int magy_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                              const AVFrame *frame, int *got_packet)
 {
@@ -428,7 +518,7 @@ static int magy_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     const int width = avctx->width, height = avctx->height;
     int pos, slice, i, j, ret = 0;
 
-    ret = ff_alloc_packet2(avctx, pkt, (256 + 4 * s->nb_slices + width * height) *
+    ret = ff_alloc_packet2(avctx, pkt, (256 + 12 * s->nb_slices + width * height) *
                            s->planes + 256, 0);
     if (ret < 0)
         return ret;
@@ -449,7 +539,7 @@ static int magy_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     bytestream2_put_le32(&pb, avctx->width);
     bytestream2_put_le32(&pb, avctx->height);
     bytestream2_put_le32(&pb, avctx->width);
-    bytestream2_put_le32(&pb, avctx->height);
+    bytestream2_put_le32(&pb, s->slice_height);
     bytestream2_put_le32(&pb, 0);
 
     for (i = 0; i < s->planes; i++) {
@@ -467,71 +557,50 @@ static int magy_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         }
     }
 
-    if (s->correlate) {
-        uint8_t *r, *g, *b;
-        AVFrame *p = av_frame_clone(frame);
-
-        g = p->data[0];
-        b = p->data[1];
-        r = p->data[2];
-
-        for (i = 0; i < height; i++) {
-            s->llvidencdsp.diff_bytes(b, b, g, width);
-            s->llvidencdsp.diff_bytes(r, r, g, width);
-            g += p->linesize[0];
-            b += p->linesize[1];
-            r += p->linesize[2];
-        }
-
-        FFSWAP(uint8_t*, p->data[0], p->data[1]);
-        FFSWAP(int, p->linesize[0], p->linesize[1]);
-
-        for (i = 0; i < s->planes; i++) {
-            for (slice = 0; slice < s->nb_slices; slice++) {
-                s->predict(s, p->data[i], s->slices[i], p->linesize[i],
-                               p->width, p->height);
-            }
-        }
-
-        av_frame_free(&p);
-    } else {
-        for (i = 0; i < s->planes; i++) {
-            for (slice = 0; slice < s->nb_slices; slice++) {
-                s->predict(s, frame->data[i], s->slices[i], frame->linesize[i],
-                           AV_CEIL_RSHIFT(frame->width, s->hshift[i]),
-                           AV_CEIL_RSHIFT(frame->height, s->vshift[i]));
-            }
-        }
-    }
+    /*
+     * Predict and count all slices of all planes in parallel, build the
+     * tables from the merged counts, then code every slice into its place.
+     */
+    s->p = frame;
+    avctx->execute2(avctx, predict_slice, NULL, NULL, s->planes * s->nb_slices);
 
     init_put_bits(&s->pb, pkt->data + bytestream2_tell_p(&pb), bytestream2_get_bytes_left_p(&pb));
 
     for (i = 0; i < s->planes; i++) {
-        encode_table(avctx, s->slices[i],
-                     AV_CEIL_RSHIFT(frame->width,  s->hshift[i]),
-                     AV_CEIL_RSHIFT(frame->height, s->vshift[i]),
-                     &s->pb, s->he[i]);
+        encode_table(avctx, s->slice_info[i], &s->pb, s->he[i]);
     }
     s->tables_size = (put_bits_count(&s->pb) + 7) >> 3;
     bytestream2_skip_p(&pb, s->tables_size);
 
+    /* The coded size of each slice follows from its counts */
     for (i = 0; i < s->planes; i++) {
-        unsigned slice_size;
-
-        s->slice_pos[i] = bytestream2_tell_p(&pb);
-        slice_size = encode_slice(s->slices[i], pkt->data + bytestream2_tell_p(&pb),
-                                  bytestream2_get_bytes_left_p(&pb),
-                                  AV_CEIL_RSHIFT(frame->width,  s->hshift[i]),
-                                  AV_CEIL_RSHIFT(frame->height, s->vshift[i]),
-                                  s->he[i], s->frame_pred);
-        bytestream2_skip_p(&pb, slice_size);
+        for (slice = 0; slice < s->nb_slices; slice++) {
+            Slice *info = &s->slice_info[i][slice];
+            uint64_t bits = 16;
+
+            for (j = 0; j < 256; j++)
+                bits += info->counts[j] * (uint64_t)s->he[i][j].len;
+
+            info->pos  = bytestream2_tell_p(&pb);
+            info->size = (bits + 31) >> 5 << 2;
+            if (bytestream2_get_bytes_left_p(&pb) < info->size) {
+                av_log(avctx, AV_LOG_ERROR, "Output packet too small.\n");
+                return AVERROR_BUG;
+            }
+            bytestream2_skip_p(&pb, info->size);
+        }
     }
 
+    avctx->execute2(avctx, encode_slice_job, pkt, NULL, s->planes * s->nb_slices);
+    s->p = NULL;
+
     pos = bytestream2_tell_p(&pb);
     bytestream2_seek_p(&pb, 32, SEEK_SET);
-    bytestream2_put_le32(&pb, s->slice_pos[0] - 32);
+    bytestream2_put_le32(&pb, s->slice_info[0][0].pos - 32);
     for (i = 0; i < s->planes; i++) {
-        bytestream2_put_le32(&pb, s->slice_pos[i] - 32);
+        for (slice = 0; slice < s->nb_slices; slice++) {
+            bytestream2_put_le32(&pb, s->slice_info[i][slice].pos - 32);
+        }
     }
     bytestream2_seek_p(&pb, pos, SEEK_SET);
 
@@ -548,8 +617,10 @@ static av_cold int magy_encode_close(AVCodecContext *avctx)
     MagicYUVContext *s = avctx->priv_data;
     int i;
 
-    for (i = 0; i < s->planes; i++)
+    for (i = 0; i < s->planes; i++) {
         av_freep(&s->slices[i]);
+        av_freep(&s->slice_info[i]);
+    }
 
     return 0;
 }
@@ -581,7 +652,7 @@ AVCodec ff_magicyuv_encoder = {
     .init             = magy_encode_init,
     .close            = magy_encode_close,
     .encode2          = magy_encode_frame,
-    .capabilities     = AV_CODEC_CAP_FRAME_THREADS,
+    .capabilities     = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts         = (const enum AVPixelFormat[]) {
                           AV_PIX_FMT_GBRP, AV_PIX_FMT_GBRAP, AV_PIX_FMT_YUV422P,
                           AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUVA444P, AV_PIX_FMT_GRAY8,
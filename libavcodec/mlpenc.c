@@ -128,7 +128,8 @@ typedef struct {
     int32_t        *major_scratch_buffer;   ///< Scratch buffer big enough to fit all data for one entire major frame interval.
     int32_t        *last_frame;             ///< Pointer to last frame with data to encode.
 
-    int32_t        *lpc_sample_buffer;
+    int32_t        *lpc_sample_buffer;      ///< Per-channel copies of the samples for LPC analysis.
+    unsigned int    lpc_buffer_size;        ///< Number of samples per channel in lpc_sample_buffer.
 
     unsigned int    major_number_of_frames;
     unsigned int    next_major_number_of_frames;
@@ -176,7 +177,6 @@ typedef struct {
     unsigned int    major_filter_state_subblock;
     unsigned int    major_number_of_subblocks;
 
-    BestOffset    (*cur_best_offset)[NUM_CODEBOOKS];
     ChannelParams  *cur_channel_params;
     DecodingParams *cur_decoding_params;
     RestartHeader  *cur_restart_header;
@@ -198,7 +198,7 @@ typedef struct {
 
     unsigned int    max_codebook_search;
 
-    LPCContext      lpc_ctx;
+    LPCContext      lpc_ctx[MAX_CHANNELS];  ///< One per channel so that channels can be analyzed concurrently.
 } MLPEncodeContext;
 
 static ChannelParams   restart_channel_params[MAX_CHANNELS];
@@ -490,7 +490,7 @@ static av_cold int mlp_encode_init(AVCodecContext *avctx)
     unsigned int substr, index;
     unsigned int sum = 0;
     unsigned int size;
-    int ret;
+    int ch, ret;
 
     ctx->avctx = avctx;
 
@@ -583,8 +583,9 @@ static av_cold int mlp_encode_init(AVCodecContext *avctx)
     /* TODO Let user pass parameters for LPC filter. */
 
     size = avctx->frame_size * ctx->max_restart_interval;
+    ctx->lpc_buffer_size = size;
 
-    ctx->lpc_sample_buffer = av_malloc_array(size, sizeof(int32_t));
+    ctx->lpc_sample_buffer = av_malloc_array(size * avctx->channels, sizeof(int32_t));
     if (!ctx->lpc_sample_buffer) {
         av_log(avctx, AV_LOG_ERROR,
                "Not enough memory for buffering samples.\n");
@@ -729,11 +730,13 @@ static av_cold int mlp_encode_init(AVCodecContext *avctx)
     clear_channel_params(ctx, restart_channel_params);
     clear_decoding_params(ctx, restart_decoding_params);
 
-    if ((ret = ff_lpc_init(&ctx->lpc_ctx, ctx->number_of_samples,
-                    MLP_MAX_LPC_ORDER, FF_LPC_TYPE_LEVINSON)) < 0) {
-        av_log(avctx, AV_LOG_ERROR,
-               "Not enough memory for LPC context.\n");
-        return ret;
+    for (ch = 0; ch < avctx->channels; ch++) {
+        if ((ret = ff_lpc_init(&ctx->lpc_ctx[ch], ctx->number_of_samples,
+                        MLP_MAX_LPC_ORDER, FF_LPC_TYPE_LEVINSON)) < 0) {
+            av_log(avctx, AV_LOG_ERROR,
+                   "Not enough memory for LPC context.\n");
+            return ret;
+        }
     }
 
     ff_af_queue_init(avctx, &ctx->afq);
@@ -1396,7 +1399,7 @@ static void set_filter_params(MLPEncodeContext *ctx,
                               ? 4 : MLP_MAX_LPC_ORDER;
         int32_t *sample_buffer = ctx->sample_buffer + channel;
         int32_t coefs[MAX_LPC_ORDER][MAX_LPC_ORDER];
-        int32_t *lpc_samples = ctx->lpc_sample_buffer;
+        int32_t *lpc_samples = ctx->lpc_sample_buffer + channel * ctx->lpc_buffer_size;
         int32_t *fcoeff = ctx->cur_channel_params[channel].coeff[filter];
         int shift[MLP_MAX_LPC_ORDER];
         unsigned int i;
@@ -1407,7 +1410,8 @@ static void set_filter_params(MLPEncodeContext *ctx,
             sample_buffer += ctx->num_channels;
         }
 
-        order = ff_lpc_calc_coefs(&ctx->lpc_ctx, ctx->lpc_sample_buffer,
+        order = ff_lpc_calc_coefs(&ctx->lpc_ctx[channel],
+                                  ctx->lpc_sample_buffer + channel * ctx->lpc_buffer_size,
                                   ctx->number_of_samples, MLP_MIN_LPC_ORDER,
                                   max_order, 11, coefs, shift, FF_LPC_TYPE_LEVINSON, 0,
                                   ORDER_METHOD_EST, MLP_MIN_LPC_SHIFT,
@@ -1423,6 +1427,18 @@ static void set_filter_params(MLPEncodeContext *ctx,
     }
 }
 
+static int determine_filters_channel(AVCodecContext *avctx, void *arg,
+                                     int jobnr, int threadnr)
+{
+    MLPEncodeContext *ctx = avctx->priv_data;
+    int channel = ctx->cur_restart_header->min_channel + jobnr;
+    int filter;
+
+    for (filter = 0; filter < NUM_FILTERS; filter++)
+        set_filter_params(ctx, channel, filter, 0);
+    return 0;
+}
+
 /** Tries to determine a good prediction filter, and applies it to the samples
  *  buffer if the filter is good enough. Sets the filter data to be cleared if
  *  no good filter was found.
@@ -1430,12 +1446,9 @@ static void set_filter_params(MLPEncodeContext *ctx,
 static void determine_filters(MLPEncodeContext *ctx)
 {
     RestartHeader *rh = ctx->cur_restart_header;
-    int channel, filter;
 
-    for (channel = rh->min_channel; channel <= rh->max_channel; channel++) {
-        for (filter = 0; filter < NUM_FILTERS; filter++)
-            set_filter_params(ctx, channel, filter, 0);
-    }
+    ctx->avctx->execute2(ctx->avctx, determine_filters_channel, NULL, NULL,
+                         rh->max_channel - rh->min_channel + 1);
 }
 
 enum MLPChMode {
@@ -1557,12 +1570,11 @@ static const int codebook_extremes[3][2] = {
 /** Determines the amount of bits needed to encode the samples using no
  *  codebooks and a specified offset.
  */
-static void no_codebook_bits_offset(MLPEncodeContext *ctx,
+static void no_codebook_bits_offset(DecodingParams *dp,
                                     unsigned int channel, int16_t offset,
                                     int32_t min, int32_t max,
                                     BestOffset *bo)
 {
-    DecodingParams *dp = ctx->cur_decoding_params;
     int32_t unsign = 0;
     int lsb_bits;
 
@@ -1586,12 +1598,11 @@ static void no_codebook_bits_offset(MLPEncodeContext *ctx,
 /** Determines the least amount of bits needed to encode the samples using no
  *  codebooks.
  */
-static void no_codebook_bits(MLPEncodeContext *ctx,
+static void no_codebook_bits(DecodingParams *dp,
                              unsigned int channel,
                              int32_t min, int32_t max,
                              BestOffset *bo)
 {
-    DecodingParams *dp = ctx->cur_decoding_params;
     int16_t offset;
     int32_t unsign = 0;
     uint32_t diff;
@@ -1626,15 +1637,14 @@ static void no_codebook_bits(MLPEncodeContext *ctx,
 /** Determines the least amount of bits needed to encode the samples using a
  *  given codebook and a given offset.
  */
-static inline void codebook_bits_offset(MLPEncodeContext *ctx,
+static inline void codebook_bits_offset(MLPEncodeContext *ctx, DecodingParams *dp,
+                                        int32_t *sample_buffer,
                                         unsigned int channel, int codebook,
                                         int32_t sample_min, int32_t sample_max,
                                         int16_t offset, BestOffset *bo)
 {
     int32_t codebook_min = codebook_extremes[codebook][0];
     int32_t codebook_max = codebook_extremes[codebook][1];
-    int32_t *sample_buffer = ctx->sample_buffer + channel;
-    DecodingParams *dp = ctx->cur_decoding_params;
     int codebook_offset  = 7 + (2 - codebook);
     int32_t unsign_offset = offset;
     int lsb_bits = 0, bitcount = 0;
@@ -1690,7 +1700,8 @@ static inline void codebook_bits_offset(MLPEncodeContext *ctx,
 /** Determines the least amount of bits needed to encode the samples using a
  *  given codebook. Searches for the best offset to minimize the bits.
  */
-static inline void codebook_bits(MLPEncodeContext *ctx,
+static inline void codebook_bits(MLPEncodeContext *ctx, DecodingParams *dp,
+                                 int32_t *sample_buffer,
                                  unsigned int channel, int codebook,
                                  int offset, int32_t min, int32_t max,
                                  BestOffset *bo, int direction)
@@ -1705,7 +1716,7 @@ static inline void codebook_bits(MLPEncodeContext *ctx,
     while (offset <= offset_max && offset >= offset_min) {
         BestOffset temp_bo;
 
-        codebook_bits_offset(ctx, channel, codebook,
+        codebook_bits_offset(ctx, dp, sample_buffer, channel, codebook,
                              min, max, offset,
                              &temp_bo);
 
@@ -1727,64 +1738,59 @@ static inline void codebook_bits(MLPEncodeContext *ctx,
     }
 }
 
-/** Determines the least amount of bits needed to encode the samples using
- *  any or no codebook.
+/** Determines the least amount of bits needed to encode the samples of one
+ *  channel using any or no codebook.
  */
-static void determine_bits(MLPEncodeContext *ctx)
+static void determine_bits(MLPEncodeContext *ctx, DecodingParams *dp,
+                           ChannelParams *cp, int32_t *sample_buffer,
+                           unsigned int channel, BestOffset *best_offset)
 {
-    DecodingParams *dp = ctx->cur_decoding_params;
-    RestartHeader  *rh = ctx->cur_restart_header;
-    unsigned int channel;
-
-    for (channel = 0; channel <= rh->max_channel; channel++) {
-        ChannelParams *cp = &ctx->cur_channel_params[channel];
-        int32_t *sample_buffer = ctx->sample_buffer + channel;
-        int32_t min = INT32_MAX, max = INT32_MIN;
-        int no_filters_used = !cp->filter_params[FIR].order;
-        int average = 0;
-        int offset = 0;
-        int i;
-
-        /* Determine extremes and average. */
-        for (i = 0; i < dp->blocksize; i++) {
-            int32_t sample = *sample_buffer >> dp->quant_step_size[channel];
-            if (sample < min)
-                min = sample;
-            if (sample > max)
-                max = sample;
-            average += sample;
-            sample_buffer += ctx->num_channels;
-        }
-        average /= dp->blocksize;
+    int32_t min = INT32_MAX, max = INT32_MIN;
+    int no_filters_used = !cp->filter_params[FIR].order;
+    int average = 0;
+    int offset = 0;
+    int i;
 
-        /* If filtering is used, we always set the offset to zero, otherwise
-         * we search for the offset that minimizes the bitcount. */
-        if (no_filters_used) {
-            no_codebook_bits(ctx, channel, min, max, &ctx->cur_best_offset[channel][0]);
-            offset = av_clip(average, HUFF_OFFSET_MIN, HUFF_OFFSET_MAX);
-        } else {
-            no_codebook_bits_offset(ctx, channel, offset, min, max, &ctx->cur_best_offset[channel][0]);
-        }
+    sample_buffer += channel;
 
-        for (i = 1; i < NUM_CODEBOOKS; i++) {
-            BestOffset temp_bo = { 0, INT_MAX, 0, 0, 0, };
-            int16_t offset_max;
+    /* Determine extremes and average. */
+    for (i = 0; i < dp->blocksize; i++) {
+        int32_t sample = sample_buffer[i * ctx->num_channels] >> dp->quant_step_size[channel];
+        if (sample < min)
+            min = sample;
+        if (sample > max)
+            max = sample;
+        average += sample;
+    }
+    average /= dp->blocksize;
+
+    /* If filtering is used, we always set the offset to zero, otherwise
+     * we search for the offset that minimizes the bitcount. */
+    if (no_filters_used) {
+        no_codebook_bits(dp, channel, min, max, &best_offset[0]);
+        offset = av_clip(average, HUFF_OFFSET_MIN, HUFF_OFFSET_MAX);
+    } else {
+        no_codebook_bits_offset(dp, channel, offset, min, max, &best_offset[0]);
+    }
 
-            codebook_bits_offset(ctx, channel, i - 1,
-                                 min, max, offset,
-                                 &temp_bo);
+    for (i = 1; i < NUM_CODEBOOKS; i++) {
+        BestOffset temp_bo = { 0, INT_MAX, 0, 0, 0, };
+        int16_t offset_max;
 
-            if (no_filters_used) {
-                offset_max = temp_bo.max;
+        codebook_bits_offset(ctx, dp, sample_buffer, channel, i - 1,
+                             min, max, offset,
+                             &temp_bo);
 
-                codebook_bits(ctx, channel, i - 1, temp_bo.min - 1,
-                            min, max, &temp_bo, 0);
-                codebook_bits(ctx, channel, i - 1, offset_max + 1,
-                            min, max, &temp_bo, 1);
-            }
+        if (no_filters_used) {
+            offset_max = temp_bo.max;
 
-            ctx->cur_best_offset[channel][i] = temp_bo;
+            codebook_bits(ctx, dp, sample_buffer, channel, i - 1, temp_bo.min - 1,
+                        min, max, &temp_bo, 0);
+            codebook_bits(ctx, dp, sample_buffer, channel, i - 1, offset_max + 1,
+                        min, max, &temp_bo, 1);
         }
+
+        best_offset[i] = temp_bo;
     }
 }
 
@@ -1874,20 +1880,28 @@ free_and_return:
     return ret;
 }
 
+static int apply_filters_channel(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    MLPEncodeContext *ctx = avctx->priv_data;
+    int channel = ctx->cur_restart_header->min_channel + jobnr;
+
+    if (apply_filter(ctx, channel) < 0) {
+        /* Filter is horribly wrong.
+         * Clear filter params and update state. */
+        set_filter_params(ctx, channel, FIR, 1);
+        set_filter_params(ctx, channel, IIR, 1);
+        apply_filter(ctx, channel);
+    }
+    return 0;
+}
+
 static void apply_filters(MLPEncodeContext *ctx)
 {
     RestartHeader *rh = ctx->cur_restart_header;
-    int channel;
-
-    for (channel = rh->min_channel; channel <= rh->max_channel; channel++) {
-        if (apply_filter(ctx, channel) < 0) {
-            /* Filter is horribly wrong.
-             * Clear filter params and update state. */
-            set_filter_params(ctx, channel, FIR, 1);
-            set_filter_params(ctx, channel, IIR, 1);
-            apply_filter(ctx, channel);
-        }
-    }
+
+    ctx->avctx->execute2(ctx->avctx, apply_filters_channel, NULL, NULL,
+                         rh->max_channel - rh->min_channel + 1);
 }
 
 /** Generates two noise channels worth of data. */
@@ -2000,82 +2014,77 @@ static int best_codebook_path_cost(MLPEncodeContext *ctx, unsigned int channel,
     return bitcount;
 }
 
-static void set_best_codebook(MLPEncodeContext *ctx)
+static void set_best_codebook(MLPEncodeContext *ctx, DecodingParams *dp,
+                              unsigned int channel)
 {
-    DecodingParams *dp = ctx->cur_decoding_params;
-    RestartHeader *rh = ctx->cur_restart_header;
-    unsigned int channel;
+    BestOffset *cur_bo, *prev_bo = restart_best_offset;
+    PathCounter path_counter[NUM_CODEBOOKS + 1];
+    unsigned int best_codebook;
+    unsigned int index;
+    char *best_path;
 
-    for (channel = rh->min_channel; channel <= rh->max_channel; channel++) {
-        BestOffset *cur_bo, *prev_bo = restart_best_offset;
-        PathCounter path_counter[NUM_CODEBOOKS + 1];
-        unsigned int best_codebook;
-        unsigned int index;
-        char *best_path;
+    clear_path_counter(path_counter);
 
-        clear_path_counter(path_counter);
+    for (index = 0; index < ctx->number_of_subblocks; index++) {
+        unsigned int best_bitcount = INT_MAX;
+        unsigned int codebook;
 
-        for (index = 0; index < ctx->number_of_subblocks; index++) {
-            unsigned int best_bitcount = INT_MAX;
-            unsigned int codebook;
-
-            cur_bo = ctx->best_offset[index][channel];
-
-            for (codebook = 0; codebook < NUM_CODEBOOKS; codebook++) {
-                int prev_best_bitcount = INT_MAX;
-                int last_best;
-
-                for (last_best = 0; last_best < 2; last_best++) {
-                    PathCounter *dst_path = &path_counter[codebook];
-                    PathCounter *src_path;
-                    int  temp_bitcount;
-
-                    /* First test last path with same headers,
-                     * then with last best. */
-                    if (last_best) {
-                        src_path = &path_counter[NUM_CODEBOOKS];
-                    } else {
-                        if (compare_best_offset(&prev_bo[codebook], &cur_bo[codebook]))
-                            continue;
-                        else
-                            src_path = &path_counter[codebook];
-                    }
-
-                    temp_bitcount = best_codebook_path_cost(ctx, channel, src_path, codebook);
-
-                    if (temp_bitcount < best_bitcount) {
-                        best_bitcount = temp_bitcount;
-                        best_codebook = codebook;
-                    }
-
-                    if (temp_bitcount < prev_best_bitcount) {
-                        prev_best_bitcount = temp_bitcount;
-                        if (src_path != dst_path)
-                            memcpy(dst_path, src_path, sizeof(PathCounter));
-                        av_strlcat(dst_path->path, path_counter_codebook[codebook], sizeof(dst_path->path));
-                        dst_path->bitcount = temp_bitcount;
-                    }
+        cur_bo = ctx->best_offset[index][channel];
+
+        for (codebook = 0; codebook < NUM_CODEBOOKS; codebook++) {
+            int prev_best_bitcount = INT_MAX;
+            int last_best;
+
+            for (last_best = 0; last_best < 2; last_best++) {
+                PathCounter *dst_path = &path_counter[codebook];
+                PathCounter *src_path;
+                int  temp_bitcount;
+
+                /* First test last path with same headers,
+                 * then with last best. */
+                if (last_best) {
+                    src_path = &path_counter[NUM_CODEBOOKS];
+                } else {
+                    if (compare_best_offset(&prev_bo[codebook], &cur_bo[codebook]))
+                        continue;
+                    else
+                        src_path = &path_counter[codebook];
                 }
-            }
 
-            prev_bo = cur_bo;
+                temp_bitcount = best_codebook_path_cost(ctx, channel, src_path, codebook);
 
-            memcpy(&path_counter[NUM_CODEBOOKS], &path_counter[best_codebook], sizeof(PathCounter));
+                if (temp_bitcount < best_bitcount) {
+                    best_bitcount = temp_bitcount;
+                    best_codebook = codebook;
+                }
+
+                if (temp_bitcount < prev_best_bitcount) {
+                    prev_best_bitcount = temp_bitcount;
+                    if (src_path != dst_path)
+                        memcpy(dst_path, src_path, sizeof(PathCounter));
+                    av_strlcat(dst_path->path, path_counter_codebook[codebook], sizeof(dst_path->path));
+                    dst_path->bitcount = temp_bitcount;
+                }
+            }
         }
 
-        best_path = path_counter[NUM_CODEBOOKS].path + 1;
+        prev_bo = cur_bo;
 
-        /* Update context. */
-        for (index = 0; index < ctx->number_of_subblocks; index++) {
-            ChannelParams *cp = ctx->seq_channel_params + index*(ctx->avctx->channels) + channel;
+        memcpy(&path_counter[NUM_CODEBOOKS], &path_counter[best_codebook], sizeof(PathCounter));
+    }
 
-            best_codebook = *best_path++ - ZERO_PATH;
-            cur_bo = &ctx->best_offset[index][channel][best_codebook];
+    best_path = path_counter[NUM_CODEBOOKS].path + 1;
 
-            cp->huff_offset      = cur_bo->offset;
-            cp->huff_lsbs        = cur_bo->lsb_bits + dp->quant_step_size[channel];
-            cp->codebook         = best_codebook;
-        }
+    /* Update context. */
+    for (index = 0; index < ctx->number_of_subblocks; index++) {
+        ChannelParams *cp = ctx->seq_channel_params + index*(ctx->avctx->channels) + channel;
+
+        best_codebook = *best_path++ - ZERO_PATH;
+        cur_bo = &ctx->best_offset[index][channel][best_codebook];
+
+        cp->huff_offset      = cur_bo->offset;
+        cp->huff_lsbs        = cur_bo->lsb_bits + dp->quant_step_size[channel];
+        cp->codebook         = best_codebook;
     }
 }
 
@@ -2143,6 +2152,34 @@ static void set_major_params(MLPEncodeContext *ctx)
     ctx->major_cur_subblock_index = 0;
 }
 
+/** Determines the bitcounts of one channel in all subblocks of the current
+ *  substream, and the best codebook path through them.
+ */
+static int analyze_channel_bits(AVCodecContext *avctx, void *arg,
+                                int channel, int threadnr)
+{
+    MLPEncodeContext *ctx = avctx->priv_data;
+    RestartHeader  *rh = ctx->cur_restart_header;
+    unsigned int substr = *(unsigned int *)arg;
+    int32_t *sample_buffer = ctx->sample_buffer;
+    DecodingParams *dp = NULL;
+    unsigned int index;
+
+    for (index = 0; index < ctx->number_of_subblocks; index++) {
+        ChannelParams *cp = ctx->seq_channel_params + index*(ctx->avctx->channels);
+
+        dp = ctx->seq_decoding_params + index*(ctx->num_substreams) + substr;
+        determine_bits(ctx, dp, &cp[channel], sample_buffer, channel,
+                       ctx->best_offset[index][channel]);
+        sample_buffer += dp->blocksize * ctx->num_channels;
+    }
+
+    if (channel >= rh->min_channel)
+        set_best_codebook(ctx, dp, channel);
+
+    return 0;
+}
+
 static void analyze_sample_buffer(MLPEncodeContext *ctx)
 {
     ChannelParams *seq_cp = ctx->seq_channel_params;
@@ -2179,15 +2216,15 @@ static void analyze_sample_buffer(MLPEncodeContext *ctx)
         (seq_dp + substr)->blocksize  = 8;
         (seq_dp + 1*(ctx->num_substreams) + substr)->blocksize -= 8;
 
+        /* Channels are independent from here on. */
+        ctx->avctx->execute2(ctx->avctx, analyze_channel_bits, &substr, NULL,
+                             ctx->cur_restart_header->max_channel + 1);
+
         for (index = 0; index < ctx->number_of_subblocks; index++) {
-                ctx->cur_decoding_params = seq_dp + index*(ctx->num_substreams) + substr;
-                ctx->cur_channel_params = seq_cp + index*(ctx->avctx->channels);
-                ctx->cur_best_offset = ctx->best_offset[index];
-                determine_bits(ctx);
-                ctx->sample_buffer += ctx->cur_decoding_params->blocksize * ctx->num_channels;
+            ctx->cur_decoding_params = seq_dp + index*(ctx->num_substreams) + substr;
+            ctx->cur_channel_params = seq_cp + index*(ctx->avctx->channels);
+            ctx->sample_buffer += ctx->cur_decoding_params->blocksize * ctx->num_channels;
         }
-
-        set_best_codebook(ctx);
     }
 }
 
@@ -2362,7 +2399,10 @@ static av_cold int mlp_encode_close(AVCodecContext *avctx)
 {
     MLPEncodeContext *ctx = avctx->priv_data;
 
-    ff_lpc_end(&ctx->lpc_ctx);
+    int ch;
+
+    for (ch = 0; ch < MAX_CHANNELS; ch++)
+        ff_lpc_end(&ctx->lpc_ctx[ch]);
 
     av_freep(&ctx->lossless_check_data);
     av_freep(&ctx->major_scratch_buffer);
@@ -2387,7 +2427,8 @@ AVCodec ff_mlp_encoder = {
     .init                   = mlp_encode_init,
     .encode2                = mlp_encode_frame,
     .close                  = mlp_encode_close,
-    .capabilities           = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_EXPERIMENTAL,
+    .capabilities           = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_EXPERIMENTAL |
+                              AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts            = (const enum AVSampleFormat[]) {AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE},
     .supported_samplerates  = (const int[]) {44100, 48000, 88200, 96000, 176400, 192000, 0},
     .channel_layouts        = ff_mlp_channel_layouts,
@@ -2403,7 +2444,8 @@ AVCodec ff_truehd_encoder = {
     .init                   = mlp_encode_init,
     .encode2                = mlp_encode_frame,
     .close                  = mlp_encode_close,
-    .capabilities           = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_EXPERIMENTAL,
+    .capabilities           = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_EXPERIMENTAL |
+                              AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts            = (const enum AVSampleFormat[]) {AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE},
     .supported_samplerates  = (const int[]) {44100, 48000, 88200, 96000, 176400, 192000, 0},
     .channel_layouts        = (const uint64_t[]) {AV_CH_LAYOUT_STEREO, AV_CH_LAYOUT_5POINT0_BACK, AV_CH_LAYOUT_5POINT1_BACK, 0},
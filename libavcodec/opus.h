@@ -129,6 +129,8 @@ typedef struct OpusStreamContext {
     int delayed_samples;
 
     OpusPacket packet;
+    /* data of the current sub-packet, NULL when flushing */
+    const uint8_t *packet_data;
 
     int redundancy_idx;
 } OpusStreamContext;
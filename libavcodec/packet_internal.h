@@ -27,4 +27,49 @@ int ff_side_data_set_encoder_stats(AVPacket *pkt, int quality, int64_t *error, i
 
 int ff_side_data_set_prft(AVPacket *pkt, int64_t timestamp);
 
+/**
+ * Size-classed pool of packet data buffers: buffers are rounded up to the
+ * next power of two and recycled through one AVBufferPool per size class,
+ * so that a context producing packets of varying sizes stops hitting the
+ * allocator once it has warmed up.
+ *
+ * Buffers may be unreferenced from any thread, but the functions below must
+ * only be called by the thread owning the pool; its counters are not
+ * atomic.
+ */
+typedef struct FFPacketPool FFPacketPool;
+
+FFPacketPool *avpriv_packet_pool_alloc(void);
+
+/**
+ * Free the pool and log its allocation counters to logctx. Buffers still
+ * referenced by packets stay valid.
+ */
+void avpriv_packet_pool_free(FFPacketPool **pool, void *logctx);
+
+/**
+ * Like av_new_packet(), but take the data from the pool.
+ * A NULL pool falls back to av_new_packet().
+ */
+int avpriv_packet_pool_new_packet(FFPacketPool *pool, AVPacket *pkt, int size);
+
+/**
+ * Like av_grow_packet(), but take a new buffer from the pool if the packet
+ * does not fit into its current one.
+ * A NULL pool falls back to av_grow_packet().
+ */
+int avpriv_packet_pool_grow_packet(FFPacketPool *pool, AVPacket *pkt, int grow_by);
+
+/**
+ * Like av_packet_make_refcounted(), but copy the data into a pooled buffer.
+ * A NULL pool falls back to av_packet_make_refcounted().
+ */
+int avpriv_packet_pool_make_refcounted(FFPacketPool *pool, AVPacket *pkt);
+
+/**
+ * Like av_packet_ref(), but copy non-refcounted data into a pooled buffer.
+ * A NULL pool falls back to av_packet_ref().
+ */
+int avpriv_packet_pool_ref(FFPacketPool *pool, AVPacket *dst, const AVPacket *src);
+
 #endif // AVCODEC_PACKET_INTERNAL_H
@@ -25,6 +25,7 @@
 #include "libavutil/lfg.h"
 #include "avcodec.h"
 #include "bytestream.h"
+#include "elbg.h"
 
 typedef struct roq_cell {
     unsigned char y[4];
@@ -57,6 +58,7 @@ typedef struct RoqContext {
 
     /* Encoder only data */
     AVLFG randctx;
+    ELBGThreadContext *elbg_threads;
     uint64_t lambda;
 
     motion_vect *this_motion4;
@@ -799,12 +799,12 @@ static int generate_codebook(RoqContext *enc, RoqTempdata *tempdata,
     } else
         closest_cb = tempdata->closest_cb2;
 
-    ret = avpriv_init_elbg(points, 6 * c_size, inputCount, codebook,
-                       cbsize, 1, closest_cb, &enc->randctx);
+    ret = avpriv_init_elbg2(enc->elbg_threads, points, 6 * c_size, inputCount,
+                            codebook, cbsize, 1, closest_cb, &enc->randctx);
     if (ret < 0)
         goto out;
-    ret = avpriv_do_elbg(points, 6 * c_size, inputCount, codebook,
-                     cbsize, 1, closest_cb, &enc->randctx);
+    ret = avpriv_do_elbg2(enc->elbg_threads, points, 6 * c_size, inputCount,
+                          codebook, cbsize, 1, closest_cb, &enc->randctx);
     if (ret < 0)
         goto out;
 
@@ -971,12 +971,15 @@ static av_cold int roq_encode_end(AVCodecContext *avctx)
     av_freep(&enc->this_motion8);
     av_freep(&enc->last_motion8);
 
+    avpriv_elbg_thread_free(&enc->elbg_threads);
+
     return 0;
 }
 
 static av_cold int roq_encode_init(AVCodecContext *avctx)
 {
     RoqContext *enc = avctx->priv_data;
+    int ret;
 
     av_lfg_init(&enc->randctx, 1);
 
@@ -1029,6 +1032,11 @@ static av_cold int roq_encode_init(AVCodecContext *avctx)
         return AVERROR(ENOMEM);
     }
 
+    if ((ret = avpriv_elbg_thread_alloc(&enc->elbg_threads, avctx->thread_count)) < 0) {
+        roq_encode_end(avctx);
+        return ret;
+    }
+
     return 0;
 }
 
@@ -1132,6 +1140,7 @@ AVCodec ff_roq_encoder = {
     .init                 = roq_encode_init,
     .encode2              = roq_encode_frame,
     .close                = roq_encode_end,
+    .capabilities         = AV_CODEC_CAP_AUTO_THREADS,
     .pix_fmts             = (const enum AVPixelFormat[]){ AV_PIX_FMT_YUVJ444P,
                                                         AV_PIX_FMT_NONE },
     .priv_class     = &roq_class,
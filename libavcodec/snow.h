@@ -143,6 +143,8 @@ typedef struct SnowContext{
     int ref_frames;
     int16_t (*ref_mvs[MAX_REF_FRAMES])[2];
     uint32_t *ref_scores[MAX_REF_FRAMES];
+    int16_t (*me_mvs)[MAX_REF_FRAMES][2]; ///< level 0 motion vectors of the row motion search, per reference
+    int (*me_scores)[MAX_REF_FRAMES];
     DWTELEM *spatial_dwt_buffer;
     DWTELEM *temp_dwt_buffer;
     IDWTELEM *spatial_idwt_buffer;
@@ -181,6 +183,8 @@ typedef struct SnowContext{
     int scenechange_threshold;
 
     MpegEncContext m; // needed for motion estimation, should not be used for anything else, the idea is to eventually make the motion estimation independent of MpegEncContext, so this will be removed then (FIXME/XXX)
+    MpegEncContext *me_threads; ///< copies of m for the slice threads after the first one
+    int nb_me_threads;
 
     uint8_t *scratchbuf;
     uint8_t *emu_edge_buffer;
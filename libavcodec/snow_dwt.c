@@ -282,8 +282,24 @@ static void vertical_decompose97iL1(DWTELEM *b0, DWTELEM *b1, DWTELEM *b2,
         b1[i] += (W_DM * (b0[i] + b2[i]) + W_DO) >> W_DS;
 }
 
-static void spatial_decompose97i(DWTELEM *buffer, DWTELEM *temp,
-                                 int width, int height, int stride)
+void ff_snow_vertical_decompose97i(DWTELEM *b0, DWTELEM *b1, DWTELEM *b2,
+                                   DWTELEM *b3, DWTELEM *b4, DWTELEM *b5,
+                                   int width)
+{
+    int i;
+
+    for (i = 0; i < width; i++) {
+        b4[i] -= (W_AM * (b3[i] + b5[i]) + W_AO) >> W_AS;
+        b3[i]  = (16 * 4 * b3[i] - 4 * (b2[i] + b4[i]) + W_BO * 5 + (5 << 27)) /
+                 (5 * 16) - (1 << 23);
+        b2[i] += (W_CM * (b1[i] + b3[i]) + W_CO) >> W_CS;
+        b1[i] += (W_DM * (b0[i] + b2[i]) + W_DO) >> W_DS;
+    }
+}
+
+static void spatial_decompose97i(SnowDWTContext *dsp, DWTELEM *buffer,
+                                 DWTELEM *temp, int width, int height,
+                                 int stride)
 {
     int y;
     DWTELEM *b0 = buffer + avpriv_mirror(-4 - 1, height - 1) * stride;
@@ -300,14 +316,18 @@ static void spatial_decompose97i(DWTELEM *buffer, DWTELEM *temp,
         if (y + 4 < (unsigned)height)
             horizontal_decompose97i(b5, temp, width);
 
-        if (y + 3 < (unsigned)height)
-            vertical_decompose97iH0(b3, b4, b5, width);
-        if (y + 2 < (unsigned)height)
-            vertical_decompose97iL0(b2, b3, b4, width);
-        if (y + 1 < (unsigned)height)
-            vertical_decompose97iH1(b1, b2, b3, width);
-        if (y + 0 < (unsigned)height)
-            vertical_decompose97iL1(b0, b1, b2, width);
+        if (y >= 0 && y + 4 < height) {
+            dsp->vertical_decompose97i(b0, b1, b2, b3, b4, b5, width);
+        } else {
+            if (y + 3 < (unsigned)height)
+                vertical_decompose97iH0(b3, b4, b5, width);
+            if (y + 2 < (unsigned)height)
+                vertical_decompose97iL0(b2, b3, b4, width);
+            if (y + 1 < (unsigned)height)
+                vertical_decompose97iH1(b1, b2, b3, width);
+            if (y + 0 < (unsigned)height)
+                vertical_decompose97iL1(b0, b1, b2, width);
+        }
 
         b0 = b2;
         b1 = b3;
@@ -316,15 +336,16 @@ static void spatial_decompose97i(DWTELEM *buffer, DWTELEM *temp,
     }
 }
 
-void ff_spatial_dwt(DWTELEM *buffer, DWTELEM *temp, int width, int height,
-                    int stride, int type, int decomposition_count)
+void ff_spatial_dwt(SnowDWTContext *dsp, DWTELEM *buffer, DWTELEM *temp,
+                    int width, int height, int stride, int type,
+                    int decomposition_count)
 {
     int level;
 
     for (level = 0; level < decomposition_count; level++) {
         switch (type) {
         case DWT_97:
-            spatial_decompose97i(buffer, temp,
+            spatial_decompose97i(dsp, buffer, temp,
                                  width >> level, height >> level,
                                  stride << level);
             break;
@@ -603,9 +624,9 @@ static void spatial_compose97i_dy_buffered(SnowDWTContext *dsp, DWTCompose *cs,
     cs->y  += 2;
 }
 
-static void spatial_compose97i_dy(DWTCompose *cs, IDWTELEM *buffer,
-                                  IDWTELEM *temp, int width, int height,
-                                  int stride)
+static void spatial_compose97i_dy(SnowDWTContext *dsp, DWTCompose *cs,
+                                  IDWTELEM *buffer, IDWTELEM *temp,
+                                  int width, int height, int stride)
 {
     int y        = cs->y;
     IDWTELEM *b0 = cs->b0;
@@ -615,19 +636,23 @@ static void spatial_compose97i_dy(DWTCompose *cs, IDWTELEM *buffer,
     IDWTELEM *b4 = buffer + avpriv_mirror(y + 3, height - 1) * stride;
     IDWTELEM *b5 = buffer + avpriv_mirror(y + 4, height - 1) * stride;
 
-    if (y + 3 < (unsigned)height)
-        vertical_compose97iL1(b3, b4, b5, width);
-    if (y + 2 < (unsigned)height)
-        vertical_compose97iH1(b2, b3, b4, width);
-    if (y + 1 < (unsigned)height)
-        vertical_compose97iL0(b1, b2, b3, width);
-    if (y + 0 < (unsigned)height)
-        vertical_compose97iH0(b0, b1, b2, width);
+    if (y > 0 && y + 4 < height) {
+        dsp->vertical_compose97i(b0, b1, b2, b3, b4, b5, width);
+    } else {
+        if (y + 3 < (unsigned)height)
+            vertical_compose97iL1(b3, b4, b5, width);
+        if (y + 2 < (unsigned)height)
+            vertical_compose97iH1(b2, b3, b4, width);
+        if (y + 1 < (unsigned)height)
+            vertical_compose97iL0(b1, b2, b3, width);
+        if (y + 0 < (unsigned)height)
+            vertical_compose97iH0(b0, b1, b2, width);
+    }
 
     if (y - 1 < (unsigned)height)
-        ff_snow_horizontal_compose97i(b0, temp, width);
+        dsp->horizontal_compose97i(b0, temp, width);
     if (y + 0 < (unsigned)height)
-        ff_snow_horizontal_compose97i(b1, temp, width);
+        dsp->horizontal_compose97i(b1, temp, width);
 
     cs->b0  = b2;
     cs->b1  = b3;
@@ -703,9 +728,9 @@ static void spatial_idwt_init(DWTCompose *cs, IDWTELEM *buffer, int width,
     }
 }
 
-static void spatial_idwt_slice(DWTCompose *cs, IDWTELEM *buffer,
-                                  IDWTELEM *temp, int width, int height,
-                                  int stride, int type,
+static void spatial_idwt_slice(SnowDWTContext *dsp, DWTCompose *cs,
+                                  IDWTELEM *buffer, IDWTELEM *temp,
+                                  int width, int height, int stride, int type,
                                   int decomposition_count, int y)
 {
     const int support = type == 1 ? 3 : 5;
@@ -717,8 +742,9 @@ static void spatial_idwt_slice(DWTCompose *cs, IDWTELEM *buffer,
         while (cs[level].y <= FFMIN((y >> level) + support, height >> level)) {
             switch (type) {
             case DWT_97:
-                spatial_compose97i_dy(cs + level, buffer, temp, width >> level,
-                                      height >> level, stride << level);
+                spatial_compose97i_dy(dsp, cs + level, buffer, temp,
+                                      width >> level, height >> level,
+                                      stride << level);
                 break;
             case DWT_53:
                 spatial_compose53i_dy(cs + level, buffer, temp, width >> level,
@@ -728,15 +754,16 @@ static void spatial_idwt_slice(DWTCompose *cs, IDWTELEM *buffer,
         }
 }
 
-void ff_spatial_idwt(IDWTELEM *buffer, IDWTELEM *temp, int width, int height,
-                     int stride, int type, int decomposition_count)
+void ff_spatial_idwt(SnowDWTContext *dsp, IDWTELEM *buffer, IDWTELEM *temp,
+                     int width, int height, int stride, int type,
+                     int decomposition_count)
 {
     DWTCompose cs[MAX_DECOMPOSITIONS];
     int y;
     spatial_idwt_init(cs, buffer, width, height, stride, type,
                          decomposition_count);
     for (y = 0; y < height; y += 4)
-        spatial_idwt_slice(cs, buffer, temp, width, height, stride, type,
+        spatial_idwt_slice(dsp, cs, buffer, temp, width, height, stride, type,
                               decomposition_count, y);
 }
 
@@ -746,6 +773,9 @@ static inline int w_c(struct MpegEncContext *v, uint8_t *pix1, uint8_t *pix2, pt
     int s, i, j;
     const int dec_count = w == 8 ? 3 : 4;
     int tmp[32 * 32], tmp2[32];
+    SnowDWTContext dsp = {
+        .vertical_decompose97i = ff_snow_vertical_decompose97i,
+    };
     int level, ori;
     static const int scale[2][2][4][4] = {
         {
@@ -787,7 +817,7 @@ static inline int w_c(struct MpegEncContext *v, uint8_t *pix1, uint8_t *pix2, pt
         pix2 += line_size;
     }
 
-    ff_spatial_dwt(tmp, tmp2, w, h, 32, type, dec_count);
+    ff_spatial_dwt(&dsp, tmp, tmp2, w, h, 32, type, dec_count);
 
     s = 0;
     av_assert1(w == h);
@@ -852,6 +882,7 @@ av_cold void ff_dwt_init(SnowDWTContext *c)
     c->vertical_compose97i   = ff_snow_vertical_compose97i;
     c->horizontal_compose97i = ff_snow_horizontal_compose97i;
     c->inner_add_yblock      = ff_snow_inner_add_yblock;
+    c->vertical_decompose97i = ff_snow_vertical_decompose97i;
 
     if (HAVE_MMX)
         ff_dwt_init_x86(c);
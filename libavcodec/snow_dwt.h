@@ -62,6 +62,9 @@ typedef struct SnowDWTContext {
                              uint8_t **block, int b_w, int b_h, int src_x,
                              int src_y, int src_stride, slice_buffer *sb,
                              int add, uint8_t *dst8);
+    void (*vertical_decompose97i)(DWTELEM *b0, DWTELEM *b1, DWTELEM *b2,
+                                  DWTELEM *b3, DWTELEM *b4, DWTELEM *b5,
+                                  int width);
 } SnowDWTContext;
 
 
@@ -103,6 +106,9 @@ void ff_snow_vertical_compose97i(IDWTELEM *b0, IDWTELEM *b1, IDWTELEM *b2,
                                  IDWTELEM *b3, IDWTELEM *b4, IDWTELEM *b5,
                                  int width);
 void ff_snow_horizontal_compose97i(IDWTELEM *b, IDWTELEM *temp, int width);
+void ff_snow_vertical_decompose97i(DWTELEM *b0, DWTELEM *b1, DWTELEM *b2,
+                                   DWTELEM *b3, DWTELEM *b4, DWTELEM *b5,
+                                   int width);
 void ff_snow_inner_add_yblock(const uint8_t *obmc, const int obmc_stride,
                               uint8_t **block, int b_w, int b_h, int src_x,
                               int src_y, int src_stride, slice_buffer *sb,
@@ -111,8 +117,8 @@ void ff_snow_inner_add_yblock(const uint8_t *obmc, const int obmc_stride,
 int ff_w53_32_c(struct MpegEncContext *v, uint8_t *pix1, uint8_t *pix2, ptrdiff_t line_size, int h);
 int ff_w97_32_c(struct MpegEncContext *v, uint8_t *pix1, uint8_t *pix2, ptrdiff_t line_size, int h);
 
-void ff_spatial_dwt(int *buffer, int *temp, int width, int height, int stride,
-                    int type, int decomposition_count);
+void ff_spatial_dwt(SnowDWTContext *dsp, int *buffer, int *temp, int width,
+                    int height, int stride, int type, int decomposition_count);
 
 void ff_spatial_idwt_buffered_init(DWTCompose *cs, slice_buffer *sb, int width,
                                    int height, int stride_line, int type,
@@ -121,8 +127,9 @@ void ff_spatial_idwt_buffered_slice(SnowDWTContext *dsp, DWTCompose *cs,
                                     slice_buffer *slice_buf, IDWTELEM *temp,
                                     int width, int height, int stride_line,
                                     int type, int decomposition_count, int y);
-void ff_spatial_idwt(IDWTELEM *buffer, IDWTELEM *temp, int width, int height,
-                     int stride, int type, int decomposition_count);
+void ff_spatial_idwt(SnowDWTContext *dsp, IDWTELEM *buffer, IDWTELEM *temp,
+                     int width, int height, int stride, int type,
+                     int decomposition_count);
 
 void ff_dwt_init(SnowDWTContext *c);
 void ff_dwt_init_x86(SnowDWTContext *c);
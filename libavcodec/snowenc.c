@@ -158,6 +158,28 @@ FF_ENABLE_DEPRECATION_WARNINGS
         }
     }
 
+    s->me_mvs    = av_mallocz_array(s->b_width * s->b_height, sizeof(*s->me_mvs));
+    s->me_scores = av_mallocz_array(s->b_width * s->b_height, sizeof(*s->me_scores));
+    if (!s->me_mvs || !s->me_scores)
+        return AVERROR(ENOMEM);
+
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        s->me_threads = av_mallocz_array(avctx->thread_count - 1, sizeof(*s->me_threads));
+        if (!s->me_threads)
+            return AVERROR(ENOMEM);
+        s->nb_me_threads = avctx->thread_count - 1;
+        for (i = 0; i < s->nb_me_threads; i++) {
+            MotionEstContext *c = &s->me_threads[i].me;
+
+            c->temp      =
+            c->scratchpad= av_mallocz_array((avctx->width+64), 2*16*2*sizeof(uint8_t));
+            c->map       = av_mallocz(ME_MAP_SIZE*sizeof(uint32_t));
+            c->score_map = av_mallocz(ME_MAP_SIZE*sizeof(uint32_t));
+            if (!c->scratchpad || !c->map || !c->score_map)
+                return AVERROR(ENOMEM);
+        }
+    }
+
     return 0;
 }
 
@@ -226,55 +248,54 @@ static inline int get_penalty_factor(int lambda, int lambda2, int type){
 #define P_MV1 P[9]
 #define FLAG_QPEL   1 //must be 1
 
-static int encode_q_branch(SnowContext *s, int level, int x, int y){
-    uint8_t p_buffer[1024];
-    uint8_t i_buffer[1024];
-    uint8_t p_state[sizeof(s->block_state)];
-    uint8_t i_state[sizeof(s->block_state)];
-    RangeCoder pc, ic;
-    uint8_t *pbbak= s->c.bytestream;
-    uint8_t *pbbak_start= s->c.bytestream_start;
-    int score, score2, iscore, i_len, p_len, block_s, sum, base_bits;
+/* Set up the search range and penalties of m for the block at x, y. */
+static void init_block_search(SnowContext *s, MpegEncContext *m, int level, int x, int y)
+{
     const int w= s->b_width  << s->block_max_depth;
     const int h= s->b_height << s->block_max_depth;
-    const int rem_depth= s->block_max_depth - level;
-    const int index= (x + y*w) << rem_depth;
     const int block_w= 1<<(LOG2_MB_SIZE - level);
-    int trx= (x+1)<<rem_depth;
-    int try= (y+1)<<rem_depth;
-    const BlockNode *left  = x ? &s->block[index-1] : &null_block;
-    const BlockNode *top   = y ? &s->block[index-w] : &null_block;
-    const BlockNode *right = trx<w ? &s->block[index+1] : &null_block;
-    const BlockNode *bottom= try<h ? &s->block[index+w] : &null_block;
-    const BlockNode *tl    = y && x ? &s->block[index-w-1] : left;
-    const BlockNode *tr    = y && trx<w && ((x&1)==0 || level==0) ? &s->block[index-w+(1<<rem_depth)] : tl; //FIXME use lt
-    int pl = left->color[0];
-    int pcb= left->color[1];
-    int pcr= left->color[2];
-    int pmx, pmy;
-    int mx=0, my=0;
-    int l,cr,cb;
+    MotionEstContext *c= &m->me;
+
+    m->mb_stride=2;
+    m->mb_x=
+    m->mb_y= 0;
+    c->skip= 0;
+
+    av_assert1(c->  stride == s->current_picture->linesize[0]);
+    av_assert1(c->uvstride == s->current_picture->linesize[1]);
+
+    c->penalty_factor    = get_penalty_factor(s->lambda, s->lambda2, c->avctx->me_cmp);
+    c->sub_penalty_factor= get_penalty_factor(s->lambda, s->lambda2, c->avctx->me_sub_cmp);
+    c->mb_penalty_factor = get_penalty_factor(s->lambda, s->lambda2, c->avctx->mb_cmp);
+    c->current_mv_penalty= c->mv_penalty[m->f_code=1] + MAX_DMV;
+
+    c->xmin = - x*block_w - 16+3;
+    c->ymin = - y*block_w - 16+3;
+    c->xmax = - (x+1)*block_w + (w<<(LOG2_MB_SIZE - s->block_max_depth)) + 16-3;
+    c->ymax = - (y+1)*block_w + (h<<(LOG2_MB_SIZE - s->block_max_depth)) + 16-3;
+}
+
+/* Search the best motion vector of a block for each reference frame,
+ * left, top and tr give the predictors and last_mv the previous vectors of
+ * the block and of its right and bottom neighbours. */
+static void motion_search_block(SnowContext *s, MpegEncContext *m, int level, int x, int y,
+                                const BlockNode *left, const BlockNode *top,
+                                const BlockNode *tr, int16_t last_mv[3][2],
+                                int16_t mvs[MAX_REF_FRAMES][2], int scores[MAX_REF_FRAMES])
+{
+    const int block_w= 1<<(LOG2_MB_SIZE - level);
     const int stride= s->current_picture->linesize[0];
     const int uvstride= s->current_picture->linesize[1];
     uint8_t *current_data[3]= { s->input_picture->data[0] + (x + y*  stride)*block_w,
                                 s->input_picture->data[1] + ((x*block_w)>>s->chroma_h_shift) + ((y*uvstride*block_w)>>s->chroma_v_shift),
                                 s->input_picture->data[2] + ((x*block_w)>>s->chroma_h_shift) + ((y*uvstride*block_w)>>s->chroma_v_shift)};
     int P[10][2];
-    int16_t last_mv[3][2];
     int qpel= !!(s->avctx->flags & AV_CODEC_FLAG_QPEL); //unused
     const int shift= 1+qpel;
-    MotionEstContext *c= &s->m.me;
-    int ref_context= av_log2(2*left->ref) + av_log2(2*top->ref);
-    int mx_context= av_log2(2*FFABS(left->mx - top->mx));
-    int my_context= av_log2(2*FFABS(left->my - top->my));
-    int s_context= 2*left->level + 2*top->level + tl->level + tr->level;
-    int ref, best_ref, ref_score, ref_mx, ref_my;
+    MotionEstContext *c= &m->me;
+    int ref, ref_score, ref_mx, ref_my;
 
-    av_assert0(sizeof(s->block_state) >= 256);
-    if(s->keyframe){
-        set_blocks(s, level, x, y, pl, pcb, pcr, 0, 0, 0, BLOCK_INTRA);
-        return 0;
-    }
+    init_block_search(s, m, level, x, y);
 
 //    clip predictors / edge ?
 
@@ -285,31 +306,6 @@ static int encode_q_branch(SnowContext *s, int level, int x, int y){
     P_TOPRIGHT[0]= tr->mx;
     P_TOPRIGHT[1]= tr->my;
 
-    last_mv[0][0]= s->block[index].mx;
-    last_mv[0][1]= s->block[index].my;
-    last_mv[1][0]= right->mx;
-    last_mv[1][1]= right->my;
-    last_mv[2][0]= bottom->mx;
-    last_mv[2][1]= bottom->my;
-
-    s->m.mb_stride=2;
-    s->m.mb_x=
-    s->m.mb_y= 0;
-    c->skip= 0;
-
-    av_assert1(c->  stride ==   stride);
-    av_assert1(c->uvstride == uvstride);
-
-    c->penalty_factor    = get_penalty_factor(s->lambda, s->lambda2, c->avctx->me_cmp);
-    c->sub_penalty_factor= get_penalty_factor(s->lambda, s->lambda2, c->avctx->me_sub_cmp);
-    c->mb_penalty_factor = get_penalty_factor(s->lambda, s->lambda2, c->avctx->mb_cmp);
-    c->current_mv_penalty= c->mv_penalty[s->m.f_code=1] + MAX_DMV;
-
-    c->xmin = - x*block_w - 16+3;
-    c->ymin = - y*block_w - 16+3;
-    c->xmax = - (x+1)*block_w + (w<<(LOG2_MB_SIZE - s->block_max_depth)) + 16-3;
-    c->ymax = - (y+1)*block_w + (h<<(LOG2_MB_SIZE - s->block_max_depth)) + 16-3;
-
     if(P_LEFT[0]     > (c->xmax<<shift)) P_LEFT[0]    = (c->xmax<<shift);
     if(P_LEFT[1]     > (c->ymax<<shift)) P_LEFT[1]    = (c->ymax<<shift);
     if(P_TOP[0]      > (c->xmax<<shift)) P_TOP[0]     = (c->xmax<<shift);
@@ -329,12 +325,10 @@ static int encode_q_branch(SnowContext *s, int level, int x, int y){
         c->pred_y = P_MEDIAN[1];
     }
 
-    score= INT_MAX;
-    best_ref= 0;
     for(ref=0; ref<s->ref_frames; ref++){
         init_ref(c, current_data, s->last_picture[ref]->data, NULL, block_w*x, block_w*y, 0);
 
-        ref_score= ff_epzs_motion_search(&s->m, &ref_mx, &ref_my, P, 0, /*ref_index*/ 0, last_mv,
+        ref_score= ff_epzs_motion_search(m, &ref_mx, &ref_my, P, 0, /*ref_index*/ 0, last_mv,
                                          (1<<16)>>shift, level-LOG2_MB_SIZE+4, block_w);
 
         av_assert2(ref_mx >= c->xmin);
@@ -342,21 +336,181 @@ static int encode_q_branch(SnowContext *s, int level, int x, int y){
         av_assert2(ref_my >= c->ymin);
         av_assert2(ref_my <= c->ymax);
 
-        ref_score= c->sub_motion_search(&s->m, &ref_mx, &ref_my, ref_score, 0, 0, level-LOG2_MB_SIZE+4, block_w);
-        ref_score= ff_get_mb_score(&s->m, ref_mx, ref_my, 0, 0, level-LOG2_MB_SIZE+4, block_w, 0);
+        ref_score= c->sub_motion_search(m, &ref_mx, &ref_my, ref_score, 0, 0, level-LOG2_MB_SIZE+4, block_w);
+        ref_score= ff_get_mb_score(m, ref_mx, ref_my, 0, 0, level-LOG2_MB_SIZE+4, block_w, 0);
         ref_score+= 2*av_log2(2*ref)*c->penalty_factor;
+        mvs[ref][0]= ref_mx;
+        mvs[ref][1]= ref_my;
+        scores[ref]= ref_score;
+    }
+}
+
+/* Search the top level blocks of one row. The rows do not depend on each
+ * other: the top predictors are the blocks of the previous frame, so the
+ * result does not depend on the number of threads. */
+static int motion_search_row(AVCodecContext *avctx, void *arg, int y, int threadnr)
+{
+    SnowContext *s = avctx->priv_data;
+    MpegEncContext *m = threadnr ? &s->me_threads[threadnr - 1] : &s->m;
+    const int w= s->b_width  << s->block_max_depth;
+    const int h= s->b_height << s->block_max_depth;
+    const int rem_depth= s->block_max_depth;
+    BlockNode left= null_block;
+    int x, ref;
+
+    for(x=0; x<s->b_width; x++){
+        const int index= (x + y*w) << rem_depth;
+        const int bi= x + y*s->b_width;
+        int trx= (x+1)<<rem_depth;
+        int try= (y+1)<<rem_depth;
+        const BlockNode *top   = y ? &s->block[index-w] : &null_block;
+        const BlockNode *right = trx<w ? &s->block[index+1] : &null_block;
+        const BlockNode *bottom= try<h ? &s->block[index+w] : &null_block;
+        const BlockNode *tl    = y && x ? &s->block[index-w-1] : &left;
+        const BlockNode *tr    = y && trx<w ? &s->block[index-w+(1<<rem_depth)] : tl;
+        int16_t last_mv[3][2]= { { s->block[index].mx, s->block[index].my },
+                                 { right->mx, right->my },
+                                 { bottom->mx, bottom->my } };
+        int score= INT_MAX;
+
+        motion_search_block(s, m, 0, x, y, &left, top, tr, last_mv,
+                            s->me_mvs[bi], s->me_scores[bi]);
+        for(ref=0; ref<s->ref_frames; ref++){
+            if(score > s->me_scores[bi][ref]){
+                score  = s->me_scores[bi][ref];
+                left.mx= s->me_mvs[bi][ref][0];
+                left.my= s->me_mvs[bi][ref][1];
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void update_me_thread(MpegEncContext *dst, const MpegEncContext *src)
+{
+    MotionEstContext bak= dst->me;
+
+    memcpy(dst, src, sizeof(*dst));
+    dst->me.scratchpad    = bak.scratchpad;
+    dst->me.temp          = bak.temp;
+    dst->me.map           = bak.map;
+    dst->me.score_map     = bak.score_map;
+    dst->me.map_generation= bak.map_generation;
+}
+
+/* The top level motion vectors are searched for all rows first, in
+ * parallel; encode_q_branch() then only makes the coding decisions. */
+static void motion_search(SnowContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_me_threads; i++)
+        update_me_thread(&s->me_threads[i], &s->m);
+    s->avctx->execute2(s->avctx, motion_search_row, NULL, NULL, s->b_height);
+}
+
+static int encode_q_branch(SnowContext *s, int level, int x, int y){
+    uint8_t p_buffer[1024];
+    uint8_t i_buffer[1024];
+    uint8_t p_state[sizeof(s->block_state)];
+    uint8_t i_state[sizeof(s->block_state)];
+    RangeCoder pc, ic;
+    uint8_t *pbbak= s->c.bytestream;
+    uint8_t *pbbak_start= s->c.bytestream_start;
+    int score, score2, iscore, i_len, p_len, block_s, sum, base_bits;
+    const int w= s->b_width  << s->block_max_depth;
+    const int h= s->b_height << s->block_max_depth;
+    const int rem_depth= s->block_max_depth - level;
+    const int index= (x + y*w) << rem_depth;
+    const int block_w= 1<<(LOG2_MB_SIZE - level);
+    int trx= (x+1)<<rem_depth;
+    int try= (y+1)<<rem_depth;
+    const BlockNode *left  = x ? &s->block[index-1] : &null_block;
+    const BlockNode *top   = y ? &s->block[index-w] : &null_block;
+    const BlockNode *right = trx<w ? &s->block[index+1] : &null_block;
+    const BlockNode *bottom= try<h ? &s->block[index+w] : &null_block;
+    const BlockNode *tl    = y && x ? &s->block[index-w-1] : left;
+    const BlockNode *tr    = y && trx<w && ((x&1)==0 || level==0) ? &s->block[index-w+(1<<rem_depth)] : tl; //FIXME use lt
+    int pl = left->color[0];
+    int pcb= left->color[1];
+    int pcr= left->color[2];
+    int pmx, pmy;
+    int mx=0, my=0;
+    int l,cr,cb;
+    const int stride= s->current_picture->linesize[0];
+    const int uvstride= s->current_picture->linesize[1];
+    uint8_t *current_data[3]= { s->input_picture->data[0] + (x + y*  stride)*block_w,
+                                s->input_picture->data[1] + ((x*block_w)>>s->chroma_h_shift) + ((y*uvstride*block_w)>>s->chroma_v_shift),
+                                s->input_picture->data[2] + ((x*block_w)>>s->chroma_h_shift) + ((y*uvstride*block_w)>>s->chroma_v_shift)};
+    int16_t level_mvs[MAX_REF_FRAMES][2], (*mvs)[2];
+    int level_scores[MAX_REF_FRAMES], *scores;
+    MotionEstContext *c= &s->m.me;
+    int ref_context= av_log2(2*left->ref) + av_log2(2*top->ref);
+    int mx_context= av_log2(2*FFABS(left->mx - top->mx));
+    int my_context= av_log2(2*FFABS(left->my - top->my));
+    int s_context= 2*left->level + 2*top->level + tl->level + tr->level;
+    int ref, best_ref;
+
+    av_assert0(sizeof(s->block_state) >= 256);
+    if(s->keyframe){
+        set_blocks(s, level, x, y, pl, pcb, pcr, 0, 0, 0, BLOCK_INTRA);
+        return 0;
+    }
+
+    if(level){
+        int16_t last_mv[3][2]= { { s->block[index].mx, s->block[index].my },
+                                 { right->mx, right->my },
+                                 { bottom->mx, bottom->my } };
+
+        motion_search_block(s, &s->m, level, x, y, left, top, tr, last_mv,
+                            level_mvs, level_scores);
+        mvs   = level_mvs;
+        scores= level_scores;
+    }else{
+        mvs   = s->me_mvs   [x + y*s->b_width];
+        scores= s->me_scores[x + y*s->b_width];
+    }
+
+    score= INT_MAX;
+    best_ref= 0;
+    for(ref=0; ref<s->ref_frames; ref++){
         if(s->ref_mvs[ref]){
-            s->ref_mvs[ref][index][0]= ref_mx;
-            s->ref_mvs[ref][index][1]= ref_my;
-            s->ref_scores[ref][index]= ref_score;
+            s->ref_mvs[ref][index][0]= mvs[ref][0];
+            s->ref_mvs[ref][index][1]= mvs[ref][1];
+            s->ref_scores[ref][index]= scores[ref];
         }
-        if(score > ref_score){
-            score= ref_score;
+        if(score > scores[ref]){
+            score= scores[ref];
             best_ref= ref;
-            mx= ref_mx;
-            my= ref_my;
+            mx= mvs[ref][0];
+            my= mvs[ref][1];
         }
     }
+    if(!level){
+        const int shift= 1 + !!(s->avctx->flags & AV_CODEC_FLAG_QPEL);
+
+        /* The row search did not know the final neighbours of the block,
+         * so also try the vector they predict, which needs no bits. */
+        pred_mv(s, &pmx, &pmy, best_ref, left, top, tr);
+        init_block_search(s, &s->m, level, x, y);
+        if((pmx != mx || pmy != my) &&
+           pmx >= c->xmin * (1<<shift) && pmx <= (c->xmax<<shift) &&
+           pmy >= c->ymin * (1<<shift) && pmy <= (c->ymax<<shift)){
+            int pscore;
+
+            init_ref(c, current_data, s->last_picture[best_ref]->data, NULL, block_w*x, block_w*y, 0);
+            pscore = ff_get_mb_score(&s->m, pmx, pmy, 0, 0, level-LOG2_MB_SIZE+4, block_w, 0);
+            pscore+= 2*av_log2(2*best_ref)*c->penalty_factor;
+            if(pscore <= score + (c->current_mv_penalty[mx - pmx] +
+                                  c->current_mv_penalty[my - pmy]) * c->sub_penalty_factor){
+                score= pscore;
+                mx= pmx;
+                my= pmy;
+            }
+        }
+    }
+
     //FIXME if mb_cmp != SSE then intra cannot be compared currently and mb_penalty vs. lambda2
 
   //  subpel search
@@ -1227,6 +1381,8 @@ static void encode_blocks(SnowContext *s, int search){
     int w= s->b_width;
     int h= s->b_height;
 
+    if(!s->keyframe && search)
+        motion_search(s);
     if(s->motion_est == FF_ME_ITER && !s->keyframe && search)
         iterative_me(s);
 
@@ -1551,7 +1707,8 @@ static void calculate_visual_weight(SnowContext *s, Plane *p){
 
             memset(s->spatial_idwt_buffer, 0, sizeof(*s->spatial_idwt_buffer)*width*height);
             ibuf[b->width/2 + b->height/2*b->stride]= 256*16;
-            ff_spatial_idwt(s->spatial_idwt_buffer, s->temp_idwt_buffer, width, height, width, s->spatial_decomposition_type, s->spatial_decomposition_count);
+            ff_spatial_idwt(&s->dwt, s->spatial_idwt_buffer, s->temp_idwt_buffer, width, height, width, s->spatial_decomposition_type, s->spatial_decomposition_count);
+            emms_c();
             for(y=0; y<height; y++){
                 for(x=0; x<width; x++){
                     int64_t d= s->spatial_idwt_buffer[x + y*width]*16;
@@ -1792,7 +1949,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 }
             }
 
-            ff_spatial_dwt(s->spatial_dwt_buffer, s->temp_dwt_buffer, w, h, w, s->spatial_decomposition_type, s->spatial_decomposition_count);
+            ff_spatial_dwt(&s->dwt, s->spatial_dwt_buffer, s->temp_dwt_buffer, w, h, w, s->spatial_decomposition_type, s->spatial_decomposition_count);
 
             if(s->pass1_rc && plane_index==0){
                 int delta_qlog = ratecontrol_1pass(s, pic);
@@ -1831,7 +1988,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 }
             }
 
-            ff_spatial_idwt(s->spatial_idwt_buffer, s->temp_idwt_buffer, w, h, w, s->spatial_decomposition_type, s->spatial_decomposition_count);
+            ff_spatial_idwt(&s->dwt, s->spatial_idwt_buffer, s->temp_idwt_buffer, w, h, w, s->spatial_decomposition_type, s->spatial_decomposition_count);
             if(s->qlog == LOSSLESS_QLOG){
                 for(y=0; y<h; y++){
                     for(x=0; x<w; x++){
@@ -1923,9 +2080,18 @@ FF_ENABLE_DEPRECATION_WARNINGS
 static av_cold int encode_end(AVCodecContext *avctx)
 {
     SnowContext *s = avctx->priv_data;
+    int i;
 
     ff_snow_common_end(s);
     ff_rate_control_uninit(&s->m);
+    for (i = 0; i < s->nb_me_threads; i++) {
+        av_freep(&s->me_threads[i].me.scratchpad);
+        av_freep(&s->me_threads[i].me.map);
+        av_freep(&s->me_threads[i].me.score_map);
+    }
+    av_freep(&s->me_threads);
+    av_freep(&s->me_mvs);
+    av_freep(&s->me_scores);
     av_frame_free(&s->input_picture);
     av_freep(&avctx->stats_out);
 
@@ -1967,6 +2133,7 @@ AVCodec ff_snow_encoder = {
     .init           = encode_init,
     .encode2        = encode_frame,
     .close          = encode_end,
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]){
         AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV410P, AV_PIX_FMT_YUV444P,
         AV_PIX_FMT_GRAY8,
@@ -21,6 +21,7 @@
 #include <inttypes.h>
 #include <string.h>
 #include "libavcodec/avcodec.h"
+#include "libavcodec/packet_internal.h"
 #include "libavutil/error.h"
 
 
@@ -80,6 +81,64 @@ static int initializations(AVPacket* avpkt)
     return ret;
 }
 
+static int test_packet_pool(const AVPacket *src)
+{
+    FFPacketPool *pool = avpriv_packet_pool_alloc();
+    AVPacket pkt;
+    uint8_t *data;
+    int ret = 0;
+
+    if (!pool)
+        return 1;
+
+    /* test avpriv_packet_pool_ref */
+    if (avpriv_packet_pool_ref(pool, &pkt, src) < 0 || !pkt.buf ||
+        pkt.size != src->size || memcmp(pkt.data, src->data, src->size) ||
+        pkt.pts != src->pts || pkt.side_data_elems != src->side_data_elems) {
+        printf("avpriv_packet_pool_ref failed\n");
+        ret = 1;
+    }
+    /* a released buffer must be handed out again for the same size class */
+    data = pkt.data;
+    av_packet_unref(&pkt);
+    if (avpriv_packet_pool_new_packet(pool, &pkt, src->size + 1) < 0 ||
+        pkt.data != data) {
+        printf("avpriv_packet_pool_new_packet did not recycle the buffer\n");
+        ret = 1;
+    }
+    av_packet_unref(&pkt);
+    /* test avpriv_packet_pool_grow_packet, in place and into a new buffer */
+    if (avpriv_packet_pool_new_packet(pool, &pkt, 1) < 0) {
+        printf("avpriv_packet_pool_new_packet failed\n");
+        ret = 1;
+    } else {
+        pkt.data[0] = 0x5a;
+        data = pkt.data;
+        if (avpriv_packet_pool_grow_packet(pool, &pkt, 10) < 0 ||
+            pkt.data != data || pkt.size != 11 || pkt.data[0] != 0x5a) {
+            printf("avpriv_packet_pool_grow_packet did not grow in place\n");
+            ret = 1;
+        }
+        if (avpriv_packet_pool_grow_packet(pool, &pkt, 1000) < 0 ||
+            pkt.size != 1011 || pkt.data[0] != 0x5a ||
+            pkt.data[pkt.size + AV_INPUT_BUFFER_PADDING_SIZE - 1]) {
+            printf("avpriv_packet_pool_grow_packet failed\n");
+            ret = 1;
+        }
+    }
+    av_packet_unref(&pkt);
+    if (avpriv_packet_pool_new_packet(pool, &pkt, INT_MAX) == 0) {
+        printf("avpriv_packet_pool_new_packet failed to return error "
+               "when \"size\" parameter is too large.\n");
+        ret = 1;
+    }
+    av_packet_unref(&pkt);
+
+    avpriv_packet_pool_free(&pool, NULL);
+
+    return ret;
+}
+
 int main(void)
 {
     AVPacket avpkt;
@@ -119,6 +178,9 @@ int main(void)
                 "when \"size\" parameter is too large.\n" );
         ret = 1;
     }
+    /* test the packet pool */
+    ret |= test_packet_pool(&avpkt);
+
     /*clean up*/
     av_packet_free(&avpkt_clone);
     av_packet_unref(&avpkt);
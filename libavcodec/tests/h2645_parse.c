@@ -0,0 +1,179 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+
+#include "libavcodec/avcodec.h"
+#include "libavcodec/h2645_parse.h"
+#include "libavcodec/internal.h"
+#include "libavcodec/startcode.h"
+
+#define MAX_SIZE 4096
+
+/* Byte stream with many zeros, start codes and escapes */
+static void fill(AVLFG *lfg, uint8_t *buf, int size)
+{
+    int density = av_lfg_get(lfg) % 4;
+    int i;
+
+    for (i = 0; i < size; i++) {
+        unsigned r = av_lfg_get(lfg);
+        if (density == 0 || r % (4 << density * 3))
+            buf[i] = r >> 8;
+        else
+            buf[i] = (r >> 8) % 4;
+    }
+    memset(buf + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+}
+
+static int ref_extract_rbsp(const uint8_t *src, int length, uint8_t *dst,
+                            int *dst_size, int *skipped_pos, int *nb_skipped)
+{
+    int si = 0, di = 0;
+
+    *nb_skipped = 0;
+    while (si + 2 < length) {
+        if (!src[si] && !src[si + 1] && src[si + 2] == 3) {
+            dst[di++] = 0;
+            dst[di++] = 0;
+            si += 3;
+            skipped_pos[(*nb_skipped)++] = di - 1;
+            continue;
+        }
+        if (!src[si] && !src[si + 1] && (src[si + 2] == 1 || src[si + 2] == 2))
+            goto end;
+        dst[di++] = src[si++];
+    }
+    while (si < length)
+        dst[di++] = src[si++];
+end:
+    *dst_size = di;
+    return si;
+}
+
+static const uint8_t *ref_find_start_code(const uint8_t *p, const uint8_t *end,
+                                          uint32_t *state)
+{
+    while (p < end) {
+        uint32_t tmp = *state << 8;
+        *state = tmp + *p++;
+        if (tmp == 0x100)
+            return p;
+    }
+    return end;
+}
+
+static int test_extract_rbsp(const uint8_t *buf, int size)
+{
+    static uint8_t ref[MAX_SIZE];
+    static int ref_skipped[MAX_SIZE];
+    H2645RBSP rbsp = { 0 };
+    H2645NAL nal   = { 0 };
+    int small_padding, ref_size, ref_nb_skipped, ref_consumed, consumed, ret = 0;
+
+    ref_consumed = ref_extract_rbsp(buf, size, ref, &ref_size,
+                                    ref_skipped, &ref_nb_skipped);
+
+    rbsp.rbsp_buffer = av_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    nal.skipped_bytes_pos_size = 1;
+    nal.skipped_bytes_pos = av_malloc_array(1, sizeof(*nal.skipped_bytes_pos));
+    if (!rbsp.rbsp_buffer || !nal.skipped_bytes_pos) {
+        ret = -1;
+        goto end;
+    }
+
+    for (small_padding = 0; small_padding < 2; small_padding++) {
+        rbsp.rbsp_buffer_size = 0;
+        consumed = ff_h2645_extract_rbsp(buf, size, &rbsp, &nal, small_padding);
+        if (consumed != ref_consumed || nal.raw_size != ref_consumed ||
+            nal.size != ref_size || memcmp(nal.data, ref, ref_size) ||
+            nal.skipped_bytes != ref_nb_skipped ||
+            memcmp(nal.skipped_bytes_pos, ref_skipped,
+                   ref_nb_skipped * sizeof(*ref_skipped))) {
+            fprintf(stderr, "extract_rbsp mismatch: size %d small_padding %d: "
+                    "consumed %d/%d size %d/%d skipped %d/%d\n",
+                    size, small_padding, consumed, ref_consumed, nal.size,
+                    ref_size, nal.skipped_bytes, ref_nb_skipped);
+            ret = -1;
+        }
+    }
+
+end:
+    av_freep(&rbsp.rbsp_buffer);
+    av_freep(&nal.skipped_bytes_pos);
+    return ret;
+}
+
+static int test_find_start_code(const uint8_t *buf, int size, uint32_t state)
+{
+    const uint8_t *p = buf, *q = buf, *end = buf + size;
+    uint32_t ref_state = state;
+
+    while (p < end) {
+        p = avpriv_find_start_code(p, end, &state);
+        q = ref_find_start_code(q, end, &ref_state);
+        if (p != q || state != ref_state) {
+            fprintf(stderr, "find_start_code mismatch: size %d: "
+                    "%td/%td state %08x/%08x\n",
+                    size, p - buf, q - buf, state, ref_state);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int test_find_candidate(const uint8_t *buf, int size)
+{
+    int i, ref;
+
+    for (i = 0; i < size; i = ref + 1) {
+        for (ref = i; ref < size && buf[ref]; ref++)
+            ;
+        if (i + ff_startcode_find_candidate_c(buf + i, size - i) != ref) {
+            fprintf(stderr, "find_candidate mismatch: size %d offset %d\n", size, i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static uint8_t buf[MAX_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
+    AVLFG lfg;
+    int i, ret = 0;
+
+    av_lfg_init(&lfg, 0x2645);
+
+    for (i = 0; i < 2000; i++) {
+        int size = av_lfg_get(&lfg) % (i < 1000 ? 32 : MAX_SIZE);
+
+        fill(&lfg, buf, size);
+        ret |= test_extract_rbsp(buf, size);
+        ret |= test_find_start_code(buf, size, av_lfg_get(&lfg) & 1 ? 0x100 : -1);
+        ret |= test_find_candidate(buf, size);
+        if (ret)
+            break;
+    }
+
+    return !!ret;
+}
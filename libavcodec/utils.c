@@ -622,6 +622,14 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
     if ((ret = av_opt_set_dict(avctx, &tmp)) < 0)
         goto free_and_end;
 
+    if (avctx->flags2 & AV_CODEC_FLAG2_POOL_PACKETS) {
+        avci->packet_pool = avpriv_packet_pool_alloc();
+        if (!avci->packet_pool) {
+            ret = AVERROR(ENOMEM);
+            goto free_and_end;
+        }
+    }
+
     if (avctx->codec_whitelist && av_match_list(codec->name, avctx->codec_whitelist, ',') <= 0) {
         av_log(avctx, AV_LOG_ERROR, "Codec (%s) not on whitelist \'%s\'\n", codec->name, avctx->codec_whitelist);
         ret = AVERROR(EINVAL);
@@ -1054,6 +1062,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
         av_bsf_free(&avci->bsf);
 
         av_buffer_unref(&avci->pool);
+        avpriv_packet_pool_free(&avci->packet_pool, avctx);
     }
     av_freep(&avci);
     avctx->internal = NULL;
@@ -1154,6 +1163,7 @@ av_cold int avcodec_close(AVCodecContext *avctx)
         av_frame_free(&avctx->internal->es.in_frame);
 
         av_buffer_unref(&avctx->internal->pool);
+        avpriv_packet_pool_free(&avctx->internal->packet_pool, avctx);
 
         if (avctx->hwaccel && avctx->hwaccel->uninit)
             avctx->hwaccel->uninit(avctx);
@@ -1968,14 +1978,19 @@ const uint8_t *avpriv_find_start_code(const uint8_t *av_restrict p,
             return p;
     }
 
+    /* Look for the 0x01 of the start code rather than its zeros: it is as
+     * rare as a zero in coded data, but does not occur in zero stuffing.
+     * p[-1] is the last byte of the next candidate. */
     while (p < end) {
-        if      (p[-1] > 1      ) p += 3;
-        else if (p[-2]          ) p += 2;
-        else if (p[-3]|(p[-1]-1)) p++;
-        else {
-            p++;
+        const uint8_t *one = memchr(p - 1, 1, end - p + 1);
+
+        if (!one) {
+            p = end;
             break;
         }
+        p = one + 2;
+        if (!one[-2] && !one[-1])
+            break;
     }
 
     p = FFMIN(p, end) - 4;
@@ -64,6 +64,12 @@ enum {
 /* Mapping of libavcodec prediction modes to Ut Video's */
 extern const int ff_ut_pred_order[5];
 
+typedef struct HuffEntry {
+    uint16_t sym;
+    uint8_t  len;
+    uint32_t code;
+} HuffEntry;
+
 typedef struct UtvideoContext {
     const AVClass *class;
     AVCodecContext *avctx;
@@ -89,13 +95,15 @@ typedef struct UtvideoContext {
     size_t packed_stream_size[4][256];
     const uint8_t *control_stream[4][256];
     size_t control_stream_size[4][256];
-} UtvideoContext;
 
-typedef struct HuffEntry {
-    uint16_t sym;
-    uint8_t  len;
-    uint32_t code;
-} HuffEntry;
+    /* encoder state shared by the slice jobs */
+    const AVFrame *pic;
+    uint8_t *pred_buffer[4];
+    uint32_t (*slice_counts)[256];
+    uint8_t *slice_dst[4][256];
+    int      slice_dst_size[4][256];
+    HuffEntry he[4][256];
+} UtvideoContext;
 
 /* Compare huffman tree nodes */
 int ff_ut_huff_cmp_len(const void *a, const void *b);
@@ -37,6 +37,9 @@
 #include "utvideo.h"
 #include "huffman.h"
 
+/* Space between slices in pred_buffer for the SIMD predictors' overwrite */
+#define SLICE_GAP 32
+
 /* Compare huffentry symbols */
 static int huff_cmp_sym(const void *a, const void *b)
 {
@@ -49,9 +52,11 @@ static av_cold int utvideo_encode_close(AVCodecContext *avctx)
     UtvideoContext *c = avctx->priv_data;
     int i;
 
-    av_freep(&c->slice_bits);
-    for (i = 0; i < 4; i++)
+    av_freep(&c->slice_counts);
+    for (i = 0; i < 4; i++) {
         av_freep(&c->slice_buffer[i]);
+        av_freep(&c->pred_buffer[i]);
+    }
 
     return 0;
 }
@@ -181,10 +186,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
     }
 
     for (i = 0; i < c->planes; i++) {
-        c->slice_buffer[i] = av_malloc(c->slice_stride * (avctx->height + 2) +
-                                       AV_INPUT_BUFFER_PADDING_SIZE);
-        if (!c->slice_buffer[i]) {
-            av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 1.\n");
+        /* The mangled RGB planes are the prediction source */
+        if (original_format == UTVIDEO_RGB || original_format == UTVIDEO_RGBA) {
+            c->slice_buffer[i] = av_malloc(c->slice_stride * (avctx->height + 2) +
+                                           AV_INPUT_BUFFER_PADDING_SIZE);
+            if (!c->slice_buffer[i]) {
+                av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 1.\n");
+                utvideo_encode_close(avctx);
+                return AVERROR(ENOMEM);
+            }
+        }
+        c->pred_buffer[i] = av_malloc(avctx->width * avctx->height +
+                                      256 * SLICE_GAP + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!c->pred_buffer[i]) {
+            av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 2.\n");
             utvideo_encode_close(avctx);
             return AVERROR(ENOMEM);
         }
@@ -223,6 +238,13 @@ FF_ENABLE_DEPRECATION_WARNINGS
         c->slices = avctx->slices;
     }
 
+    /* Symbol counts of every slice, merged per plane before building the tables */
+    c->slice_counts = av_malloc_array(c->planes * c->slices, sizeof(*c->slice_counts));
+    if (!c->slice_counts) {
+        utvideo_encode_close(avctx);
+        return AVERROR(ENOMEM);
+    }
+
     /* Set compression mode */
     c->compression = COMP_HUFF;
 
@@ -320,9 +342,9 @@ static void median_predict(UtvideoContext *c, uint8_t *src, uint8_t *dst,
     }
 }
 
-/* Count the usage of values in a plane */
+/* Count the usage of values in a slice */
 static void count_usage(uint8_t *src, int width,
-                        int height, uint64_t *counts)
+                        int height, uint32_t *counts)
 {
     int i, j;
 
@@ -388,56 +410,151 @@ static int write_huff_codes(uint8_t *src, uint8_t *dst, int dst_size,
     return count;
 }
 
-static int encode_plane(AVCodecContext *avctx, uint8_t *src,
-                        uint8_t *dst, ptrdiff_t stride, int plane_no,
-                        int width, int height, PutByteContext *pb)
+/* Get the source and the dimensions of a plane */
+static void get_plane(AVCodecContext *avctx, int plane_no, uint8_t **src,
+                      ptrdiff_t *stride, int *width, int *height)
 {
-    UtvideoContext *c        = avctx->priv_data;
-    uint8_t  lengths[256];
-    uint64_t counts[256]     = { 0 };
+    UtvideoContext *c = avctx->priv_data;
 
-    HuffEntry he[256];
+    *width  = avctx->width;
+    *height = avctx->height;
 
-    uint32_t offset = 0, slice_len = 0;
-    const int cmask = ~(!plane_no && avctx->pix_fmt == AV_PIX_FMT_YUV420P);
-    int      i, sstart, send = 0;
-    int      symbol;
-    int      ret;
+    if (avctx->pix_fmt == AV_PIX_FMT_GBRAP || avctx->pix_fmt == AV_PIX_FMT_GBRP) {
+        *src    = c->slice_buffer[plane_no] + 2 * c->slice_stride;
+        *stride = c->slice_stride;
+        return;
+    }
+
+    if (avctx->pix_fmt != AV_PIX_FMT_YUV444P)
+        *width  >>= !!plane_no;
+    if (avctx->pix_fmt == AV_PIX_FMT_YUV420P)
+        *height >>= !!plane_no;
+    *src    = c->pic->data[plane_no];
+    *stride = c->pic->linesize[plane_no];
+}
+
+/* Get the first and the last + 1 line of a slice */
+static void get_slice_lines(AVCodecContext *avctx, int plane_no, int slice,
+                            int height, int *sstart, int *send)
+{
+    UtvideoContext *c = avctx->priv_data;
+    const int cmask   = ~(!plane_no && avctx->pix_fmt == AV_PIX_FMT_YUV420P);
+
+    *sstart = height *  slice      / c->slices & cmask;
+    *send   = height * (slice + 1) / c->slices & cmask;
+}
+
+/* Get the predicted data of a slice */
+static uint8_t *get_slice_pred(UtvideoContext *c, int plane_no, int slice,
+                               int sstart, int width)
+{
+    return c->pred_buffer[plane_no] + sstart * width + slice * SLICE_GAP;
+}
+
+/* Mangle the RGB lines of one slice to Ut Video's format */
+static int mangle_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    UtvideoContext *c  = avctx->priv_data;
+    const AVFrame *pic = c->pic;
+    uint8_t *dst[4], *src[4];
+    int i, sstart, send;
+
+    get_slice_lines(avctx, 0, jobnr, avctx->height, &sstart, &send);
+
+    for (i = 0; i < c->planes; i++) {
+        dst[i] = c->slice_buffer[i] + sstart * c->slice_stride;
+        src[i] = pic->data[i] + sstart * pic->linesize[i];
+    }
+    mangle_rgb_planes(dst, c->slice_stride, src, c->planes, pic->linesize,
+                      avctx->width, send - sstart);
+
+    return 0;
+}
+
+/* Predict one slice of a plane and count the usage of the resulting values */
+static int predict_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    UtvideoContext *c  = avctx->priv_data;
+    const int plane_no = jobnr / c->slices;
+    const int slice    = jobnr % c->slices;
+    uint32_t *counts   = c->slice_counts[jobnr];
+    uint8_t *src, *dst;
+    ptrdiff_t stride;
+    int width, height, sstart, send;
+
+    get_plane(avctx, plane_no, &src, &stride, &width, &height);
+    get_slice_lines(avctx, plane_no, slice, height, &sstart, &send);
+
+    src += sstart * stride;
+    dst  = get_slice_pred(c, plane_no, slice, sstart, width);
 
-    /* Do prediction / make planes */
     switch (c->frame_pred) {
     case PRED_NONE:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices & cmask;
-            av_image_copy_plane(dst + sstart * width, width,
-                                src + sstart * stride, stride,
-                                width, send - sstart);
-        }
+        av_image_copy_plane(dst, width, src, stride, width, send - sstart);
         break;
     case PRED_LEFT:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices & cmask;
-            c->llvidencdsp.sub_left_predict(dst + sstart * width, src + sstart * stride, stride, width, send - sstart);
-        }
+        c->llvidencdsp.sub_left_predict(dst, src, stride, width, send - sstart);
         break;
     case PRED_MEDIAN:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices & cmask;
-            median_predict(c, src + sstart * stride, dst + sstart * width,
-                           stride, width, send - sstart);
-        }
+        median_predict(c, src, dst, stride, width, send - sstart);
         break;
-    default:
-        av_log(avctx, AV_LOG_ERROR, "Unknown prediction mode: %d\n",
-               c->frame_pred);
-        return AVERROR_OPTION_NOT_FOUND;
     }
 
-    /* Count the usage of values */
-    count_usage(dst, width, height, counts);
+    memset(counts, 0, sizeof(*c->slice_counts));
+    count_usage(dst, width, send - sstart, counts);
+
+    return 0;
+}
+
+/* Write the Huffman codes of one slice directly into the output packet */
+static int encode_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    UtvideoContext *c  = avctx->priv_data;
+    const int plane_no = jobnr / c->slices;
+    const int slice    = jobnr % c->slices;
+    uint8_t *dst       = c->slice_dst[plane_no][slice];
+    int size           = c->slice_dst_size[plane_no][slice];
+    uint8_t *src;
+    ptrdiff_t stride;
+    int width, height, sstart, send;
+
+    if (!size)
+        return 0;
+
+    get_plane(avctx, plane_no, &src, &stride, &width, &height);
+    get_slice_lines(avctx, plane_no, slice, height, &sstart, &send);
+
+    write_huff_codes(get_slice_pred(c, plane_no, slice, sstart, width), dst, size,
+                     width, send - sstart, c->he[plane_no]);
+
+    /* Byteswap the written huffman codes */
+    c->bdsp.bswap_buf((uint32_t *) dst, (uint32_t *) dst, size >> 2);
+
+    return 0;
+}
+
+/*
+ * Build the Huffman table of a plane from the merged slice counts, write the
+ * plane header and reserve the space of each slice in the output packet.
+ */
+static int encode_plane(AVCodecContext *avctx, int plane_no,
+                        int width, int height, PutByteContext *pb)
+{
+    UtvideoContext *c        = avctx->priv_data;
+    uint32_t (*slice_counts)[256] = c->slice_counts + plane_no * c->slices;
+    uint8_t  lengths[256];
+    uint64_t counts[256]     = { 0 };
+    HuffEntry *he            = c->he[plane_no];
+
+    uint32_t offset = 0;
+    int      i, j;
+    int      symbol;
+    int      ret;
+
+    /* Merge the usage of values */
+    for (i = 0; i < c->slices; i++)
+        for (j = 0; j < 256; j++)
+            counts[j] += slice_counts[i][j];
 
     /* Check for a special case where only one symbol was used */
     for (symbol = 0; symbol < 256; symbol++) {
@@ -457,8 +574,10 @@ static int encode_plane(AVCodecContext *avctx, uint8_t *src,
                 }
 
                 /* Write zeroes for lengths */
-                for (i = 0; i < c->slices; i++)
+                for (i = 0; i < c->slices; i++) {
                     bytestream2_put_le32(pb, 0);
+                    c->slice_dst_size[plane_no][i] = 0;
+                }
 
                 /* And that's all for that plane folks */
                 return 0;
@@ -474,7 +593,7 @@ static int encode_plane(AVCodecContext *avctx, uint8_t *src,
     /*
      * Write the plane's header into the output packet:
      * - huffman code lengths (256 bytes)
-     * - slice end offsets (gotten from the slice lengths)
+     * - slice end offsets (computed from the slice counts)
      */
     for (i = 0; i < 256; i++) {
         bytestream2_put_byte(pb, lengths[i]);
@@ -486,45 +605,33 @@ static int encode_plane(AVCodecContext *avctx, uint8_t *src,
     /* Calculate the huffman codes themselves */
     calculate_codes(he);
 
-    send = 0;
+    /*
+     * The size of every slice is known from its counts, so each slice
+     * can be coded in place once all the offsets are written.
+     */
     for (i = 0; i < c->slices; i++) {
-        sstart  = send;
-        send    = height * (i + 1) / c->slices & cmask;
+        uint64_t bits = 0;
 
-        /*
-         * Write the huffman codes to a buffer,
-         * get the offset in bits and convert to bytes.
-         */
-        offset += write_huff_codes(dst + sstart * width, c->slice_bits,
-                                   width * height + 4, width,
-                                   send - sstart, he) >> 3;
+        for (j = 0; j < 256; j++)
+            bits += slice_counts[i][j] * (uint64_t)lengths[j];
 
-        slice_len = offset - slice_len;
-
-        /* Byteswap the written huffman codes */
-        c->bdsp.bswap_buf((uint32_t *) c->slice_bits,
-                          (uint32_t *) c->slice_bits,
-                          slice_len >> 2);
+        /* Slices are padded to a 32-bit boundary */
+        c->slice_dst_size[plane_no][i] = (bits + 31) >> 5 << 2;
+        offset += c->slice_dst_size[plane_no][i];
 
         /* Write the offset to the stream */
         bytestream2_put_le32(pb, offset);
+    }
 
-        /* Seek to the data part of the packet */
-        bytestream2_seek_p(pb, 4 * (c->slices - i - 1) +
-                           offset - slice_len, SEEK_CUR);
-
-        /* Write the slices' data into the output packet */
-        bytestream2_put_buffer(pb, c->slice_bits, slice_len);
-
-        /* Seek back to the slice offsets */
-        bytestream2_seek_p(pb, -4 * (c->slices - i - 1) - offset,
-                           SEEK_CUR);
-
-        slice_len = offset;
+    if (bytestream2_get_bytes_left_p(pb) < offset) {
+        av_log(avctx, AV_LOG_ERROR, "Output packet too small.\n");
+        return AVERROR_BUG;
     }
 
-    /* And at the end seek to the end of written slice(s) */
-    bytestream2_seek_p(pb, offset, SEEK_CUR);
+    for (i = 0; i < c->slices; i++) {
+        c->slice_dst[plane_no][i] = pb->buffer;
+        bytestream2_skip_p(pb, c->slice_dst_size[plane_no][i]);
+    }
 
     return 0;
 }
@@ -537,7 +644,8 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     uint32_t frame_info;
 
-    uint8_t *dst;
+    uint8_t *dst, *src;
+    ptrdiff_t stride;
 
     int width = avctx->width, height = avctx->height;
     int i, ret = 0;
@@ -553,73 +661,33 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     bytestream2_init_writer(&pb, dst, pkt->size);
 
-    av_fast_padded_malloc(&c->slice_bits, &c->slice_bits_size, width * height + 4);
-
-    if (!c->slice_bits) {
-        av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 2.\n");
-        return AVERROR(ENOMEM);
-    }
+    c->pic = pic;
 
     /* In case of RGB, mangle the planes to Ut Video's format */
     if (avctx->pix_fmt == AV_PIX_FMT_GBRAP || avctx->pix_fmt == AV_PIX_FMT_GBRP)
-        mangle_rgb_planes(c->slice_buffer, c->slice_stride, pic->data,
-                          c->planes, pic->linesize, width, height);
+        avctx->execute2(avctx, mangle_slice, NULL, NULL, c->slices);
 
-    /* Deal with the planes */
-    switch (avctx->pix_fmt) {
-    case AV_PIX_FMT_GBRP:
-    case AV_PIX_FMT_GBRAP:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, c->slice_buffer[i] + 2 * c->slice_stride,
-                               c->slice_buffer[i], c->slice_stride, i,
-                               width, height, &pb);
-
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV444P:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], i, width, height, &pb);
+    /*
+     * Deal with the planes: all slices of all planes are predicted and
+     * counted independently, then the tables are built serially from the
+     * merged counts and finally every slice is coded into its place.
+     */
+    avctx->execute2(avctx, predict_slice, NULL, NULL, c->planes * c->slices);
 
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV422P:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], i, width >> !!i, height, &pb);
+    for (i = 0; i < c->planes; i++) {
+        get_plane(avctx, i, &src, &stride, &width, &height);
+        ret = encode_plane(avctx, i, width, height, &pb);
 
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
+        if (ret) {
+            av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
+            return ret;
         }
-        break;
-    case AV_PIX_FMT_YUV420P:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], i, width >> !!i, height >> !!i,
-                               &pb);
-
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
-        }
-        break;
-    default:
-        av_log(avctx, AV_LOG_ERROR, "Unknown pixel format: %d\n",
-               avctx->pix_fmt);
-        return AVERROR_INVALIDDATA;
     }
 
+    avctx->execute2(avctx, encode_slice, NULL, NULL, c->planes * c->slices);
+
+    c->pic = NULL;
+
     /*
      * Write frame information (LE 32-bit unsigned)
      * into the output packet.
@@ -677,7 +745,7 @@ AVCodec ff_utvideo_encoder = {
     .init           = utvideo_encode_init,
     .encode2        = utvideo_encode_frame,
     .close          = utvideo_encode_close,
-    .capabilities   = AV_CODEC_CAP_FRAME_THREADS,
+    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]) {
                           AV_PIX_FMT_GBRP, AV_PIX_FMT_GBRAP, AV_PIX_FMT_YUV422P,
                           AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV444P, AV_PIX_FMT_NONE
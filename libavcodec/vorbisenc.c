@@ -43,6 +43,19 @@
 #undef NDEBUG
 #include <assert.h>
 
+#define MAX_CHANNELS     2
+#define MAX_CODEBOOK_DIM 8
+
+#define MAX_FLOOR_CLASS_DIM  4
+#define NUM_FLOOR_PARTITIONS 8
+#define MAX_FLOOR_VALUES     (MAX_FLOOR_CLASS_DIM*NUM_FLOOR_PARTITIONS+2)
+
+#define RESIDUE_SIZE           1600
+#define RESIDUE_PART_SIZE      32
+#define NUM_RESIDUE_PARTITIONS (RESIDUE_SIZE/RESIDUE_PART_SIZE)
+
+#define NUM_RESIDUE_PASSES     8
+
 typedef struct vorbis_enc_codebook {
     int nentries;
     uint8_t *lens;
@@ -55,6 +68,8 @@ typedef struct vorbis_enc_codebook {
     int *quantlist;
     float *dimensions;
     float *pow2;
+    int lattice_vals; ///< per-dimension values of a lattice (lookup 1) book, 0 otherwise
+    float *lattice;   ///< the lattice_vals scalar values every dimension is made of
 } vorbis_enc_codebook;
 
 typedef struct vorbis_enc_floor_class {
@@ -136,18 +151,12 @@ typedef struct vorbis_enc_context {
     int64_t next_pts;
 
     AVFloatDSPContext *fdsp;
-} vorbis_enc_context;
-
-#define MAX_CHANNELS     2
-#define MAX_CODEBOOK_DIM 8
-
-#define MAX_FLOOR_CLASS_DIM  4
-#define NUM_FLOOR_PARTITIONS 8
-#define MAX_FLOOR_VALUES     (MAX_FLOOR_CLASS_DIM*NUM_FLOOR_PARTITIONS+2)
 
-#define RESIDUE_SIZE           1600
-#define RESIDUE_PART_SIZE      32
-#define NUM_RESIDUE_PARTITIONS (RESIDUE_SIZE/RESIDUE_PART_SIZE)
+    /* residue partitions are searched by slice jobs, then written in order */
+    vorbis_enc_residue *cur_residue;
+    int res_classes[NUM_RESIDUE_PARTITIONS];
+    uint16_t res_entries[NUM_RESIDUE_PARTITIONS][NUM_RESIDUE_PASSES][RESIDUE_PART_SIZE / 2];
+} vorbis_enc_context;
 
 static inline int put_codeword(PutBitContext *pb, vorbis_enc_codebook *cb,
                                int entry)
@@ -176,6 +185,8 @@ static int ready_codebook(vorbis_enc_codebook *cb)
 
     ff_vorbis_len2vlc(cb->lens, cb->codewords, cb->nentries);
 
+    cb->lattice      = NULL;
+    cb->lattice_vals = 0;
     if (!cb->lookup) {
         cb->pow2 = cb->dimensions = NULL;
     } else {
@@ -203,6 +214,18 @@ static int ready_codebook(vorbis_enc_codebook *cb)
             }
             cb->pow2[i] /= 2.0;
         }
+
+        /* Without sequence_p a lookup 1 book is the cartesian product of
+         * the same scalar values in every dimension, so the nearest entry
+         * can be searched one dimension at a time. */
+        if (cb->lookup == 1 && !cb->seq_p) {
+            cb->lattice = av_malloc_array(vals, sizeof(*cb->lattice));
+            if (!cb->lattice)
+                return AVERROR(ENOMEM);
+            for (i = 0; i < vals; i++)
+                cb->lattice[i] = cb->min + cb->quantlist[i] * cb->delta;
+            cb->lattice_vals = vals;
+        }
     }
     return 0;
 }
@@ -775,13 +798,18 @@ static void floor_fit(vorbis_enc_context *venc, vorbis_enc_floor *fc,
     for (i = 0; i < fc->values; i++) {
         int position  = fc->list[fc->list[i].sort].x;
         float average = averages[i];
-        int j;
+        int lo = 0, hi = range - 1;
 
         average = sqrt(tot_average * average) * pow(1.25f, position*0.005f); // MAGIC!
-        for (j = 0; j < range - 1; j++)
-            if (ff_vorbis_floor1_inverse_db_table[j * fc->multiplier] > average)
-                break;
-        posts[fc->list[i].sort] = j;
+        // the table is increasing: find the first post above average
+        while (lo < hi) {
+            int mid = (lo + hi) >> 1;
+            if (ff_vorbis_floor1_inverse_db_table[mid * fc->multiplier] > average)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        posts[fc->list[i].sort] = lo;
     }
 }
 
@@ -879,12 +907,34 @@ static int floor_encode(vorbis_enc_context *venc, vorbis_enc_floor *fc,
     return 0;
 }
 
-static float *put_vector(vorbis_enc_codebook *book, PutBitContext *pb,
-                         float *num)
+static int nearest_entry(const vorbis_enc_codebook *book, const float *num)
 {
     int i, entry = -1;
     float distance = FLT_MAX;
     assert(book->dimensions);
+
+    if (book->lattice_vals) {
+        int j, k, mul = 1;
+        entry = 0;
+        for (j = 0; j < book->ndimensions; j++) {
+            float best = FLT_MAX;
+            int val = 0;
+            for (k = 0; k < book->lattice_vals; k++) {
+                float d = book->lattice[k] - num[j];
+                if (best > d * d) {
+                    best = d * d;
+                    val  = k;
+                }
+            }
+            entry += val * mul;
+            mul   *= book->lattice_vals;
+        }
+        // sparse books leave parts of the lattice unused
+        if (entry < book->nentries && book->lens[entry])
+            return entry;
+        entry = -1;
+    }
+
     for (i = 0; i < book->nentries; i++) {
         float * vec = book->dimensions + i * book->ndimensions, d = book->pow2[i];
         int j;
@@ -897,100 +947,121 @@ static float *put_vector(vorbis_enc_codebook *book, PutBitContext *pb,
             distance = d;
         }
     }
-    if (put_codeword(pb, book, entry))
-        return NULL;
-    return &book->dimensions[entry * book->ndimensions];
+    return entry;
+}
+
+/**
+ * Classify one residue partition and quantize it in all passes, leaving the
+ * chosen entries in res_entries. Partitions are independent of each other.
+ */
+static void residue_search_partition(vorbis_enc_context *venc,
+                                     vorbis_enc_residue *rc, float *coeffs,
+                                     int samples, int real_ch, int p)
+{
+    int psize = rc->partition_size;
+    int s     = rc->begin + p * psize;
+    float max1 = 0.0, max2 = 0.0;
+    int pass, i, k;
+
+    for (k = s; k < s + psize; k += 2) {
+        max1 = FFMAX(max1, fabs(coeffs[          k / real_ch]));
+        max2 = FFMAX(max2, fabs(coeffs[samples + k / real_ch]));
+    }
+
+    for (i = 0; i < rc->classifications - 1; i++)
+        if (max1 < rc->maxes[i][0] && max2 < rc->maxes[i][1])
+            break;
+    venc->res_classes[p] = i;
+
+    for (pass = 0; pass < NUM_RESIDUE_PASSES; pass++) {
+        int nbook = rc->books[venc->res_classes[p]][pass];
+        vorbis_enc_codebook * book;
+        int a1, b1, n = 0;
+        if (nbook == -1)
+            continue;
+        book = &venc->codebooks[nbook];
+
+        assert(!(psize % book->ndimensions));
+
+        a1 = (s % real_ch) * samples;
+        b1 =  s / real_ch;
+        for (k = 0; k < psize; k += book->ndimensions) {
+            int dim, entry, a2 = a1, b2 = b1;
+            float vec[MAX_CODEBOOK_DIM], *pv = vec;
+            for (dim = book->ndimensions; dim--; ) {
+                *pv++ = coeffs[a2 + b2];
+                if ((a2 += samples) == real_ch * samples) {
+                    a2 = 0;
+                    b2++;
+                }
+            }
+            entry = nearest_entry(book, vec);
+            venc->res_entries[p][pass][n++] = entry;
+            pv = &book->dimensions[entry * book->ndimensions];
+            for (dim = book->ndimensions; dim--; ) {
+                coeffs[a1 + b1] -= *pv++;
+                if ((a1 += samples) == real_ch * samples) {
+                    a1 = 0;
+                    b1++;
+                }
+            }
+        }
+    }
+}
+
+static int residue_search_slice(AVCodecContext *avctx, void *arg,
+                                int jobnr, int threadnr)
+{
+    vorbis_enc_context *venc = avctx->priv_data;
+    vorbis_enc_residue *rc   = venc->cur_residue;
+    int samples    = 1 << (venc->log2_blocksize[1] - 1);
+    int partitions = (rc->end - rc->begin) / rc->partition_size;
+    int nb_jobs    = FFMIN(avctx->thread_count, partitions);
+    int p;
+
+    for (p = partitions *  jobnr      / nb_jobs;
+         p < partitions * (jobnr + 1) / nb_jobs; p++)
+        residue_search_partition(venc, rc, venc->coeffs, samples,
+                                 venc->channels, p);
+    return 0;
 }
 
-static int residue_encode(vorbis_enc_context *venc, vorbis_enc_residue *rc,
-                          PutBitContext *pb, float *coeffs, int samples,
-                          int real_ch)
+static int residue_encode(AVCodecContext *avctx, vorbis_enc_context *venc,
+                          vorbis_enc_residue *rc, PutBitContext *pb)
 {
-    int pass, i, j, p, k;
-    int psize      = rc->partition_size;
-    int partitions = (rc->end - rc->begin) / psize;
-    int channels   = (rc->type == 2) ? 1 : real_ch;
-    int classes[MAX_CHANNELS][NUM_RESIDUE_PARTITIONS];
+    int pass, i, k, p;
+    int partitions = (rc->end - rc->begin) / rc->partition_size;
     int classwords = venc->codebooks[rc->classbook].ndimensions;
 
     av_assert0(rc->type == 2);
-    av_assert0(real_ch == 2);
-    for (p = 0; p < partitions; p++) {
-        float max1 = 0.0, max2 = 0.0;
-        int s = rc->begin + p * psize;
-        for (k = s; k < s + psize; k += 2) {
-            max1 = FFMAX(max1, fabs(coeffs[          k / real_ch]));
-            max2 = FFMAX(max2, fabs(coeffs[samples + k / real_ch]));
-        }
+    av_assert0(venc->channels == 2);
 
-        for (i = 0; i < rc->classifications - 1; i++)
-            if (max1 < rc->maxes[i][0] && max2 < rc->maxes[i][1])
-                break;
-        classes[0][p] = i;
-    }
+    venc->cur_residue = rc;
+    avctx->execute2(avctx, residue_search_slice, NULL, NULL,
+                    FFMIN(avctx->thread_count, partitions));
 
-    for (pass = 0; pass < 8; pass++) {
+    for (pass = 0; pass < NUM_RESIDUE_PASSES; pass++) {
         p = 0;
         while (p < partitions) {
-            if (pass == 0)
-                for (j = 0; j < channels; j++) {
-                    vorbis_enc_codebook * book = &venc->codebooks[rc->classbook];
-                    int entry = 0;
-                    for (i = 0; i < classwords; i++) {
-                        entry *= rc->classifications;
-                        entry += classes[j][p + i];
-                    }
-                    if (put_codeword(pb, book, entry))
-                        return AVERROR(EINVAL);
+            if (pass == 0) {
+                vorbis_enc_codebook * book = &venc->codebooks[rc->classbook];
+                int entry = 0;
+                for (i = 0; i < classwords; i++) {
+                    entry *= rc->classifications;
+                    entry += venc->res_classes[p + i];
                 }
+                if (put_codeword(pb, book, entry))
+                    return AVERROR(EINVAL);
+            }
             for (i = 0; i < classwords && p < partitions; i++, p++) {
-                for (j = 0; j < channels; j++) {
-                    int nbook = rc->books[classes[j][p]][pass];
-                    vorbis_enc_codebook * book = &venc->codebooks[nbook];
-                    float *buf = coeffs + samples*j + rc->begin + p*psize;
-                    if (nbook == -1)
-                        continue;
-
-                    assert(rc->type == 0 || rc->type == 2);
-                    assert(!(psize % book->ndimensions));
-
-                    if (rc->type == 0) {
-                        for (k = 0; k < psize; k += book->ndimensions) {
-                            int l;
-                            float *a = put_vector(book, pb, &buf[k]);
-                            if (!a)
-                                return AVERROR(EINVAL);
-                            for (l = 0; l < book->ndimensions; l++)
-                                buf[k + l] -= a[l];
-                        }
-                    } else {
-                        int s = rc->begin + p * psize, a1, b1;
-                        a1 = (s % real_ch) * samples;
-                        b1 =  s / real_ch;
-                        s  = real_ch * samples;
-                        for (k = 0; k < psize; k += book->ndimensions) {
-                            int dim, a2 = a1, b2 = b1;
-                            float vec[MAX_CODEBOOK_DIM], *pv = vec;
-                            for (dim = book->ndimensions; dim--; ) {
-                                *pv++ = coeffs[a2 + b2];
-                                if ((a2 += samples) == s) {
-                                    a2 = 0;
-                                    b2++;
-                                }
-                            }
-                            pv = put_vector(book, pb, vec);
-                            if (!pv)
-                                return AVERROR(EINVAL);
-                            for (dim = book->ndimensions; dim--; ) {
-                                coeffs[a1 + b1] -= *pv++;
-                                if ((a1 += samples) == s) {
-                                    a1 = 0;
-                                    b1++;
-                                }
-                            }
-                        }
-                    }
-                }
+                int nbook = rc->books[venc->res_classes[p]][pass];
+                vorbis_enc_codebook * book = &venc->codebooks[nbook];
+                if (nbook == -1)
+                    continue;
+
+                for (k = 0; k < rc->partition_size / book->ndimensions; k++)
+                    if (put_codeword(pb, book, venc->res_entries[p][pass][k]))
+                        return AVERROR(EINVAL);
             }
         }
     }
@@ -1178,8 +1249,8 @@ static int vorbis_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         }
     }
 
-    if (residue_encode(venc, &venc->residues[mapping->residue[mapping->mux[0]]],
-                       &pb, venc->coeffs, frame_size, venc->channels)) {
+    if (residue_encode(avctx, venc, &venc->residues[mapping->residue[mapping->mux[0]]],
+                       &pb)) {
         av_log(avctx, AV_LOG_ERROR, "output buffer is too small\n");
         return AVERROR(EINVAL);
     }
@@ -1213,6 +1284,7 @@ static av_cold int vorbis_encode_close(AVCodecContext *avctx)
             av_freep(&venc->codebooks[i].quantlist);
             av_freep(&venc->codebooks[i].dimensions);
             av_freep(&venc->codebooks[i].pow2);
+            av_freep(&venc->codebooks[i].lattice);
         }
     av_freep(&venc->codebooks);
 
@@ -1307,7 +1379,8 @@ AVCodec ff_vorbis_encoder = {
     .init           = vorbis_encode_init,
     .encode2        = vorbis_encode_frame,
     .close          = vorbis_encode_close,
-    .capabilities   = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_EXPERIMENTAL,
+    .capabilities   = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_EXPERIMENTAL |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
 };
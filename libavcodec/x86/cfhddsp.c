@@ -0,0 +1,426 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/cfhddsp.h"
+
+#if HAVE_INLINE_ASM && ARCH_X86_64
+
+/* The SIMD loops only cover the inner samples, where the filter is
+ * (l[-1] - l[1] + 4) >> 3 plus l[0] +- h[0], halved. Everything is computed
+ * on sign extended dwords and the results are truncated to 16 bits like the
+ * stores of the C version, so the output is bitexact. The edges and the
+ * leftover samples use the C formulas below. */
+
+static av_always_inline void filter_cols(int16_t *output, const int16_t *low,
+                                         const int16_t *high, int start,
+                                         int end, int len, int clip)
+{
+    int16_t tmp;
+    int i;
+
+    for (i = start; i < end; i++) {
+        int16_t out0, out1;
+
+        if (i == 0) {
+            tmp  = (11*low[0] - 4*low[1] + low[2] + 4) >> 3;
+            out0 = (tmp + high[0]) >> 1;
+            tmp  = ( 5*low[0] + 4*low[1] - low[2] + 4) >> 3;
+            out1 = (tmp - high[0]) >> 1;
+        } else if (i == len - 1) {
+            tmp  = ( 5*low[i] + 4*low[i-1] - low[i-2] + 4) >> 3;
+            out0 = (tmp + high[i]) >> 1;
+            tmp  = (11*low[i] - 4*low[i-1] + low[i-2] + 4) >> 3;
+            out1 = (tmp - high[i]) >> 1;
+        } else {
+            tmp  = (low[i-1] - low[i+1] + 4) >> 3;
+            out0 = (tmp + low[i] + high[i]) >> 1;
+            tmp  = (low[i+1] - low[i-1] + 4) >> 3;
+            out1 = (tmp + low[i] - high[i]) >> 1;
+        }
+        if (clip) {
+            out0 = av_clip_uintp2_c(out0, clip);
+            out1 = av_clip_uintp2_c(out1, clip);
+        }
+        output[2*i+0] = out0;
+        output[2*i+1] = out1;
+    }
+}
+
+static av_always_inline void vert_filter_edge_row(int16_t *out0, int16_t *out1,
+                                                  const int16_t *l,
+                                                  ptrdiff_t low_stride,
+                                                  const int16_t *h, int width,
+                                                  int first)
+{
+    int16_t tmp;
+    int x;
+
+    if (first) {
+        for (x = 0; x < width; x++) {
+            tmp = (11*l[x] - 4*l[x + low_stride] + l[x + 2*low_stride] + 4) >> 3;
+            out0[x] = (tmp + h[x]) >> 1;
+            tmp = ( 5*l[x] + 4*l[x + low_stride] - l[x + 2*low_stride] + 4) >> 3;
+            out1[x] = (tmp - h[x]) >> 1;
+        }
+    } else {
+        for (x = 0; x < width; x++) {
+            tmp = ( 5*l[x] + 4*l[x - low_stride] - l[x - 2*low_stride] + 4) >> 3;
+            out0[x] = (tmp + h[x]) >> 1;
+            tmp = (11*l[x] - 4*l[x - low_stride] + l[x - 2*low_stride] + 4) >> 3;
+            out1[x] = (tmp - h[x]) >> 1;
+        }
+    }
+}
+
+static av_always_inline void vert_filter_inner_tail(int16_t *out0, int16_t *out1,
+                                                    const int16_t *l,
+                                                    ptrdiff_t low_stride,
+                                                    const int16_t *h,
+                                                    int x, int width)
+{
+    int16_t tmp;
+
+    for (; x < width; x++) {
+        tmp = (l[x - low_stride] - l[x + low_stride] + 4) >> 3;
+        out0[x] = (tmp + l[x] + h[x]) >> 1;
+        tmp = (l[x + low_stride] - l[x - low_stride] + 4) >> 3;
+        out1[x] = (tmp + l[x] - h[x]) >> 1;
+    }
+}
+
+/* in: l[-1], l[1], l[0], h[0] in xmm0-7 as lo/hi dword pairs, 4 in xmm13
+ * out: the even and odd outputs as words in xmm8 and xmm2; the halving and
+ * the truncation to 16 bits are done by the shift pair */
+#define SSE2_INNER                                       \
+        "movdqa        %%xmm0, %%xmm8   \n\t"            \
+        "movdqa        %%xmm1, %%xmm9   \n\t"            \
+        "psubd         %%xmm2, %%xmm8   \n\t"            \
+        "psubd         %%xmm3, %%xmm9   \n\t"            \
+        "psubd         %%xmm0, %%xmm2   \n\t"            \
+        "psubd         %%xmm1, %%xmm3   \n\t"            \
+        "paddd        %%xmm13, %%xmm8   \n\t"            \
+        "paddd        %%xmm13, %%xmm9   \n\t"            \
+        "paddd        %%xmm13, %%xmm2   \n\t"            \
+        "paddd        %%xmm13, %%xmm3   \n\t"            \
+        "psrad             $3, %%xmm8   \n\t"            \
+        "psrad             $3, %%xmm9   \n\t"            \
+        "psrad             $3, %%xmm2   \n\t"            \
+        "psrad             $3, %%xmm3   \n\t"            \
+        "paddd         %%xmm4, %%xmm8   \n\t"            \
+        "paddd         %%xmm5, %%xmm9   \n\t"            \
+        "paddd         %%xmm4, %%xmm2   \n\t"            \
+        "paddd         %%xmm5, %%xmm3   \n\t"            \
+        "paddd         %%xmm6, %%xmm8   \n\t"            \
+        "paddd         %%xmm7, %%xmm9   \n\t"            \
+        "psubd         %%xmm6, %%xmm2   \n\t"            \
+        "psubd         %%xmm7, %%xmm3   \n\t"            \
+        "pslld            $15, %%xmm8   \n\t"            \
+        "pslld            $15, %%xmm9   \n\t"            \
+        "pslld            $15, %%xmm2   \n\t"            \
+        "pslld            $15, %%xmm3   \n\t"            \
+        "psrad            $16, %%xmm8   \n\t"            \
+        "psrad            $16, %%xmm9   \n\t"            \
+        "psrad            $16, %%xmm2   \n\t"            \
+        "psrad            $16, %%xmm3   \n\t"            \
+        "packssdw      %%xmm9, %%xmm8   \n\t"            \
+        "packssdw      %%xmm3, %%xmm2   \n\t"
+
+/* load 8 words from src and sign extend them into lo and hi */
+#define SSE2_LOAD(src, lo, hi)                           \
+        "movdqu      " src ", %%" lo "  \n\t"            \
+        "punpckhwd   %%" lo ", %%" hi " \n\t"            \
+        "punpcklwd   %%" lo ", %%" lo " \n\t"            \
+        "psrad            $16, %%" hi " \n\t"            \
+        "psrad            $16, %%" lo " \n\t"
+
+static void horiz_filter_clip_sse2(int16_t *output, const int16_t *low,
+                                   const int16_t *high, int width, int clip)
+{
+    const int16_t min = clip ? 0 : INT16_MIN;
+    const int16_t max = clip ? (1 << clip) - 1 : INT16_MAX;
+    x86_reg blocks = width > 2 ? (width - 2) >> 3 : 0;
+    int x = 1 + blocks * 8;
+    int16_t *dst = output + 2;
+    const int16_t *l = low + 1, *h = high + 1;
+
+    filter_cols(output, low, high, 0, 1, width, clip);
+    if (blocks) {
+        __asm__ volatile(
+            "pcmpeqd      %%xmm13, %%xmm13  \n\t"
+            "psrld            $31, %%xmm13  \n\t"
+            "pslld             $2, %%xmm13  \n\t" // 4
+            "movd              %4, %%xmm14  \n\t"
+            "movd              %5, %%xmm15  \n\t"
+            "pshuflw   $0, %%xmm14, %%xmm14 \n\t"
+            "pshuflw   $0, %%xmm15, %%xmm15 \n\t"
+            "punpcklqdq   %%xmm14, %%xmm14  \n\t"
+            "punpcklqdq   %%xmm15, %%xmm15  \n\t"
+            "1:                             \n\t"
+            SSE2_LOAD("-2(%1)", "xmm0", "xmm1")
+            SSE2_LOAD("2(%1)",  "xmm2", "xmm3")
+            SSE2_LOAD("(%1)",   "xmm4", "xmm5")
+            SSE2_LOAD("(%2)",   "xmm6", "xmm7")
+            SSE2_INNER
+            "movdqa        %%xmm8, %%xmm9   \n\t"
+            "punpcklwd     %%xmm2, %%xmm8   \n\t"
+            "punpckhwd     %%xmm2, %%xmm9   \n\t"
+            "pmaxsw       %%xmm14, %%xmm8   \n\t"
+            "pmaxsw       %%xmm14, %%xmm9   \n\t"
+            "pminsw       %%xmm15, %%xmm8   \n\t"
+            "pminsw       %%xmm15, %%xmm9   \n\t"
+            "movdqu        %%xmm8, (%0)     \n\t"
+            "movdqu        %%xmm9, 16(%0)   \n\t"
+            "add              $32, %0       \n\t"
+            "add              $16, %1       \n\t"
+            "add              $16, %2       \n\t"
+            "sub               $1, %3       \n\t"
+            "jg 1b                          \n\t"
+            : "+r"(dst), "+r"(l), "+r"(h), "+r"(blocks)
+            : "r"((int)min), "r"((int)max)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",  "%xmm3",  "%xmm4",
+                           "%xmm5", "%xmm6", "%xmm7",  "%xmm8",  "%xmm9",
+                           "%xmm13", "%xmm14", "%xmm15",)
+              "memory");
+    }
+    filter_cols(output, low, high, x, width, width, clip);
+}
+
+static void horiz_filter_sse2(int16_t *output, const int16_t *low,
+                              const int16_t *high, int width)
+{
+    horiz_filter_clip_sse2(output, low, high, width, 0);
+}
+
+static void vert_filter_sse2(int16_t *output, ptrdiff_t out_stride,
+                             const int16_t *low, ptrdiff_t low_stride,
+                             const int16_t *high, ptrdiff_t high_stride,
+                             int width, int height)
+{
+    int i;
+
+    for (i = 0; i < height; i++) {
+        int16_t *out0 = output + 2 * i * out_stride;
+        int16_t *out1 = out0 + out_stride;
+        const int16_t *l = low  + i * low_stride;
+        const int16_t *h = high + i * high_stride;
+        x86_reg blocks = width >> 3, off = 0;
+
+        if (i == 0 || i == height - 1) {
+            vert_filter_edge_row(out0, out1, l, low_stride, h, width, i == 0);
+            continue;
+        }
+        if (blocks) {
+            __asm__ volatile(
+                "pcmpeqd      %%xmm13, %%xmm13  \n\t"
+                "psrld            $31, %%xmm13  \n\t"
+                "pslld             $2, %%xmm13  \n\t"
+                "1:                             \n\t"
+                SSE2_LOAD("(%2,%1)", "xmm0", "xmm1")
+                SSE2_LOAD("(%3,%1)", "xmm2", "xmm3")
+                SSE2_LOAD("(%4,%1)", "xmm4", "xmm5")
+                SSE2_LOAD("(%5,%1)", "xmm6", "xmm7")
+                SSE2_INNER
+                "movdqu        %%xmm8, (%6,%1)  \n\t"
+                "movdqu        %%xmm2, (%7,%1)  \n\t"
+                "add              $16, %1       \n\t"
+                "sub               $1, %0       \n\t"
+                "jg 1b                          \n\t"
+                : "+r"(blocks), "+r"(off)
+                : "r"(l - low_stride), "r"(l + low_stride), "r"(l), "r"(h),
+                  "r"(out0), "r"(out1)
+                : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",  "%xmm3",  "%xmm4",
+                               "%xmm5", "%xmm6", "%xmm7",  "%xmm8",  "%xmm9",
+                               "%xmm13",)
+                  "memory");
+        }
+        vert_filter_inner_tail(out0, out1, l, low_stride, h, width & ~7, width);
+    }
+}
+
+#if HAVE_AVX2_INLINE
+/* same as SSE2_INNER on 8 dwords per register */
+#define AVX2_INNER                                       \
+        "vpsubd   %%ymm2, %%ymm0, %%ymm8  \n\t"          \
+        "vpsubd   %%ymm3, %%ymm1, %%ymm9  \n\t"          \
+        "vpsubd   %%ymm0, %%ymm2, %%ymm2  \n\t"          \
+        "vpsubd   %%ymm1, %%ymm3, %%ymm3  \n\t"          \
+        "vpaddd  %%ymm13, %%ymm8, %%ymm8  \n\t"          \
+        "vpaddd  %%ymm13, %%ymm9, %%ymm9  \n\t"          \
+        "vpaddd  %%ymm13, %%ymm2, %%ymm2  \n\t"          \
+        "vpaddd  %%ymm13, %%ymm3, %%ymm3  \n\t"          \
+        "vpsrad      $3, %%ymm8, %%ymm8   \n\t"          \
+        "vpsrad      $3, %%ymm9, %%ymm9   \n\t"          \
+        "vpsrad      $3, %%ymm2, %%ymm2   \n\t"          \
+        "vpsrad      $3, %%ymm3, %%ymm3   \n\t"          \
+        "vpaddd   %%ymm4, %%ymm8, %%ymm8  \n\t"          \
+        "vpaddd   %%ymm5, %%ymm9, %%ymm9  \n\t"          \
+        "vpaddd   %%ymm4, %%ymm2, %%ymm2  \n\t"          \
+        "vpaddd   %%ymm5, %%ymm3, %%ymm3  \n\t"          \
+        "vpaddd   %%ymm6, %%ymm8, %%ymm8  \n\t"          \
+        "vpaddd   %%ymm7, %%ymm9, %%ymm9  \n\t"          \
+        "vpsubd   %%ymm6, %%ymm2, %%ymm2  \n\t"          \
+        "vpsubd   %%ymm7, %%ymm3, %%ymm3  \n\t"          \
+        "vpslld     $15, %%ymm8, %%ymm8   \n\t"          \
+        "vpslld     $15, %%ymm9, %%ymm9   \n\t"          \
+        "vpslld     $15, %%ymm2, %%ymm2   \n\t"          \
+        "vpslld     $15, %%ymm3, %%ymm3   \n\t"          \
+        "vpsrad     $16, %%ymm8, %%ymm8   \n\t"          \
+        "vpsrad     $16, %%ymm9, %%ymm9   \n\t"          \
+        "vpsrad     $16, %%ymm2, %%ymm2   \n\t"          \
+        "vpsrad     $16, %%ymm3, %%ymm3   \n\t"          \
+        "vpackssdw %%ymm9, %%ymm8, %%ymm8 \n\t"          \
+        "vpackssdw %%ymm3, %%ymm2, %%ymm2 \n\t"
+
+/* load 16 words from src and sign extend them into lo and hi */
+#define AVX2_LOAD(src, src_hi, lo, hi)                   \
+        "vpmovsxwd " src ",    %%" lo " \n\t"            \
+        "vpmovsxwd " src_hi ", %%" hi " \n\t"
+
+static void horiz_filter_clip_avx2(int16_t *output, const int16_t *low,
+                                   const int16_t *high, int width, int clip)
+{
+    const int16_t min = clip ? 0 : INT16_MIN;
+    const int16_t max = clip ? (1 << clip) - 1 : INT16_MAX;
+    x86_reg blocks = width > 2 ? (width - 2) >> 4 : 0;
+    int x = 1 + blocks * 16;
+    int16_t *dst = output + 2;
+    const int16_t *l = low + 1, *h = high + 1;
+
+    filter_cols(output, low, high, 0, 1, width, clip);
+    if (blocks) {
+        __asm__ volatile(
+            "vpcmpeqd %%ymm13, %%ymm13, %%ymm13 \n\t"
+            "vpsrld       $31, %%ymm13, %%ymm13 \n\t"
+            "vpslld        $2, %%ymm13, %%ymm13 \n\t"
+            "vmovd         %4, %%xmm14          \n\t"
+            "vmovd         %5, %%xmm15          \n\t"
+            "vpbroadcastw %%xmm14, %%ymm14      \n\t"
+            "vpbroadcastw %%xmm15, %%ymm15      \n\t"
+            "1:                                 \n\t"
+            AVX2_LOAD("-2(%1)", "14(%1)", "ymm0", "ymm1")
+            AVX2_LOAD("2(%1)",  "18(%1)", "ymm2", "ymm3")
+            AVX2_LOAD("(%1)",   "16(%1)", "ymm4", "ymm5")
+            AVX2_LOAD("(%2)",   "16(%2)", "ymm6", "ymm7")
+            AVX2_INNER
+            "vpunpckhwd %%ymm2, %%ymm8, %%ymm9  \n\t"
+            "vpunpcklwd %%ymm2, %%ymm8, %%ymm8  \n\t"
+            "vpmaxsw   %%ymm14, %%ymm8, %%ymm8  \n\t"
+            "vpmaxsw   %%ymm14, %%ymm9, %%ymm9  \n\t"
+            "vpminsw   %%ymm15, %%ymm8, %%ymm8  \n\t"
+            "vpminsw   %%ymm15, %%ymm9, %%ymm9  \n\t"
+            "vmovdqu    %%ymm8, (%0)            \n\t"
+            "vmovdqu    %%ymm9, 32(%0)          \n\t"
+            "add           $64, %0              \n\t"
+            "add           $32, %1              \n\t"
+            "add           $32, %2              \n\t"
+            "sub            $1, %3              \n\t"
+            "jg 1b                              \n\t"
+            "vzeroupper                         \n\t"
+            : "+r"(dst), "+r"(l), "+r"(h), "+r"(blocks)
+            : "r"((int)min), "r"((int)max)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",  "%xmm3",  "%xmm4",
+                           "%xmm5", "%xmm6", "%xmm7",  "%xmm8",  "%xmm9",
+                           "%xmm13", "%xmm14", "%xmm15",)
+              "memory");
+    }
+    filter_cols(output, low, high, x, width, width, clip);
+}
+
+static void horiz_filter_avx2(int16_t *output, const int16_t *low,
+                              const int16_t *high, int width)
+{
+    horiz_filter_clip_avx2(output, low, high, width, 0);
+}
+
+static void vert_filter_avx2(int16_t *output, ptrdiff_t out_stride,
+                             const int16_t *low, ptrdiff_t low_stride,
+                             const int16_t *high, ptrdiff_t high_stride,
+                             int width, int height)
+{
+    int i;
+
+    for (i = 0; i < height; i++) {
+        int16_t *out0 = output + 2 * i * out_stride;
+        int16_t *out1 = out0 + out_stride;
+        const int16_t *l = low  + i * low_stride;
+        const int16_t *h = high + i * high_stride;
+        x86_reg blocks = width >> 4, off = 0;
+
+        if (i == 0 || i == height - 1) {
+            vert_filter_edge_row(out0, out1, l, low_stride, h, width, i == 0);
+            continue;
+        }
+        if (blocks) {
+            __asm__ volatile(
+                "vpcmpeqd %%ymm13, %%ymm13, %%ymm13 \n\t"
+                "vpsrld       $31, %%ymm13, %%ymm13 \n\t"
+                "vpslld        $2, %%ymm13, %%ymm13 \n\t"
+                "1:                                 \n\t"
+                AVX2_LOAD("(%2,%1)", "16(%2,%1)", "ymm0", "ymm1")
+                AVX2_LOAD("(%3,%1)", "16(%3,%1)", "ymm2", "ymm3")
+                AVX2_LOAD("(%4,%1)", "16(%4,%1)", "ymm4", "ymm5")
+                AVX2_LOAD("(%5,%1)", "16(%5,%1)", "ymm6", "ymm7")
+                AVX2_INNER
+                "vpermq $0xd8, %%ymm8, %%ymm8       \n\t"
+                "vpermq $0xd8, %%ymm2, %%ymm2       \n\t"
+                "vmovdqu    %%ymm8, (%6,%1)         \n\t"
+                "vmovdqu    %%ymm2, (%7,%1)         \n\t"
+                "add           $32, %1              \n\t"
+                "sub            $1, %0              \n\t"
+                "jg 1b                              \n\t"
+                "vzeroupper                         \n\t"
+                : "+r"(blocks), "+r"(off)
+                : "r"(l - low_stride), "r"(l + low_stride), "r"(l), "r"(h),
+                  "r"(out0), "r"(out1)
+                : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",  "%xmm3",  "%xmm4",
+                               "%xmm5", "%xmm6", "%xmm7",  "%xmm8",  "%xmm9",
+                               "%xmm13",)
+                  "memory");
+        }
+        vert_filter_inner_tail(out0, out1, l, low_stride, h, width & ~15, width);
+    }
+}
+#endif /* HAVE_AVX2_INLINE */
+
+#endif /* HAVE_INLINE_ASM && ARCH_X86_64 */
+
+av_cold void ff_cfhddsp_init_x86(CFHDDSPContext *c)
+{
+#if HAVE_INLINE_ASM && ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE2(cpu_flags)) {
+        c->horiz_filter      = horiz_filter_sse2;
+        c->horiz_filter_clip = horiz_filter_clip_sse2;
+        c->vert_filter       = vert_filter_sse2;
+    }
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags)) {
+        c->horiz_filter      = horiz_filter_avx2;
+        c->horiz_filter_clip = horiz_filter_clip_avx2;
+        c->vert_filter       = vert_filter_avx2;
+    }
+#endif
+#endif
+}
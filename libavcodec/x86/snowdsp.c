@@ -1,5 +1,5 @@
 /*
- * MMX and SSE2 optimized snow DSP utils
+ * MMX, SSE2 and AVX2 optimized snow DSP utils
  * Copyright (c) 2005-2006 Robert Edele <yartrebo@earthlink.net>
  *
  * This file is part of FFmpeg.
@@ -603,6 +603,197 @@ static void ff_snow_vertical_compose97i_mmx(IDWTELEM *b0, IDWTELEM *b1, IDWTELEM
         :"+d"(i)
         :"r"(b0),"r"(b1),"r"(b2),"r"(b3),"r"(b4),"r"(b5));
 }
+
+#if HAVE_AVX2_INLINE
+#define snow_vertical_compose_avx2_load(r,t0,t1,t2,t3)\
+        "vmovdqu   ("r",%%"FF_REG_d"), %%"t0"  \n\t"\
+        "vmovdqu 32("r",%%"FF_REG_d"), %%"t1"  \n\t"\
+        "vmovdqu 64("r",%%"FF_REG_d"), %%"t2"  \n\t"\
+        "vmovdqu 96("r",%%"FF_REG_d"), %%"t3"  \n\t"
+
+#define snow_vertical_compose_avx2_add(r,t0,t1,t2,t3)\
+        "vpaddw   ("r",%%"FF_REG_d"), %%"t0", %%"t0" \n\t"\
+        "vpaddw 32("r",%%"FF_REG_d"), %%"t1", %%"t1" \n\t"\
+        "vpaddw 64("r",%%"FF_REG_d"), %%"t2", %%"t2" \n\t"\
+        "vpaddw 96("r",%%"FF_REG_d"), %%"t3", %%"t3" \n\t"
+
+#define snow_vertical_compose_avx2_store(w,s0,s1,s2,s3)\
+        "vmovdqu %%"s0",   ("w",%%"FF_REG_d")  \n\t"\
+        "vmovdqu %%"s1", 32("w",%%"FF_REG_d")  \n\t"\
+        "vmovdqu %%"s2", 64("w",%%"FF_REG_d")  \n\t"\
+        "vmovdqu %%"s3", 96("w",%%"FF_REG_d")  \n\t"
+
+#define snow_vertical_compose_avx2_r2r(op,s0,s1,s2,s3,t0,t1,t2,t3)\
+        ""op" %%"s0", %%"t0", %%"t0" \n\t"\
+        ""op" %%"s1", %%"t1", %%"t1" \n\t"\
+        ""op" %%"s2", %%"t2", %%"t2" \n\t"\
+        ""op" %%"s3", %%"t3", %%"t3" \n\t"
+
+#define snow_vertical_compose_avx2_sra(n,t0,t1,t2,t3)\
+        "vpsraw $"n", %%"t0", %%"t0" \n\t"\
+        "vpsraw $"n", %%"t1", %%"t1" \n\t"\
+        "vpsraw $"n", %%"t2", %%"t2" \n\t"\
+        "vpsraw $"n", %%"t3", %%"t3" \n\t"
+
+#define snow_vertical_compose_avx2_move(s0,s1,s2,s3,t0,t1,t2,t3)\
+        "vmovdqa %%"s0", %%"t0" \n\t"\
+        "vmovdqa %%"s1", %%"t1" \n\t"\
+        "vmovdqa %%"s2", %%"t2" \n\t"\
+        "vmovdqa %%"s3", %%"t3" \n\t"
+
+/* Same lifting sequence as the MMX version, 64 coefficients per iteration.
+ * Unaligned accesses, so it can be used on the encoder's packed rows. */
+static void ff_snow_vertical_compose97i_avx2(IDWTELEM *b0, IDWTELEM *b1, IDWTELEM *b2, IDWTELEM *b3, IDWTELEM *b4, IDWTELEM *b5, int width){
+    x86_reg i = width;
+
+    while(i & 63)
+    {
+        i--;
+        b4[i] -= (W_DM*(b3[i] + b5[i])+W_DO)>>W_DS;
+        b3[i] -= (W_CM*(b2[i] + b4[i])+W_CO)>>W_CS;
+        b2[i] += (W_BM*(b1[i] + b3[i])+4*b2[i]+W_BO)>>W_BS;
+        b1[i] += (W_AM*(b0[i] + b2[i])+W_AO)>>W_AS;
+    }
+    i+=i;
+    __asm__ volatile(
+        "jmp 2f                                      \n\t"
+        "1:                                          \n\t"
+
+        snow_vertical_compose_avx2_load("%4","ymm1","ymm3","ymm5","ymm7")
+        snow_vertical_compose_avx2_add("%6","ymm1","ymm3","ymm5","ymm7")
+        "vpcmpeqw   %%ymm0, %%ymm0, %%ymm0           \n\t"
+        "vpcmpeqw   %%ymm2, %%ymm2, %%ymm2           \n\t"
+        "vpaddw     %%ymm2, %%ymm2, %%ymm2           \n\t"
+        "vpaddw     %%ymm0, %%ymm2, %%ymm2           \n\t"
+        "vpsllw        $13, %%ymm2, %%ymm2           \n\t"
+        snow_vertical_compose_avx2_r2r("vpaddw","ymm0","ymm0","ymm0","ymm0","ymm1","ymm3","ymm5","ymm7")
+        snow_vertical_compose_avx2_r2r("vpmulhw","ymm2","ymm2","ymm2","ymm2","ymm1","ymm3","ymm5","ymm7")
+        snow_vertical_compose_avx2_add("%5","ymm1","ymm3","ymm5","ymm7")
+        snow_vertical_compose_avx2_store("%5","ymm1","ymm3","ymm5","ymm7")
+        snow_vertical_compose_avx2_load("%4","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_add("%3","ymm1","ymm3","ymm5","ymm7")
+        snow_vertical_compose_avx2_r2r("vpsubw","ymm1","ymm3","ymm5","ymm7","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_store("%4","ymm0","ymm2","ymm4","ymm6")
+        "vpcmpeqw   %%ymm7, %%ymm7, %%ymm7           \n\t"
+        "vpcmpeqw   %%ymm5, %%ymm5, %%ymm5           \n\t"
+        "vpsllw        $15, %%ymm7, %%ymm7           \n\t"
+        "vpsrlw        $13, %%ymm5, %%ymm5           \n\t"
+        "vpaddw     %%ymm7, %%ymm5, %%ymm5           \n\t"
+        snow_vertical_compose_avx2_r2r("vpaddw","ymm5","ymm5","ymm5","ymm5","ymm0","ymm2","ymm4","ymm6")
+        "vmovdqu      (%2,%%"FF_REG_d"), %%ymm1      \n\t"
+        "vmovdqu    32(%2,%%"FF_REG_d"), %%ymm3      \n\t"
+        "vpaddw     %%ymm7, %%ymm1, %%ymm1           \n\t"
+        "vpaddw     %%ymm7, %%ymm3, %%ymm3           \n\t"
+        "vpavgw     %%ymm1, %%ymm0, %%ymm0           \n\t"
+        "vpavgw     %%ymm3, %%ymm2, %%ymm2           \n\t"
+        "vmovdqu    64(%2,%%"FF_REG_d"), %%ymm1      \n\t"
+        "vmovdqu    96(%2,%%"FF_REG_d"), %%ymm3      \n\t"
+        "vpaddw     %%ymm7, %%ymm1, %%ymm1           \n\t"
+        "vpaddw     %%ymm7, %%ymm3, %%ymm3           \n\t"
+        "vpavgw     %%ymm1, %%ymm4, %%ymm4           \n\t"
+        "vpavgw     %%ymm3, %%ymm6, %%ymm6           \n\t"
+        snow_vertical_compose_avx2_r2r("vpsubw","ymm7","ymm7","ymm7","ymm7","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_sra("1","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_add("%3","ymm0","ymm2","ymm4","ymm6")
+
+        snow_vertical_compose_avx2_sra("2","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_add("%3","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_store("%3","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_add("%1","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_move("ymm0","ymm2","ymm4","ymm6","ymm1","ymm3","ymm5","ymm7")
+        snow_vertical_compose_avx2_sra("1","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_r2r("vpaddw","ymm1","ymm3","ymm5","ymm7","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_add("%2","ymm0","ymm2","ymm4","ymm6")
+        snow_vertical_compose_avx2_store("%2","ymm0","ymm2","ymm4","ymm6")
+
+        "2:                                          \n\t"
+        "sub $128, %%"FF_REG_d"                      \n\t"
+        "jge 1b                                      \n\t"
+        "vzeroupper                                  \n\t"
+        :"+d"(i)
+        :"r"(b0),"r"(b1),"r"(b2),"r"(b3),"r"(b4),"r"(b5)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory");
+}
+
+static void ff_snow_vertical_decompose97i_avx2(DWTELEM *b0, DWTELEM *b1, DWTELEM *b2, DWTELEM *b3, DWTELEM *b4, DWTELEM *b5, int width){
+    static const int32_t l0_bias  = W_BO * 5 + (5 << 27);
+    static const int32_t l0_unbias = 1 << 23;
+    static const int32_t l1_bias  = W_DO;
+    static const double  l0_div   = 5 * 16;
+    x86_reg i = width;
+
+    while(i & 7)
+    {
+        i--;
+        b4[i] -= (W_AM*(b3[i] + b5[i])+W_AO)>>W_AS;
+        b3[i]  = (16*4*b3[i] - 4*(b2[i] + b4[i]) + W_BO*5 + (5<<27)) / (5*16) - (1<<23);
+        b2[i] += (W_CM*(b1[i] + b3[i])+W_CO)>>W_CS;
+        b1[i] += (W_DM*(b0[i] + b2[i])+W_DO)>>W_DS;
+    }
+    i*=4;
+    /* The L0 lift divides by 80; done in double precision, where both the
+     * conversion and the correctly rounded quotient are exact enough for
+     * the truncation to match the C integer division. */
+    __asm__ volatile(
+        "vpbroadcastd  %7, %%ymm4                    \n\t"
+        "vpbroadcastd  %8, %%ymm5                    \n\t"
+        "vpbroadcastd  %9, %%ymm6                    \n\t"
+        "vbroadcastsd %10, %%ymm7                    \n\t"
+        "jmp 2f                                      \n\t"
+        "1:                                          \n\t"
+        /* H0: b4 -= 3 * (b3 + b5) >> 1 */
+        "vmovdqu  (%4,%%"FF_REG_d"), %%ymm0          \n\t"
+        "vpaddd   (%6,%%"FF_REG_d"), %%ymm0, %%ymm1  \n\t"
+        "vpaddd     %%ymm1, %%ymm1, %%ymm2           \n\t"
+        "vpaddd     %%ymm2, %%ymm1, %%ymm1           \n\t"
+        "vpsrad         $1, %%ymm1, %%ymm1           \n\t"
+        "vmovdqu  (%5,%%"FF_REG_d"), %%ymm2          \n\t"
+        "vpsubd     %%ymm1, %%ymm2, %%ymm2           \n\t"
+        "vmovdqu    %%ymm2, (%5,%%"FF_REG_d")        \n\t"
+        /* L0: b3 = (64 * b3 - 4 * (b2 + b4) + bias) / 80 - (1 << 23) */
+        "vmovdqu  (%3,%%"FF_REG_d"), %%ymm3          \n\t"
+        "vpaddd     %%ymm3, %%ymm2, %%ymm1           \n\t"
+        "vpslld         $2, %%ymm1, %%ymm1           \n\t"
+        "vpslld         $6, %%ymm0, %%ymm0           \n\t"
+        "vpsubd     %%ymm1, %%ymm0, %%ymm0           \n\t"
+        "vpaddd     %%ymm4, %%ymm0, %%ymm0           \n\t"
+        "vcvtdq2pd  %%xmm0, %%ymm1                   \n\t"
+        "vextracti128   $1, %%ymm0, %%xmm0           \n\t"
+        "vcvtdq2pd  %%xmm0, %%ymm0                   \n\t"
+        "vdivpd     %%ymm7, %%ymm1, %%ymm1           \n\t"
+        "vdivpd     %%ymm7, %%ymm0, %%ymm0           \n\t"
+        "vcvttpd2dq %%ymm1, %%xmm1                   \n\t"
+        "vcvttpd2dq %%ymm0, %%xmm0                   \n\t"
+        "vinserti128    $1, %%xmm0, %%ymm1, %%ymm1   \n\t"
+        "vpsubd     %%ymm5, %%ymm1, %%ymm1           \n\t"
+        "vmovdqu    %%ymm1, (%4,%%"FF_REG_d")        \n\t"
+        /* H1: b2 += b1 + b3 */
+        "vpaddd   (%2,%%"FF_REG_d"), %%ymm1, %%ymm0  \n\t"
+        "vpaddd     %%ymm0, %%ymm3, %%ymm3           \n\t"
+        "vmovdqu    %%ymm3, (%3,%%"FF_REG_d")        \n\t"
+        /* L1: b1 += 3 * (b0 + b2) + 4 >> 3 */
+        "vpaddd   (%1,%%"FF_REG_d"), %%ymm3, %%ymm0  \n\t"
+        "vpaddd     %%ymm0, %%ymm0, %%ymm1           \n\t"
+        "vpaddd     %%ymm1, %%ymm0, %%ymm0           \n\t"
+        "vpaddd     %%ymm6, %%ymm0, %%ymm0           \n\t"
+        "vpsrad         $3, %%ymm0, %%ymm0           \n\t"
+        "vpaddd   (%2,%%"FF_REG_d"), %%ymm0, %%ymm0  \n\t"
+        "vmovdqu    %%ymm0, (%2,%%"FF_REG_d")        \n\t"
+
+        "2:                                          \n\t"
+        "sub $32, %%"FF_REG_d"                       \n\t"
+        "jge 1b                                      \n\t"
+        "vzeroupper                                  \n\t"
+        :"+d"(i)
+        :"r"(b0),"r"(b1),"r"(b2),"r"(b3),"r"(b4),"r"(b5),
+         "m"(l0_bias),"m"(l0_unbias),"m"(l1_bias),"m"(l0_div)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory");
+}
+#endif /* HAVE_AVX2_INLINE */
 #endif //HAVE_7REGS
 
 #if HAVE_6REGS
@@ -904,5 +1095,11 @@ av_cold void ff_dwt_init_x86(SnowDWTContext *c)
 #endif
         }
     }
+#if HAVE_7REGS && HAVE_AVX2_INLINE
+    if (mm_flags & AV_CPU_FLAG_AVX2) {
+        c->vertical_compose97i   = ff_snow_vertical_compose97i_avx2;
+        c->vertical_decompose97i = ff_snow_vertical_decompose97i_avx2;
+    }
+#endif
 #endif /* HAVE_INLINE_ASM */
 }
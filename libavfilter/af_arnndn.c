@@ -141,7 +141,7 @@ typedef struct AudioRNNContext {
     DenoiseState *st;
 
     DECLARE_ALIGNED(32, float, window)[WINDOW_SIZE];
-    float dct_table[NB_BANDS*NB_BANDS];
+    DECLARE_ALIGNED(32, float, dct_table)[FFALIGN(NB_BANDS, 4)][FFALIGN(NB_BANDS, 4)];
 
     RNNModel *model;
 
@@ -254,6 +254,8 @@ static RNNModel *rnnoise_model_from_file(FILE *f)
     } \
     } while (0)
 
+/* One row of len0 weights per neuron and gate, zero padded to a multiple of 4
+ * floats, so every row is 16-byte aligned as scalarproduct_float() requires. */
 #define INPUT_ARRAY3(name, len0, len1, len2) do { \
     float *values = av_calloc(FFALIGN((len0), 4) * FFALIGN((len1), 4) * (len2), sizeof(float)); \
     if (!values) { \
@@ -279,7 +281,7 @@ static RNNModel *rnnoise_model_from_file(FILE *f)
     INPUT_VAL(name->nb_neurons); \
     ret->name ## _size = name->nb_neurons; \
     INPUT_ACTIVATION(name->activation); \
-    INPUT_ARRAY(name->input_weights, name->nb_inputs * name->nb_neurons); \
+    INPUT_ARRAY3(name->input_weights, name->nb_inputs, name->nb_neurons, 1); \
     INPUT_ARRAY(name->bias, name->nb_neurons); \
     } while (0)
 
@@ -992,11 +994,9 @@ static void pitch_search(const float *x_lp, float *y,
 static void dct(AudioRNNContext *s, float *out, const float *in)
 {
     for (int i = 0; i < NB_BANDS; i++) {
-        float sum = 0.f;
+        float sum;
 
-        for (int j = 0; j < NB_BANDS; j++) {
-            sum += in[j] * s->dct_table[j * NB_BANDS + i];
-        }
+        sum = s->fdsp->scalarproduct_float(s->dct_table[i], in, FFALIGN(NB_BANDS, 4));
         out[i] = sum * sqrtf(2.f / 22);
     }
 }
@@ -1007,7 +1007,7 @@ static int compute_frame_features(AudioRNNContext *s, DenoiseState *st, AVComple
     float E = 0;
     float *ceps_0, *ceps_1, *ceps_2;
     float spec_variability = 0;
-    float Ly[NB_BANDS];
+    LOCAL_ALIGNED_32(float, Ly, [FFALIGN(NB_BANDS, 4)]);
     LOCAL_ALIGNED_32(float, p, [WINDOW_SIZE]);
     float pitch_buf[PITCH_BUF_SIZE>>1];
     int pitch_index;
@@ -1037,6 +1037,7 @@ static int compute_frame_features(AudioRNNContext *s, DenoiseState *st, AVComple
     forward_transform(st, P, p);
     compute_band_energy(Ep, P);
     compute_band_corr(Exp, X, P);
+    RNN_CLEAR(&Exp[NB_BANDS], FFALIGN(NB_BANDS, 4) - NB_BANDS);
 
     for (int i = 0; i < NB_BANDS; i++)
         Exp[i] = Exp[i] / sqrtf(.001f+Ex[i]*Ep[i]);
@@ -1059,6 +1060,7 @@ static int compute_frame_features(AudioRNNContext *s, DenoiseState *st, AVComple
         follow = FFMAX(follow-1.5, Ly[i]);
         E += Ex[i];
     }
+    RNN_CLEAR(&Ly[NB_BANDS], FFALIGN(NB_BANDS, 4) - NB_BANDS);
 
     if (E < 0.04f) {
         /* If there's no audio, avoid messing up the state. */
@@ -1232,17 +1234,16 @@ static inline float sigmoid_approx(float x)
     return .5f + .5f*tansig_approx(.5f*x);
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+static void compute_dense(AudioRNNContext *s, const DenseLayer *layer, float *output, const float *input)
 {
-    const int N = layer->nb_neurons, M = layer->nb_inputs, stride = N;
+    const int N = layer->nb_neurons, M = layer->nb_inputs;
+    const int AM = FFALIGN(M, 4);
 
     for (int i = 0; i < N; i++) {
         /* Compute update gate. */
         float sum = layer->bias[i];
 
-        for (int j = 0; j < M; j++)
-            sum += layer->input_weights[j * stride + i] * input[j];
-
+        sum += s->fdsp->scalarproduct_float(layer->input_weights + i * AM, input, AM);
         output[i] = WEIGHTS_SCALE * sum;
     }
 
@@ -1289,13 +1290,17 @@ static void compute_gru(AudioRNNContext *s, const GRULayer *gru, float *state, c
         r[i] = sigmoid_approx(WEIGHTS_SCALE * sum);
     }
 
+    /* Apply the reset gate to the state once for all neurons. */
+    for (int i = 0; i < N; i++)
+        r[i] *= state[i];
+    RNN_CLEAR(&r[N], AN - N);
+
     for (int i = 0; i < N; i++) {
         /* Compute output. */
         float sum = gru->bias[2 * N + i];
 
         sum += s->fdsp->scalarproduct_float(gru->input_weights + 2 * AM + i * istride, input, AM);
-        for (int j = 0; j < N; j++)
-            sum += gru->recurrent_weights[2 * AN + i * stride + j] * state[j] * r[j];
+        sum += s->fdsp->scalarproduct_float(gru->recurrent_weights + 2 * AN + i * stride, r, AN);
 
         if (gru->activation == ACTIVATION_SIGMOID)
             sum = sigmoid_approx(WEIGHTS_SCALE * sum);
@@ -1319,9 +1324,14 @@ static void compute_rnn(AudioRNNContext *s, RNNState *rnn, float *gains, float *
     LOCAL_ALIGNED_32(float, noise_input,   [MAX_NEURONS * 3]);
     LOCAL_ALIGNED_32(float, denoise_input, [MAX_NEURONS * 3]);
 
-    compute_dense(rnn->model->input_dense, dense_out, input);
+    const int noise_size   = rnn->model->input_dense_size + rnn->model->vad_gru_size + INPUT_SIZE;
+    const int denoise_size = rnn->model->vad_gru_size + rnn->model->noise_gru_size + INPUT_SIZE;
+
+    compute_dense(s, rnn->model->input_dense, dense_out, input);
+    RNN_CLEAR(&dense_out[rnn->model->input_dense_size],
+              FFALIGN(rnn->model->input_dense_size, 4) - rnn->model->input_dense_size);
     compute_gru(s, rnn->model->vad_gru, rnn->vad_gru_state, dense_out);
-    compute_dense(rnn->model->vad_output, vad, rnn->vad_gru_state);
+    compute_dense(s, rnn->model->vad_output, vad, rnn->vad_gru_state);
 
     for (int i = 0; i < rnn->model->input_dense_size; i++)
         noise_input[i] = dense_out[i];
@@ -1329,6 +1339,7 @@ static void compute_rnn(AudioRNNContext *s, RNNState *rnn, float *gains, float *
         noise_input[i + rnn->model->input_dense_size] = rnn->vad_gru_state[i];
     for (int i = 0; i < INPUT_SIZE; i++)
         noise_input[i + rnn->model->input_dense_size + rnn->model->vad_gru_size] = input[i];
+    RNN_CLEAR(&noise_input[noise_size], FFALIGN(noise_size, 4) - noise_size);
 
     compute_gru(s, rnn->model->noise_gru, rnn->noise_gru_state, noise_input);
 
@@ -1338,9 +1349,10 @@ static void compute_rnn(AudioRNNContext *s, RNNState *rnn, float *gains, float *
         denoise_input[i + rnn->model->vad_gru_size] = rnn->noise_gru_state[i];
     for (int i = 0; i < INPUT_SIZE; i++)
         denoise_input[i + rnn->model->vad_gru_size + rnn->model->noise_gru_size] = input[i];
+    RNN_CLEAR(&denoise_input[denoise_size], FFALIGN(denoise_size, 4) - denoise_size);
 
     compute_gru(s, rnn->model->denoise_gru, rnn->denoise_gru_state, denoise_input);
-    compute_dense(rnn->model->denoise_output, gains, rnn->denoise_gru_state);
+    compute_dense(s, rnn->model->denoise_output, gains, rnn->denoise_gru_state);
 }
 
 static float rnnoise_channel(AudioRNNContext *s, DenoiseState *st, float *out, const float *in)
@@ -1349,8 +1361,8 @@ static float rnnoise_channel(AudioRNNContext *s, DenoiseState *st, float *out, c
     AVComplexFloat P[WINDOW_SIZE];
     float x[FRAME_SIZE];
     float Ex[NB_BANDS], Ep[NB_BANDS];
-    float Exp[NB_BANDS];
-    float features[NB_FEATURES];
+    LOCAL_ALIGNED_32(float, Exp, [FFALIGN(NB_BANDS, 4)]);
+    LOCAL_ALIGNED_32(float, features, [FFALIGN(NB_FEATURES, 4)]);
     float g[NB_BANDS];
     float gf[FREQ_SIZE];
     float vad_prob = 0;
@@ -1362,6 +1374,7 @@ static float rnnoise_channel(AudioRNNContext *s, DenoiseState *st, float *out, c
     silence = compute_frame_features(s, st, X, P, Ex, Ep, Exp, features, x);
 
     if (!silence) {
+        RNN_CLEAR(&features[NB_FEATURES], FFALIGN(NB_FEATURES, 4) - NB_FEATURES);
         compute_rnn(s, &st->rnn, g, &vad_prob, features);
         pitch_filter(X, P, Ex, Ep, Exp, g);
         for (int i = 0; i < NB_BANDS; i++) {
@@ -1477,9 +1490,9 @@ static av_cold int init(AVFilterContext *ctx)
 
     for (int i = 0; i < NB_BANDS; i++) {
         for (int j = 0; j < NB_BANDS; j++) {
-            s->dct_table[i*NB_BANDS + j] = cosf((i + .5f) * j * M_PI / NB_BANDS);
+            s->dct_table[j][i] = cosf((i + .5f) * j * M_PI / NB_BANDS);
             if (j == 0)
-                s->dct_table[i*NB_BANDS + j] *= sqrtf(.5);
+                s->dct_table[j][i] *= sqrtf(.5);
         }
     }
 
@@ -65,6 +65,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/ffmath.h"
 #include "libavutil/opt.h"
+#include "af_biquadsdsp.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "internal.h"
@@ -93,12 +94,22 @@ enum WidthType {
     NB_WTYPE,
 };
 
+enum TransformType {
+    DI,
+    DII,
+    TDII,
+    NB_TTYPE,
+};
+
 typedef struct ChanCache {
     double i1, i2;
     double o1, o2;
     int clippings;
 } ChanCache;
 
+/* samples per channel gathered at once for the interleaved filters */
+#define LANES_BLOCK_SIZE 256
+
 typedef struct BiquadsContext {
     const AVClass *class;
 
@@ -114,6 +125,7 @@ typedef struct BiquadsContext {
     uint64_t channels;
     int normalize;
     int order;
+    int transform_type;
 
     double a0, a1, a2;
     double b0, b1, b2;
@@ -125,6 +137,12 @@ typedef struct BiquadsContext {
                    double *i1, double *i2, double *o1, double *o2,
                    double b0, double b1, double b2, double a1, double a2, int *clippings,
                    int disabled);
+    void (*filter_lanes)(struct BiquadsContext *s, const uint8_t *const *ibuf,
+                         uint8_t *const *obuf, int len, ChanCache *const *cache,
+                         double b0, double b1, double b2, double a1, double a2,
+                         int disabled);
+
+    BiquadsDSPContext dsp;
 } BiquadsContext;
 
 static av_cold int init(AVFilterContext *ctx)
@@ -139,6 +157,8 @@ static av_cold int init(AVFilterContext *ctx)
         }
     }
 
+    ff_biquads_init(&s->dsp);
+
     return 0;
 }
 
@@ -258,6 +278,211 @@ BIQUAD_FILTER(s32, int32_t, INT32_MIN, INT32_MAX, 1)
 BIQUAD_FILTER(flt, float,   -1., 1., 0)
 BIQUAD_FILTER(dbl, double,  -1., 1., 0)
 
+#define BIQUAD_DII_FILTER(name, type, min, max, need_clipping)                \
+static void biquad_dii_## name (BiquadsContext *s,                            \
+                            const void *input, void *output, int len,         \
+                            double *z1, double *z2,                           \
+                            double *unused1, double *unused2,                 \
+                            double b0, double b1, double b2,                  \
+                            double a1, double a2, int *clippings,             \
+                            int disabled)                                     \
+{                                                                             \
+    const type *ibuf = input;                                                 \
+    type *obuf = output;                                                      \
+    double w1 = *z1;                                                          \
+    double w2 = *z2;                                                          \
+    double wet = s->mix;                                                      \
+    double dry = 1. - wet;                                                    \
+    double in, out, w0;                                                       \
+    int i;                                                                    \
+                                                                              \
+    a1 = -a1;                                                                 \
+    a2 = -a2;                                                                 \
+                                                                              \
+    for (i = 0; i < len; i++) {                                               \
+        in = ibuf[i];                                                         \
+        w0 = in + a1 * w1 + a2 * w2;                                          \
+        out = b0 * w0 + b1 * w1 + b2 * w2;                                    \
+        w2 = w1;                                                              \
+        w1 = w0;                                                              \
+        out = out * wet + in * dry;                                           \
+        if (disabled) {                                                       \
+            obuf[i] = in;                                                     \
+        } else if (need_clipping && out < min) {                              \
+            (*clippings)++;                                                   \
+            obuf[i] = min;                                                    \
+        } else if (need_clipping && out > max) {                              \
+            (*clippings)++;                                                   \
+            obuf[i] = max;                                                    \
+        } else {                                                              \
+            obuf[i] = out;                                                    \
+        }                                                                     \
+    }                                                                         \
+    *z1 = w1;                                                                 \
+    *z2 = w2;                                                                 \
+}
+
+BIQUAD_DII_FILTER(s16, int16_t, INT16_MIN, INT16_MAX, 1)
+BIQUAD_DII_FILTER(s32, int32_t, INT32_MIN, INT32_MAX, 1)
+BIQUAD_DII_FILTER(flt, float,   -1., 1., 0)
+BIQUAD_DII_FILTER(dbl, double,  -1., 1., 0)
+
+#define BIQUAD_TDII_FILTER(name, type, min, max, need_clipping)               \
+static void biquad_tdii_## name (BiquadsContext *s,                           \
+                            const void *input, void *output, int len,         \
+                            double *z1, double *z2,                           \
+                            double *unused1, double *unused2,                 \
+                            double b0, double b1, double b2,                  \
+                            double a1, double a2, int *clippings,             \
+                            int disabled)                                     \
+{                                                                             \
+    const type *ibuf = input;                                                 \
+    type *obuf = output;                                                      \
+    double w1 = *z1;                                                          \
+    double w2 = *z2;                                                          \
+    double wet = s->mix;                                                      \
+    double dry = 1. - wet;                                                    \
+    double in, out;                                                           \
+    int i;                                                                    \
+                                                                              \
+    a1 = -a1;                                                                 \
+    a2 = -a2;                                                                 \
+                                                                              \
+    for (i = 0; i < len; i++) {                                               \
+        in = ibuf[i];                                                         \
+        out = b0 * in + w1;                                                   \
+        w1 = b1 * in + w2 + a1 * out;                                         \
+        w2 = b2 * in + a2 * out;                                              \
+        out = out * wet + in * dry;                                           \
+        if (disabled) {                                                       \
+            obuf[i] = in;                                                     \
+        } else if (need_clipping && out < min) {                              \
+            (*clippings)++;                                                   \
+            obuf[i] = min;                                                    \
+        } else if (need_clipping && out > max) {                              \
+            (*clippings)++;                                                   \
+            obuf[i] = max;                                                    \
+        } else {                                                              \
+            obuf[i] = out;                                                    \
+        }                                                                     \
+    }                                                                         \
+    *z1 = w1;                                                                 \
+    *z2 = w2;                                                                 \
+}
+
+BIQUAD_TDII_FILTER(s16, int16_t, INT16_MIN, INT16_MAX, 1)
+BIQUAD_TDII_FILTER(s32, int32_t, INT32_MIN, INT32_MAX, 1)
+BIQUAD_TDII_FILTER(flt, float,   -1., 1., 0)
+BIQUAD_TDII_FILTER(dbl, double,  -1., 1., 0)
+
+static void filter_tdii_lanes_c(double *block, ptrdiff_t len, double *state,
+                                const double *coeffs)
+{
+    const double b0  = coeffs[BIQUADS_B0];
+    const double b1  = coeffs[BIQUADS_B1];
+    const double b2  = coeffs[BIQUADS_B2];
+    const double a1  = coeffs[BIQUADS_A1];
+    const double a2  = coeffs[BIQUADS_A2];
+    const double wet = coeffs[BIQUADS_WET];
+    const double dry = coeffs[BIQUADS_DRY];
+    double *w1 = state, *w2 = state + BIQUADS_NB_LANES;
+    int i, c;
+
+    for (i = 0; i < len; i++) {
+        for (c = 0; c < BIQUADS_NB_LANES; c++) {
+            double in  = block[c];
+            double out = b0 * in + w1[c];
+
+            w1[c] = b1 * in + w2[c] + a1 * out;
+            w2[c] = b2 * in + a2 * out;
+            block[c] = out * wet + in * dry;
+        }
+        block += BIQUADS_NB_LANES;
+    }
+}
+
+void ff_biquads_init(BiquadsDSPContext *dsp)
+{
+    dsp->filter_tdii_lanes = filter_tdii_lanes_c;
+
+    if (ARCH_X86)
+        ff_biquads_init_x86(dsp);
+}
+
+/* Same as biquad_tdii_*() for BIQUADS_NB_LANES channels at once. The channels
+ * are interleaved in blocks, so that each step of the recursion is done for
+ * all of them together; the output is the same. */
+#define BIQUAD_TDII_LANES_FILTER(name, type, min, max, need_clipping)         \
+static void biquad_tdii_lanes_## name (BiquadsContext *s,                     \
+                            const uint8_t *const *input,                      \
+                            uint8_t *const *output, int len,                  \
+                            ChanCache *const *cache,                          \
+                            double b0, double b1, double b2,                  \
+                            double a1, double a2, int disabled)               \
+{                                                                             \
+    LOCAL_ALIGNED_32(double, block, [LANES_BLOCK_SIZE * BIQUADS_NB_LANES]);   \
+    double state[2 * BIQUADS_NB_LANES];                                       \
+    const double coeffs[BIQUADS_NB_COEFFS] = {                                \
+        [BIQUADS_B0]  = b0,                                                   \
+        [BIQUADS_B1]  = b1,                                                   \
+        [BIQUADS_B2]  = b2,                                                   \
+        [BIQUADS_A1]  = -a1,                                                  \
+        [BIQUADS_A2]  = -a2,                                                  \
+        [BIQUADS_WET] = s->mix,                                               \
+        [BIQUADS_DRY] = 1. - s->mix,                                          \
+    };                                                                        \
+    int i, c, n, pos;                                                         \
+                                                                              \
+    for (c = 0; c < BIQUADS_NB_LANES; c++) {                                  \
+        state[c]                    = cache[c]->i1;                           \
+        state[c + BIQUADS_NB_LANES] = cache[c]->i2;                           \
+    }                                                                         \
+                                                                              \
+    for (pos = 0; pos < len; pos += n) {                                      \
+        n = FFMIN(len - pos, LANES_BLOCK_SIZE);                               \
+                                                                              \
+        for (c = 0; c < BIQUADS_NB_LANES; c++) {                              \
+            const type *ibuf = (const type *)input[c] + pos;                  \
+                                                                              \
+            for (i = 0; i < n; i++)                                           \
+                block[i * BIQUADS_NB_LANES + c] = ibuf[i];                    \
+        }                                                                     \
+                                                                              \
+        s->dsp.filter_tdii_lanes(block, n, state, coeffs);                    \
+                                                                              \
+        for (c = 0; c < BIQUADS_NB_LANES; c++) {                              \
+            const type *ibuf = (const type *)input[c] + pos;                  \
+            type *obuf = (type *)output[c] + pos;                             \
+                                                                              \
+            for (i = 0; i < n; i++) {                                         \
+                double out = block[i * BIQUADS_NB_LANES + c];                 \
+                                                                              \
+                if (disabled) {                                               \
+                    obuf[i] = ibuf[i];                                        \
+                } else if (need_clipping && out < min) {                      \
+                    cache[c]->clippings++;                                    \
+                    obuf[i] = min;                                            \
+                } else if (need_clipping && out > max) {                      \
+                    cache[c]->clippings++;                                    \
+                    obuf[i] = max;                                            \
+                } else {                                                      \
+                    obuf[i] = out;                                            \
+                }                                                             \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    for (c = 0; c < BIQUADS_NB_LANES; c++) {                                  \
+        cache[c]->i1 = state[c];                                              \
+        cache[c]->i2 = state[c + BIQUADS_NB_LANES];                           \
+    }                                                                         \
+}
+
+BIQUAD_TDII_LANES_FILTER(s16, int16_t, INT16_MIN, INT16_MAX, 1)
+BIQUAD_TDII_LANES_FILTER(s32, int32_t, INT32_MIN, INT32_MAX, 1)
+BIQUAD_TDII_LANES_FILTER(flt, float,   -1., 1., 0)
+BIQUAD_TDII_LANES_FILTER(dbl, double,  -1., 1., 0)
+
 static int config_filter(AVFilterLink *outlink, int reset)
 {
     AVFilterContext *ctx    = outlink->src;
@@ -437,12 +662,43 @@ static int config_filter(AVFilterLink *outlink, int reset)
     if (reset)
         memset(s->cache, 0, sizeof(ChanCache) * inlink->channels);
 
-    switch (inlink->format) {
-    case AV_SAMPLE_FMT_S16P: s->filter = biquad_s16; break;
-    case AV_SAMPLE_FMT_S32P: s->filter = biquad_s32; break;
-    case AV_SAMPLE_FMT_FLTP: s->filter = biquad_flt; break;
-    case AV_SAMPLE_FMT_DBLP: s->filter = biquad_dbl; break;
-    default: av_assert0(0);
+    s->filter_lanes = NULL;
+    switch (s->transform_type) {
+    case DI:
+        switch (inlink->format) {
+        case AV_SAMPLE_FMT_S16P: s->filter = biquad_s16; break;
+        case AV_SAMPLE_FMT_S32P: s->filter = biquad_s32; break;
+        case AV_SAMPLE_FMT_FLTP: s->filter = biquad_flt; break;
+        case AV_SAMPLE_FMT_DBLP: s->filter = biquad_dbl; break;
+        default: av_assert0(0);
+        }
+        break;
+    case DII:
+        switch (inlink->format) {
+        case AV_SAMPLE_FMT_S16P: s->filter = biquad_dii_s16; break;
+        case AV_SAMPLE_FMT_S32P: s->filter = biquad_dii_s32; break;
+        case AV_SAMPLE_FMT_FLTP: s->filter = biquad_dii_flt; break;
+        case AV_SAMPLE_FMT_DBLP: s->filter = biquad_dii_dbl; break;
+        default: av_assert0(0);
+        }
+        break;
+    case TDII:
+        switch (inlink->format) {
+        case AV_SAMPLE_FMT_S16P: s->filter = biquad_tdii_s16; break;
+        case AV_SAMPLE_FMT_S32P: s->filter = biquad_tdii_s32; break;
+        case AV_SAMPLE_FMT_FLTP: s->filter = biquad_tdii_flt; break;
+        case AV_SAMPLE_FMT_DBLP: s->filter = biquad_tdii_dbl; break;
+        default: av_assert0(0);
+        }
+        switch (inlink->format) {
+        case AV_SAMPLE_FMT_S16P: s->filter_lanes = biquad_tdii_lanes_s16; break;
+        case AV_SAMPLE_FMT_S32P: s->filter_lanes = biquad_tdii_lanes_s32; break;
+        case AV_SAMPLE_FMT_FLTP: s->filter_lanes = biquad_tdii_lanes_flt; break;
+        case AV_SAMPLE_FMT_DBLP: s->filter_lanes = biquad_tdii_lanes_dbl; break;
+        }
+        break;
+    default:
+        av_assert0(0);
     }
 
     s->block_align = av_get_bytes_per_sample(inlink->format);
@@ -468,7 +724,10 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
     BiquadsContext *s = ctx->priv;
     const int start = (buf->channels * jobnr) / nb_jobs;
     const int end = (buf->channels * (jobnr+1)) / nb_jobs;
-    int ch;
+    const uint8_t *ibuf[BIQUADS_NB_LANES];
+    uint8_t *obuf[BIQUADS_NB_LANES];
+    ChanCache *cache[BIQUADS_NB_LANES];
+    int ch, nb_lanes = 0;
 
     for (ch = start; ch < end; ch++) {
         if (!((av_channel_layout_extract_channel(inlink->channel_layout, ch) & s->channels))) {
@@ -478,11 +737,29 @@ static int filter_channel(AVFilterContext *ctx, void *arg, int jobnr, int nb_job
             continue;
         }
 
+        if (s->filter_lanes) {
+            ibuf [nb_lanes] = buf->extended_data[ch];
+            obuf [nb_lanes] = out_buf->extended_data[ch];
+            cache[nb_lanes] = &s->cache[ch];
+            if (++nb_lanes == BIQUADS_NB_LANES) {
+                s->filter_lanes(s, ibuf, obuf, buf->nb_samples, cache,
+                                s->b0, s->b1, s->b2, s->a1, s->a2, ctx->is_disabled);
+                nb_lanes = 0;
+            }
+            continue;
+        }
+
         s->filter(s, buf->extended_data[ch], out_buf->extended_data[ch], buf->nb_samples,
                   &s->cache[ch].i1, &s->cache[ch].i2, &s->cache[ch].o1, &s->cache[ch].o2,
                   s->b0, s->b1, s->b2, s->a1, s->a2, &s->cache[ch].clippings, ctx->is_disabled);
     }
 
+    /* the channels left over from the last group */
+    for (ch = 0; ch < nb_lanes; ch++)
+        s->filter(s, ibuf[ch], obuf[ch], buf->nb_samples,
+                  &cache[ch]->i1, &cache[ch]->i2, &cache[ch]->o1, &cache[ch]->o2,
+                  s->b0, s->b1, s->b2, s->a1, s->a2, &cache[ch]->clippings, ctx->is_disabled);
+
     return 0;
 }
 
@@ -610,6 +887,11 @@ static const AVOption equalizer_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -636,6 +918,11 @@ static const AVOption bass_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -662,6 +949,11 @@ static const AVOption treble_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -687,6 +979,11 @@ static const AVOption bandpass_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -711,6 +1008,11 @@ static const AVOption bandreject_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -737,6 +1039,11 @@ static const AVOption lowpass_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -763,6 +1070,11 @@ static const AVOption highpass_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -787,6 +1099,11 @@ static const AVOption allpass_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {"order", "set filter order", OFFSET(order), AV_OPT_TYPE_INT, {.i64=2}, 1, 2, FLAGS},
     {"o",     "set filter order", OFFSET(order), AV_OPT_TYPE_INT, {.i64=2}, 1, 2, FLAGS},
     {NULL}
@@ -815,6 +1132,11 @@ static const AVOption lowshelf_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -841,6 +1163,11 @@ static const AVOption highshelf_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
@@ -860,6 +1187,11 @@ static const AVOption biquad_options[] = {
     {"c",        "set channels to filter", OFFSET(channels), AV_OPT_TYPE_CHANNEL_LAYOUT, {.i64=-1}, INT64_MIN, INT64_MAX, FLAGS},
     {"normalize", "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {"n",         "normalize coefficients", OFFSET(normalize), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"transform", "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"a",         "set transform type", OFFSET(transform_type), AV_OPT_TYPE_INT, {.i64=0}, 0, NB_TTYPE-1, AF, "transform_type"},
+    {"di",   "direct form I",  0, AV_OPT_TYPE_CONST, {.i64=DI},   0, 0, AF, "transform_type"},
+    {"dii",  "direct form II", 0, AV_OPT_TYPE_CONST, {.i64=DII},  0, 0, AF, "transform_type"},
+    {"tdii", "transposed direct form II", 0, AV_OPT_TYPE_CONST, {.i64=TDII}, 0, 0, AF, "transform_type"},
     {NULL}
 };
 
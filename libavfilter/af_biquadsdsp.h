@@ -0,0 +1,53 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_BIQUADSDSP_H
+#define AVFILTER_BIQUADSDSP_H
+
+#include <stddef.h>
+
+/* number of channels filtered together, one per vector lane */
+#define BIQUADS_NB_LANES 4
+
+enum BiquadsCoeff {
+    BIQUADS_B0,
+    BIQUADS_B1,
+    BIQUADS_B2,
+    BIQUADS_A1,     ///< negated
+    BIQUADS_A2,     ///< negated
+    BIQUADS_WET,
+    BIQUADS_DRY,
+    BIQUADS_NB_COEFFS,
+};
+
+typedef struct BiquadsDSPContext {
+    /**
+     * Transposed direct form II on BIQUADS_NB_LANES interleaved channels.
+     *
+     * @param block  len rows of BIQUADS_NB_LANES samples, filtered in place
+     * @param state  z1 of each lane followed by z2 of each lane
+     * @param coeffs filter coefficients, indexed by enum BiquadsCoeff
+     */
+    void (*filter_tdii_lanes)(double *block, ptrdiff_t len, double *state,
+                              const double *coeffs);
+} BiquadsDSPContext;
+
+void ff_biquads_init(BiquadsDSPContext *dsp);
+void ff_biquads_init_x86(BiquadsDSPContext *dsp);
+
+#endif /* AVFILTER_BIQUADSDSP_H */
@@ -136,9 +136,11 @@ typedef struct SignatureContext {
     int thl1;
     int thdi;
     int thit;
+    char *import;
     /* end input parameters */
 
-    uint8_t l1distlut[243*242/2]; /* 243 + 242 + 241 ... */
+    uint8_t l1distlut[243*243]; /* distance of every pair of ternary words */
+    int nb_imports; /* number of signatures read from files, stored after the inputs */
     StreamContext* streamcontexts;
 } SignatureContext;
 
@@ -39,11 +39,11 @@
 
 static void fill_l1distlut(uint8_t lut[])
 {
-    int i, j, tmp_i, tmp_j,count;
+    int i, j, tmp_i, tmp_j;
     uint8_t dist;
 
-    for (i = 0, count = 0; i < 242; i++) {
-        for (j = i + 1; j < 243; j++, count++) {
+    for (i = 0; i < 243; i++) {
+        for (j = i; j < 243; j++) {
             /* ternary distance between i and j */
             dist = 0;
             tmp_i = i; tmp_j = j;
@@ -52,38 +52,34 @@ static void fill_l1distlut(uint8_t lut[])
                 tmp_j /= 3;
                 tmp_i /= 3;
             } while (tmp_i > 0 || tmp_j > 0);
-            lut[count] = dist;
+            lut[i * 243 + j] = lut[j * 243 + i] = dist;
         }
     }
 }
 
+/* reads 31 bytes (3 * 64 + 32 + 24 = 248 bits); the 5 bits past bit 243
+ * are zero padding and do not change the count */
 static unsigned int intersection_word(const uint8_t *first, const uint8_t *second)
 {
-    unsigned int val=0,i;
-    for (i = 0; i < 28; i += 4) {
-        val += av_popcount( (first[i]   & second[i]  ) << 24 |
-                            (first[i+1] & second[i+1]) << 16 |
-                            (first[i+2] & second[i+2]) << 8  |
-                            (first[i+3] & second[i+3]) );
-    }
-    val += av_popcount( (first[28] & second[28]) << 16 |
-                        (first[29] & second[29]) << 8  |
-                        (first[30] & second[30]) );
+    unsigned int val;
+
+    val  = av_popcount64(AV_RN64(first)      & AV_RN64(second));
+    val += av_popcount64(AV_RN64(first + 8)  & AV_RN64(second + 8));
+    val += av_popcount64(AV_RN64(first + 16) & AV_RN64(second + 16));
+    val += av_popcount(AV_RN32(first + 24) & AV_RN32(second + 24));
+    val += av_popcount(AV_RL24(first + 28) & AV_RL24(second + 28));
     return val;
 }
 
 static unsigned int union_word(const uint8_t *first, const uint8_t *second)
 {
-    unsigned int val=0,i;
-    for (i = 0; i < 28; i += 4) {
-        val += av_popcount( (first[i]   | second[i]  ) << 24 |
-                            (first[i+1] | second[i+1]) << 16 |
-                            (first[i+2] | second[i+2]) << 8  |
-                            (first[i+3] | second[i+3]) );
-    }
-    val += av_popcount( (first[28] | second[28]) << 16 |
-                        (first[29] | second[29]) << 8  |
-                        (first[30] | second[30]) );
+    unsigned int val;
+
+    val  = av_popcount64(AV_RN64(first)      | AV_RN64(second));
+    val += av_popcount64(AV_RN64(first + 8)  | AV_RN64(second + 8));
+    val += av_popcount64(AV_RN64(first + 16) | AV_RN64(second + 16));
+    val += av_popcount(AV_RN32(first + 24) | AV_RN32(second + 24));
+    val += av_popcount(AV_RL24(first + 28) | AV_RL24(second + 28));
     return val;
 }
 
@@ -91,20 +87,9 @@ static unsigned int get_l1dist(AVFilterContext *ctx, SignatureContext *sc, const
 {
     unsigned int i;
     unsigned int dist = 0;
-    uint8_t f, s;
-
-    for (i = 0; i < SIGELEM_SIZE/5; i++) {
-        if (first[i] != second[i]) {
-            f = first[i];
-            s = second[i];
-            if (f > s) {
-                /* little variation of gauss sum formula */
-                dist += sc->l1distlut[243*242/2 - (243-s)*(242-s)/2 + f - s - 1];
-            } else {
-                dist += sc->l1distlut[243*242/2 - (243-f)*(242-f)/2 + s - f - 1];
-            }
-        }
-    }
+
+    for (i = 0; i < SIGELEM_SIZE/5; i++)
+        dist += sc->l1distlut[first[i] * 243 + second[i]];
     return dist;
 }
 
@@ -545,8 +530,6 @@ static MatchingInfo lookup_signatures(AVFilterContext *ctx, SignatureContext *sc
     bestmatch.meandist = 99999;
     bestmatch.whole = 0;
 
-    fill_l1distlut(sc->l1distlut);
-
     /* stage 1: coarsesignature matching */
     if (find_next_coarsecandidate(sc, second->coarsesiglist, &cs, &cs2, 1) == 0)
         return bestmatch; /* no candidate found */
@@ -0,0 +1,204 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/lfg.h"
+#include "libavfilter/af_arnndn.c"
+
+#define TOLERANCE 1e-4f
+#define GRU_STEPS 8
+
+static float activate_ref(int activation, float x)
+{
+    if (activation == ACTIVATION_SIGMOID)
+        return sigmoid_approx(x);
+    if (activation == ACTIVATION_TANH)
+        return tansig_approx(x);
+    return FFMAX(0, x);
+}
+
+/* Plain loops over the padded weight layout, as used before float_dsp. */
+static void compute_dense_ref(const DenseLayer *layer, float *output, const float *input)
+{
+    const int N = layer->nb_neurons, M = layer->nb_inputs;
+    const int AM = FFALIGN(M, 4);
+
+    for (int i = 0; i < N; i++) {
+        float sum = layer->bias[i];
+
+        for (int j = 0; j < M; j++)
+            sum += layer->input_weights[i * AM + j] * input[j];
+        output[i] = activate_ref(layer->activation, WEIGHTS_SCALE * sum);
+    }
+}
+
+static void compute_gru_ref(const GRULayer *gru, float *state, const float *input)
+{
+    float z[MAX_NEURONS], r[MAX_NEURONS], h[MAX_NEURONS];
+    const int M = gru->nb_inputs;
+    const int N = gru->nb_neurons;
+    const int AN = FFALIGN(N, 4);
+    const int AM = FFALIGN(M, 4);
+    const int stride = 3 * AN, istride = 3 * AM;
+
+    for (int g = 0; g < 2; g++) {
+        float *out = g ? r : z;
+
+        for (int i = 0; i < N; i++) {
+            float sum = gru->bias[g * N + i];
+
+            for (int j = 0; j < M; j++)
+                sum += gru->input_weights[g * AM + i * istride + j] * input[j];
+            for (int j = 0; j < N; j++)
+                sum += gru->recurrent_weights[g * AN + i * stride + j] * state[j];
+            out[i] = sigmoid_approx(WEIGHTS_SCALE * sum);
+        }
+    }
+
+    for (int i = 0; i < N; i++) {
+        float sum = gru->bias[2 * N + i];
+
+        for (int j = 0; j < M; j++)
+            sum += gru->input_weights[2 * AM + i * istride + j] * input[j];
+        for (int j = 0; j < N; j++)
+            sum += gru->recurrent_weights[2 * AN + i * stride + j] * state[j] * r[j];
+        sum = activate_ref(gru->activation, WEIGHTS_SCALE * sum);
+        h[i] = z[i] * state[i] + (1.f - z[i]) * sum;
+    }
+
+    memcpy(state, h, N * sizeof(*state));
+}
+
+/* Weights are 8-bit integers in the model files; padding stays zero. */
+static float *random_weights(AVLFG *lfg, int rows, int len)
+{
+    const int alen = FFALIGN(len, 4);
+    float *w = av_calloc(rows * alen, sizeof(*w));
+
+    if (!w)
+        return NULL;
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < len; j++)
+            w[i * alen + j] = (int)(av_lfg_get(lfg) & 0xff) - 128;
+    return w;
+}
+
+static void random_vector(AVLFG *lfg, float *v, int len)
+{
+    for (int i = 0; i < len; i++)
+        v[i] = av_lfg_get(lfg) / (float)UINT_MAX * 2.f - 1.f;
+    memset(v + len, 0, (FFALIGN(len, 4) - len) * sizeof(*v));
+}
+
+static int compare(const char *name, const float *a, const float *b, int len)
+{
+    int fail = 0;
+
+    /* relative to the magnitude, as ReLU outputs are not bounded */
+    for (int i = 0; i < len; i++)
+        fail |= fabsf(a[i] - b[i]) > TOLERANCE * FFMAX(1.f, fabsf(b[i]));
+    printf("%s: %s\n", name, fail ? "FAIL" : "OK");
+    return fail;
+}
+
+static int test_dense(AudioRNNContext *s, AVLFG *lfg, int M, int N, int activation)
+{
+    LOCAL_ALIGNED_32(float, input,  [MAX_NEURONS * 3]);
+    float out[MAX_NEURONS], ref[MAX_NEURONS];
+    DenseLayer layer = { .nb_inputs = M, .nb_neurons = N, .activation = activation };
+    float *weights = random_weights(lfg, N, M);
+    float *bias    = random_weights(lfg, 1, N);
+    char name[64];
+    int ret = -1;
+
+    if (!weights || !bias)
+        goto end;
+    layer.input_weights = weights;
+    layer.bias          = bias;
+    random_vector(lfg, input, M);
+
+    compute_dense(s, &layer, out, input);
+    compute_dense_ref(&layer, ref, input);
+
+    snprintf(name, sizeof(name), "dense %dx%d activation %d", M, N, activation);
+    ret = compare(name, out, ref, N);
+end:
+    av_free(weights);
+    av_free(bias);
+    return ret;
+}
+
+static int test_gru(AudioRNNContext *s, AVLFG *lfg, int M, int N, int activation)
+{
+    LOCAL_ALIGNED_32(float, input, [MAX_NEURONS * 3]);
+    GRULayer gru = { .nb_inputs = M, .nb_neurons = N, .activation = activation };
+    float *input_weights     = random_weights(lfg, 3 * N, M);
+    float *recurrent_weights = random_weights(lfg, 3 * N, N);
+    float *bias              = random_weights(lfg, 1, 3 * N);
+    float *state     = av_calloc(FFALIGN(N, 16), sizeof(*state));
+    float *state_ref = av_calloc(FFALIGN(N, 16), sizeof(*state_ref));
+    char name[64];
+    int ret = -1;
+
+    if (!input_weights || !recurrent_weights || !bias || !state || !state_ref)
+        goto end;
+    gru.input_weights     = input_weights;
+    gru.recurrent_weights = recurrent_weights;
+    gru.bias              = bias;
+
+    for (int step = 0; step < GRU_STEPS; step++) {
+        random_vector(lfg, input, M);
+        compute_gru(s, &gru, state, input);
+        compute_gru_ref(&gru, state_ref, input);
+    }
+
+    snprintf(name, sizeof(name), "gru %dx%d activation %d", M, N, activation);
+    ret = compare(name, state, state_ref, N);
+end:
+    av_free(input_weights);
+    av_free(recurrent_weights);
+    av_free(bias);
+    av_free(state);
+    av_free(state_ref);
+    return ret;
+}
+
+int main(void)
+{
+    AudioRNNContext s = { 0 };
+    AVLFG lfg;
+    int ret = 0;
+
+    s.fdsp = avpriv_float_dsp_alloc(0);
+    if (!s.fdsp)
+        return 1;
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    /* layer sizes of the rnnoise models, plus some odd ones */
+    ret |= test_dense(&s, &lfg, 42, 24, ACTIVATION_TANH);
+    ret |= test_dense(&s, &lfg, 24, 1,  ACTIVATION_SIGMOID);
+    ret |= test_dense(&s, &lfg, 96, 22, ACTIVATION_SIGMOID);
+    ret |= test_dense(&s, &lfg, 37, 13, ACTIVATION_RELU);
+    ret |= test_gru(&s, &lfg, 24, 24, ACTIVATION_RELU);
+    ret |= test_gru(&s, &lfg, 90, 48, ACTIVATION_RELU);
+    ret |= test_gru(&s, &lfg, 114, 96, ACTIVATION_RELU);
+    ret |= test_gru(&s, &lfg, 29, 7, ACTIVATION_TANH);
+    ret |= test_gru(&s, &lfg, 33, 17, ACTIVATION_SIGMOID);
+
+    av_free(s.fdsp);
+    return !!ret;
+}
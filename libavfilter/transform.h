@@ -132,4 +132,22 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
                         enum InterpolateMethod interpolate,
                         enum FillMethod fill);
 
+/**
+ * Do an affine transformation of the lines slice_start to slice_end - 1
+ * of the destination image. The source image is accessed as a whole, so
+ * that different slices can be transformed concurrently.
+ *
+ * @param slice_start first destination line to transform
+ * @param slice_end   line after the last destination line to transform
+ * @see avfilter_transform() for the other parameters
+ * @return negative on error
+ */
+int avfilter_transform_slice(const uint8_t *src, uint8_t *dst,
+                             int src_stride, int dst_stride,
+                             int width, int height,
+                             int slice_start, int slice_end,
+                             const float *matrix,
+                             enum InterpolateMethod interpolate,
+                             enum FillMethod fill);
+
 #endif /* AVFILTER_TRANSFORM_H */
@@ -225,6 +225,43 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct MotionThreadData {
+    uint8_t *src1, *src2;
+    int stride;
+    int nb_rows, nb_cols;
+} MotionThreadData;
+
+/**
+ * Find the motion vector of every block in a range of block rows. Blocks
+ * that have too little contrast or no good match get a vector of (-1, -1).
+ */
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData *td = arg;
+    const int start = (td->nb_rows * jobnr) / nb_jobs;
+    const int end = (td->nb_rows * (jobnr+1)) / nb_jobs;
+    int row, col, x, y;
+
+    for (row = start; row < end; row++) {
+        y = deshake->ry + row * deshake->blocksize * 2;
+        for (col = 0; col < td->nb_cols; col++) {
+            IntMotionVector *mv = &deshake->mvs[row * td->nb_cols + col];
+
+            x = deshake->rx + col * 16;
+            mv->x = mv->y = -1;
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast) {
+                mv->x = mv->y = 0;
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, mv);
+            }
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -232,13 +269,15 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
+static void find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
                         int width, int height, int stride, Transform *t)
 {
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData td;
     int x, y;
-    IntMotionVector mv = {0, 0};
+    IntMotionVector mv;
     int count_max_value = 0;
-    int contrast;
+    int row, col;
 
     int pos;
     int center_x = 0, center_y = 0;
@@ -253,25 +292,38 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    // We use a width of 16 here to match the sad function
+    td.src1    = src1;
+    td.src2    = src2;
+    td.stride  = stride;
+    td.nb_rows = (FFMAX(height - 2 * deshake->ry - deshake->blocksize * 2, 0) + deshake->blocksize * 2 - 1) /
+                 (deshake->blocksize * 2);
+    td.nb_cols = (FFMAX(width - 2 * deshake->rx - 16, 0) + 15) / 16;
+    av_fast_malloc(&deshake->mvs, &deshake->mvs_size, td.nb_rows * td.nb_cols * sizeof(*deshake->mvs));
+    if (!deshake->angles || !deshake->mvs) {
+        t->vec.x = t->vec.y = t->angle = 0;
+        return;
+    }
+
+    // Find motion for every block, then store the motion vectors in the
+    // counts in raster order so the result does not depend on threading
+    if (td.nb_rows && td.nb_cols)
+        ctx->internal->execute(ctx, find_motion_slice, &td, NULL,
+                               FFMIN(td.nb_rows, ff_filter_get_nb_threads(ctx)));
+
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
+    for (row = 0; row < td.nb_rows; row++) {
+        y = deshake->ry + row * deshake->blocksize * 2;
+        for (col = 0; col < td.nb_cols; col++) {
+            x = deshake->rx + col * 16;
+            mv = deshake->mvs[row * td.nb_cols + col];
+            if (mv.x != -1 && mv.y != -1) {
+                deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
+                if (x > deshake->rx && y > deshake->ry)
+                    deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
+
+                center_x += mv.x;
+                center_y += mv.y;
             }
         }
     }
@@ -312,30 +364,55 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
 }
 
-static int deshake_transform_c(AVFilterContext *ctx,
-                                    int width, int height, int cw, int ch,
-                                    const float *matrix_y, const float *matrix_uv,
-                                    enum InterpolateMethod interpolate,
-                                    enum FillMethod fill, AVFrame *in, AVFrame *out)
-{
-    int i = 0, ret = 0;
-    const float *matrixs[3];
+typedef struct TransformThreadData {
+    AVFrame *in, *out;
+    const float *matrix[3];
     int plane_w[3], plane_h[3];
-    matrixs[0] = matrix_y;
-    matrixs[1] =  matrixs[2] = matrix_uv;
-    plane_w[0] = width;
-    plane_w[1] = plane_w[2] = cw;
-    plane_h[0] = height;
-    plane_h[1] = plane_h[2] = ch;
+    enum InterpolateMethod interpolate;
+    enum FillMethod fill;
+} TransformThreadData;
+
+static int deshake_transform_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TransformThreadData *td = arg;
+    int i, ret;
 
     for (i = 0; i < 3; i++) {
+        const int h = td->plane_h[i];
+
         // Transform the luma and chroma planes
-        ret = avfilter_transform(in->data[i], out->data[i], in->linesize[i], out->linesize[i],
-                                 plane_w[i], plane_h[i], matrixs[i], interpolate, fill);
+        ret = avfilter_transform_slice(td->in->data[i], td->out->data[i],
+                                       td->in->linesize[i], td->out->linesize[i],
+                                       td->plane_w[i], h,
+                                       (h * jobnr) / nb_jobs, (h * (jobnr+1)) / nb_jobs,
+                                       td->matrix[i], td->interpolate, td->fill);
         if (ret < 0)
             return ret;
     }
-    return ret;
+    return 0;
+}
+
+static int deshake_transform_c(AVFilterContext *ctx,
+                                    int width, int height, int cw, int ch,
+                                    const float *matrix_y, const float *matrix_uv,
+                                    enum InterpolateMethod interpolate,
+                                    enum FillMethod fill, AVFrame *in, AVFrame *out)
+{
+    TransformThreadData td;
+
+    td.in  = in;
+    td.out = out;
+    td.matrix[0] = matrix_y;
+    td.matrix[1] = td.matrix[2] = matrix_uv;
+    td.plane_w[0] = width;
+    td.plane_w[1] = td.plane_w[2] = cw;
+    td.plane_h[0] = height;
+    td.plane_h[1] = td.plane_h[2] = ch;
+    td.interpolate = interpolate;
+    td.fill = fill;
+
+    return ctx->internal->execute(ctx, deshake_transform_slice, &td, NULL,
+                                  FFMIN(FFMAX(ch, 1), ff_filter_get_nb_threads(ctx)));
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -403,6 +480,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->mvs);
+    deshake->mvs_size = 0;
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -437,7 +516,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -454,7 +533,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
     }
 
 
@@ -560,4 +639,5 @@ AVFilter ff_vf_deshake = {
     .inputs        = deshake_inputs,
     .outputs       = deshake_outputs,
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -155,6 +155,12 @@ typedef struct DrawTextContext {
     int ft_load_flags;              ///< flags used for loading fonts, see FT_LOAD_*
     FT_Vector *positions;           ///< positions for each element in the text
     size_t nb_positions;            ///< number of elements of positions array
+    struct Glyph **glyph_run;       ///< glyph drawn at each element of positions, NULL if none
+    char *layout_text;              ///< text the cached layout was computed for
+    unsigned int layout_fontsize;   ///< font size the cached layout was computed for
+    int layout_nb_glyphs;           ///< number of elements of glyph_run in the cached layout
+    int layout_w, layout_h;         ///< cached text width and height
+    int layout_y_min, layout_y_max; ///< cached descent and ascent
     char *textfile;                 ///< file with text to be drawn
     int x;                          ///< x position to start drawing text
     int y;                          ///< y position to start drawing text
@@ -811,6 +817,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     s->x_pexpr = s->y_pexpr = s->a_pexpr = s->fontsize_pexpr = NULL;
 
     av_freep(&s->positions);
+    av_freep(&s->glyph_run);
+    av_freep(&s->layout_text);
     s->nb_positions = 0;
 
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
@@ -1213,31 +1221,21 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
+static int draw_glyphs(DrawTextContext *s, uint8_t *dst[4], int dst_linesize[4],
                        int width, int height,
                        FFDrawColor *color,
                        int x, int y, int borderw)
 {
-    char *text = s->expanded_text.str;
-    uint32_t code = 0;
     int i, x1, y1;
-    uint8_t *p;
-    Glyph *glyph = NULL;
+    Glyph *glyph;
 
-    for (i = 0, p = text; *p; i++) {
+    for (i = 0; i < s->layout_nb_glyphs; i++) {
         FT_Bitmap bitmap;
-        Glyph dummy = { 0 };
-        GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
-continue_on_invalid:
 
-        /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+        /* new line, tab and skipped chars have no glyph to draw */
+        if (!(glyph = s->glyph_run[i]))
             continue;
 
-        dummy.code = code;
-        dummy.fontsize = s->fontsize;
-        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
-
         bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
 
         if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
@@ -1248,7 +1246,7 @@ continue_on_invalid:
         y1 = s->positions[i].y+s->y+y - borderw;
 
         ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
+                      dst, dst_linesize, width, height,
                       bitmap.buffer, bitmap.pitch,
                       bitmap.width, bitmap.rows,
                       bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
@@ -1258,6 +1256,60 @@ continue_on_invalid:
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *frame;
+    int width, height;
+    int box_w, box_h;
+    FFDrawColor fontcolor;
+    FFDrawColor shadowcolor;
+    FFDrawColor bordercolor;
+    FFDrawColor boxcolor;
+} ThreadData;
+
+static int draw_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    const int step = 1 << s->dc.vsub_max;
+    const int nb_rows = td->height / step;
+    const int slice_start = (nb_rows *  jobnr   ) / nb_jobs * step;
+    const int slice_end = jobnr == nb_jobs - 1 ? td->height :
+                          (nb_rows * (jobnr+1)) / nb_jobs * step;
+    const int slice_h = slice_end - slice_start;
+    uint8_t *dst[4] = { NULL };
+    int plane, ret;
+
+    /* slices start on a chroma row, so each one can be blended on its own */
+    for (plane = 0; plane < s->dc.nb_planes; plane++)
+        dst[plane] = frame->data[plane] +
+                     (slice_start >> s->dc.vsub[plane]) * frame->linesize[plane];
+
+    /* draw box */
+    if (s->draw_box)
+        ff_blend_rectangle(&s->dc, &td->boxcolor,
+                           dst, frame->linesize, td->width, slice_h,
+                           s->x - s->boxborderw, s->y - s->boxborderw - slice_start,
+                           td->box_w + s->boxborderw * 2, td->box_h + s->boxborderw * 2);
+
+    if (s->shadowx || s->shadowy) {
+        if ((ret = draw_glyphs(s, dst, frame->linesize, td->width, slice_h,
+                               &td->shadowcolor, s->shadowx,
+                               s->shadowy - slice_start, 0)) < 0)
+            return ret;
+    }
+
+    if (s->borderw) {
+        if ((ret = draw_glyphs(s, dst, frame->linesize, td->width, slice_h,
+                               &td->bordercolor, 0, -slice_start, s->borderw)) < 0)
+            return ret;
+    }
+    if ((ret = draw_glyphs(s, dst, frame->linesize, td->width, slice_h,
+                           &td->fontcolor, 0, -slice_start, 0)) < 0)
+        return ret;
+
+    return 0;
+}
 
 static void update_color_with_alpha(DrawTextContext *s, FFDrawColor *color, const FFDrawColor incolor)
 {
@@ -1302,11 +1354,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     time_t now = time(0);
     struct tm ltime;
     AVBPrint *bp = &s->expanded_text;
-
-    FFDrawColor fontcolor;
-    FFDrawColor shadowcolor;
-    FFDrawColor bordercolor;
-    FFDrawColor boxcolor;
+    ThreadData td;
 
     av_bprint_clear(bp);
 
@@ -1341,6 +1389,9 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         if (!(s->positions =
               av_realloc(s->positions, len*sizeof(*s->positions))))
             return AVERROR(ENOMEM);
+        if (!(s->glyph_run =
+              av_realloc(s->glyph_run, len*sizeof(*s->glyph_run))))
+            return AVERROR(ENOMEM);
         s->nb_positions = len;
     }
 
@@ -1364,6 +1415,16 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     if ((ret = update_fontsize(ctx)) < 0)
         return ret;
 
+    /* reuse the layout of the previous frame if the text did not change */
+    if (s->layout_text && s->layout_fontsize == s->fontsize &&
+        !strcmp(s->layout_text, text)) {
+        max_text_line_w = s->layout_w;
+        y               = s->layout_h - s->max_glyph_h;
+        y_min           = s->layout_y_min;
+        y_max           = s->layout_y_max;
+        goto layout_done;
+    }
+
     /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
@@ -1392,6 +1453,7 @@ continue_on_invalid:
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid2;);
 continue_on_invalid2:
+        s->glyph_run[i] = NULL;
 
         /* skip the \n in the sequence \r\n */
         if (prev_code == '\r' && code == '\n')
@@ -1422,12 +1484,28 @@ continue_on_invalid2:
         /* save position */
         s->positions[i].x = x + glyph->bitmap_left;
         s->positions[i].y = y - glyph->bitmap_top + y_max;
-        if (code == '\t') x  = (x / s->tabsize + 1)*s->tabsize;
-        else              x += glyph->advance;
+        if (code == '\t') {
+            x = (x / s->tabsize + 1)*s->tabsize;
+        } else {
+            x += glyph->advance;
+            s->glyph_run[i] = glyph;
+        }
     }
+    s->layout_nb_glyphs = i;
 
     max_text_line_w = FFMAX(x, max_text_line_w);
 
+    av_free(s->layout_text);
+    if (!(s->layout_text = av_strdup(text)))
+        return AVERROR(ENOMEM);
+    s->layout_fontsize = s->fontsize;
+    s->layout_w        = max_text_line_w;
+    s->layout_h        = y + s->max_glyph_h;
+    s->layout_y_min    = y_min;
+    s->layout_y_max    = y_max;
+
+layout_done:
+
     s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = max_text_line_w;
     s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = y + s->max_glyph_h;
 
@@ -1444,10 +1522,10 @@ continue_on_invalid2:
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
 
     update_alpha(s);
-    update_color_with_alpha(s, &fontcolor  , s->fontcolor  );
-    update_color_with_alpha(s, &shadowcolor, s->shadowcolor);
-    update_color_with_alpha(s, &bordercolor, s->bordercolor);
-    update_color_with_alpha(s, &boxcolor   , s->boxcolor   );
+    update_color_with_alpha(s, &td.fontcolor  , s->fontcolor  );
+    update_color_with_alpha(s, &td.shadowcolor, s->shadowcolor);
+    update_color_with_alpha(s, &td.bordercolor, s->bordercolor);
+    update_color_with_alpha(s, &td.boxcolor   , s->boxcolor   );
 
     box_w = max_text_line_w;
     box_h = y + s->max_glyph_h;
@@ -1478,29 +1556,15 @@ continue_on_invalid2:
             s->y = FFMAX(height - box_h - offsetbottom, 0);
     }
 
-    /* draw box */
-    if (s->draw_box)
-        ff_blend_rectangle(&s->dc, &boxcolor,
-                           frame->data, frame->linesize, width, height,
-                           s->x - s->boxborderw, s->y - s->boxborderw,
-                           box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
-
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
-    }
-
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
-    }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
+    td.frame  = frame;
+    td.width  = width;
+    td.height = height;
+    td.box_w  = box_w;
+    td.box_h  = box_h;
 
-    return 0;
+    return ctx->internal->execute(ctx, draw_text_slice, &td, NULL,
+                                  FFMIN(FFMAX(height >> s->dc.vsub_max, 1),
+                                        ff_filter_get_nb_threads(ctx)));
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
@@ -1574,5 +1638,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -36,6 +36,7 @@
 typedef struct ELBGContext {
     const AVClass *class;
     AVLFG lfg;
+    ELBGThreadContext *elbg_threads;
     int64_t lfg_seed;
     int max_steps_nb;
     int *codeword;
@@ -113,6 +114,13 @@ static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
     ELBGContext *elbg = ctx->priv;
+    int ret;
+
+    if (!elbg->elbg_threads) {
+        ret = avpriv_elbg_thread_alloc(&elbg->elbg_threads, ff_filter_get_nb_threads(ctx));
+        if (ret < 0)
+            return ret;
+    }
 
     elbg->pix_desc = av_pix_fmt_desc_get(inlink->format);
     elbg->codeword_length = inlink->w * inlink->h;
@@ -166,12 +174,14 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     }
 
     /* compute the codebook */
-    avpriv_init_elbg(elbg->codeword, NB_COMPONENTS, elbg->codeword_length,
-                     elbg->codebook, elbg->codebook_length, elbg->max_steps_nb,
-                     elbg->codeword_closest_codebook_idxs, &elbg->lfg);
-    avpriv_do_elbg(elbg->codeword, NB_COMPONENTS, elbg->codeword_length,
-                   elbg->codebook, elbg->codebook_length, elbg->max_steps_nb,
-                   elbg->codeword_closest_codebook_idxs, &elbg->lfg);
+    avpriv_init_elbg2(elbg->elbg_threads, elbg->codeword, NB_COMPONENTS,
+                      elbg->codeword_length, elbg->codebook, elbg->codebook_length,
+                      elbg->max_steps_nb, elbg->codeword_closest_codebook_idxs,
+                      &elbg->lfg);
+    avpriv_do_elbg2(elbg->elbg_threads, elbg->codeword, NB_COMPONENTS,
+                    elbg->codeword_length, elbg->codebook, elbg->codebook_length,
+                    elbg->max_steps_nb, elbg->codeword_closest_codebook_idxs,
+                    &elbg->lfg);
 
     if (elbg->pal8) {
         AVFilterLink *outlink = inlink->dst->outputs[0];
@@ -232,6 +242,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&elbg->codebook);
     av_freep(&elbg->codeword);
     av_freep(&elbg->codeword_closest_codebook_idxs);
+    avpriv_elbg_thread_free(&elbg->elbg_threads);
 }
 
 static const AVFilterPad elbg_inputs[] = {
@@ -25,8 +25,10 @@
  */
 
 #include <float.h>
+#include "libavcodec/get_bits.h"
 #include "libavcodec/put_bits.h"
 #include "libavformat/avformat.h"
+#include "libavutil/file.h"
 #include "libavutil/opt.h"
 #include "libavutil/avstring.h"
 #include "libavutil/intreadwrite.h"
@@ -64,6 +66,8 @@ static const AVOption signature_options[] = {
         OFFSET(thdi),         AV_OPT_TYPE_INT,    {.i64 = 0},        0, INT_MAX,          FLAGS },
     { "th_it",      "threshold for relation of good to all frames",
         OFFSET(thit),         AV_OPT_TYPE_DOUBLE, {.dbl = 0.5},    0.0, 1.0,              FLAGS },
+    { "import",     "'|' separated list of binary signature files to match against",
+        OFFSET(import),       AV_OPT_TYPE_STRING, {.str = NULL},     0, 0,                FLAGS },
     { NULL }
 };
 
@@ -567,6 +571,141 @@ static int binary_export(AVFilterContext *ctx, StreamContext *sc, const char* fi
     return 0;
 }
 
+static int binary_import(AVFilterContext *ctx, StreamContext *sc, const char* filename)
+{
+    FineSignature *fs, **fslist = NULL;
+    CoarseSignature *cs;
+    GetBitContext gb;
+    uint8_t *buffer;
+    size_t size;
+    uint32_t numofframes, numofsegments, timeunit, first, last;
+    int i, j, ret;
+
+    ret = av_file_map(filename, &buffer, &size, 0, ctx);
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "cannot open signature file %s\n", filename);
+        return ret;
+    }
+    /* the header alone takes 274 bits */
+    if (size < 35 || (ret = init_get_bits8(&gb, buffer, FFMIN(size, INT_MAX / 8))) < 0) {
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
+    }
+
+    /* header, as written by binary_export() */
+    if (get_bits_long(&gb, 32) != 1) { /* NumOfSpatial Regions */
+        ret = AVERROR_PATCHWELCOME;
+        goto fail;
+    }
+    skip_bits(&gb, 1);                  /* SpatialLocationFlag */
+    skip_bits_long(&gb, 32);            /* PixelX,1 PixelY,1 */
+    sc->w = get_bits(&gb, 16) + 1;      /* PixelX,2 */
+    sc->h = get_bits(&gb, 16) + 1;      /* PixelY,2 */
+    skip_bits_long(&gb, 32);            /* StartFrameOfSpatialRegion */
+    numofframes = get_bits_long(&gb, 32);
+    timeunit = get_bits(&gb, 16);       /* MediaTimeUnit */
+    sc->time_base = (AVRational){ 1, FFMAX(timeunit, 1) };
+    skip_bits(&gb, 1);                  /* MediaTimeFlagOfSpatialRegion */
+    skip_bits_long(&gb, 64);            /* Start/EndMediaTimeOfSpatialRegion */
+    numofsegments = get_bits_long(&gb, 32);
+
+    if (!numofframes || numofsegments != (numofframes + 44) / 45 ||
+        get_bits_left(&gb) < (int64_t)numofsegments * (4*32 + 1 + 5*243) + 1 +
+                             (int64_t)numofframes * (1 + 32 + 6*8 + SIGELEM_SIZE/5*8)) {
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
+    }
+
+    fslist = av_malloc_array(numofframes, sizeof(*fslist));
+    if (!fslist) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    /* coarsesignatures, linked to their finesignatures below */
+    cs = sc->coarsesiglist;
+    for (i = 0; i < numofsegments; i++) {
+        if (i) {
+            cs->next = av_mallocz(sizeof(CoarseSignature));
+            if (!cs->next) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            cs = cs->next;
+        }
+        first = get_bits_long(&gb, 32); /* StartFrameOfSegment */
+        last  = get_bits_long(&gb, 32); /* EndFrameOfSegment */
+        if (first > last || last >= numofframes) {
+            ret = AVERROR_INVALIDDATA;
+            goto fail;
+        }
+        /* store the indexes until the finesignatures exist */
+        cs->first = (FineSignature *)(intptr_t)first;
+        cs->last  = (FineSignature *)(intptr_t)last;
+        skip_bits(&gb, 1);              /* MediaTimeFlagOfSegment */
+        skip_bits_long(&gb, 64);        /* Start/EndMediaTimeOfSegment */
+        for (j = 0; j < 5; j++) {
+            int k;
+            for (k = 0; k < 30; k++)
+                cs->data[j][k] = get_bits(&gb, 8);
+            cs->data[j][30] = get_bits(&gb, 3) << 5;
+        }
+    }
+    sc->coarseend = cs;
+
+    /* finesignatures */
+    if (get_bits1(&gb)) {               /* CompressionFlag */
+        ret = AVERROR_PATCHWELCOME;
+        goto fail;
+    }
+    fs = sc->finesiglist;
+    for (i = 0; i < numofframes; i++) {
+        if (i) {
+            fs->next = av_mallocz(sizeof(FineSignature));
+            if (!fs->next) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            fs->next->prev = fs;
+            fs = fs->next;
+        }
+        fslist[i] = fs;
+        fs->index = i;
+        skip_bits(&gb, 1);              /* MediaTimeFlagOfFrame */
+        fs->pts = get_bits_long(&gb, 32);
+        fs->confidence = get_bits(&gb, 8);
+        for (j = 0; j < 5; j++)
+            fs->words[j] = get_bits(&gb, 8);
+        for (j = 0; j < SIGELEM_SIZE/5; j++) {
+            fs->framesig[j] = get_bits(&gb, 8);
+            if (fs->framesig[j] >= 243) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
+        }
+    }
+    sc->curfinesig = fs;
+    sc->lastindex = numofframes;
+
+    for (cs = sc->coarsesiglist; cs; cs = cs->next) {
+        cs->first = fslist[(intptr_t)cs->first];
+        cs->last  = fslist[(intptr_t)cs->last];
+    }
+    sc->exported = 1;
+    ret = 0;
+
+fail:
+    if (ret < 0) {
+        /* leave no index disguised as pointer behind */
+        for (cs = sc->coarsesiglist; cs; cs = cs->next)
+            cs->first = cs->last = NULL;
+        av_log(ctx, AV_LOG_ERROR, "invalid or unsupported signature file %s\n", filename);
+    }
+    av_freep(&fslist);
+    av_file_unmap(buffer, size);
+    return ret;
+}
+
 static int export(AVFilterContext *ctx, StreamContext *sc, int input)
 {
     SignatureContext* sic = ctx->priv;
@@ -619,10 +758,10 @@ static int request_frame(AVFilterLink *outlink)
 
     /* signature lookup */
     if (lookup && sic->mode != MODE_OFF) {
-        /* iterate over every pair */
+        /* iterate over every pair, imported signatures are not matched against each other */
         for (i = 0; i < sic->nb_inputs; i++) {
             sc = &(sic->streamcontexts[i]);
-            for (j = i+1; j < sic->nb_inputs; j++) {
+            for (j = i+1; j < sic->nb_inputs + sic->nb_imports; j++) {
                 sc2 = &(sic->streamcontexts[j]);
                 match = lookup_signatures(ctx, sic, sc, sc2, sic->mode);
                 if (match.score != 0) {
@@ -649,11 +788,32 @@ static av_cold int init(AVFilterContext *ctx)
     StreamContext *sc;
     int i, ret;
     char tmp[1024];
+    char *import = NULL, *filename, *saveptr = NULL;
 
-    sic->streamcontexts = av_mallocz(sic->nb_inputs * sizeof(StreamContext));
+    if (sic->import) {
+        import = av_strdup(sic->import);
+        if (!import)
+            return AVERROR(ENOMEM);
+        for (filename = av_strtok(import, "|", &saveptr); filename;
+             filename = av_strtok(NULL, "|", &saveptr))
+            sic->nb_imports++;
+        av_freep(&import);
+    }
+
+    sic->streamcontexts = av_mallocz_array(sic->nb_inputs + sic->nb_imports, sizeof(StreamContext));
     if (!sic->streamcontexts)
         return AVERROR(ENOMEM);
 
+    for (i = 0; i < sic->nb_inputs + sic->nb_imports; i++) {
+        sc = &(sic->streamcontexts[i]);
+        sc->finesiglist = av_mallocz(sizeof(FineSignature));
+        if (!sc->finesiglist)
+            return AVERROR(ENOMEM);
+        sc->coarsesiglist = av_mallocz(sizeof(CoarseSignature));
+        if (!sc->coarsesiglist)
+            return AVERROR(ENOMEM);
+    }
+
     for (i = 0; i < sic->nb_inputs; i++) {
         AVFilterPad pad = {
             .type = AVMEDIA_TYPE_VIDEO,
@@ -668,14 +828,8 @@ static av_cold int init(AVFilterContext *ctx)
         sc = &(sic->streamcontexts[i]);
 
         sc->lastindex = 0;
-        sc->finesiglist = av_mallocz(sizeof(FineSignature));
-        if (!sc->finesiglist)
-            return AVERROR(ENOMEM);
         sc->curfinesig = NULL;
 
-        sc->coarsesiglist = av_mallocz(sizeof(CoarseSignature));
-        if (!sc->coarsesiglist)
-            return AVERROR(ENOMEM);
         sc->curcoarsesig1 = sc->coarsesiglist;
         sc->coarseend = sc->coarsesiglist;
         sc->coarsecount = 0;
@@ -693,6 +847,23 @@ static av_cold int init(AVFilterContext *ctx)
         return AVERROR(EINVAL);
     }
 
+    /* read the signatures to match against */
+    if (sic->nb_imports) {
+        import = av_strdup(sic->import);
+        if (!import)
+            return AVERROR(ENOMEM);
+        for (i = sic->nb_inputs, filename = av_strtok(import, "|", &saveptr); filename;
+             i++, filename = av_strtok(NULL, "|", &saveptr)) {
+            if ((ret = binary_import(ctx, &sic->streamcontexts[i], filename)) < 0) {
+                av_free(import);
+                return ret;
+            }
+        }
+        av_free(import);
+    }
+
+    fill_l1distlut(sic->l1distlut);
+
     return 0;
 }
 
@@ -710,7 +881,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     /* free the lists */
     if (sic->streamcontexts != NULL) {
-        for (i = 0; i < sic->nb_inputs; i++) {
+        for (i = 0; i < sic->nb_inputs + sic->nb_imports; i++) {
             sc = &(sic->streamcontexts[i]);
             finsig = sc->finesiglist;
             cousig = sc->coarsesiglist;
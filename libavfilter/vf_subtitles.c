@@ -62,6 +62,12 @@ typedef struct AssContext {
     FFDrawContext draw;
 } AssContext;
 
+typedef struct ThreadData {
+    AVFrame *frame;
+    const ASS_Image *image;
+    int y0, y1;
+} ThreadData;
+
 #define OFFSET(x) offsetof(AssContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 
@@ -160,19 +166,46 @@ static int config_input(AVFilterLink *inlink)
 #define AB(c)  (((c)>>8) &0xFF)
 #define AA(c)  ((0xFF-(c)) &0xFF)
 
-static void overlay_ass_image(AssContext *ass, AVFrame *picref,
-                              const ASS_Image *image)
+/* Blend all images into one band of rows. The bands are aligned to the
+ * chroma subsampling, so every band sees the same masks as a full frame
+ * blend and the result does not depend on the number of jobs. */
+static int overlay_ass_image_slice(AVFilterContext *ctx, void *arg,
+                                   int jobnr, int nb_jobs)
 {
-    for (; image; image = image->next) {
+    AssContext *ass = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *picref = td->frame;
+    const ASS_Image *image;
+    const int align = 1 << ass->draw.vsub_max;
+    const int h = td->y1 - td->y0;
+    const int start = td->y0 + (h *  jobnr      / nb_jobs & ~(align - 1));
+    const int end   = jobnr == nb_jobs - 1 ? td->y1 :
+                      td->y0 + (h * (jobnr + 1) / nb_jobs & ~(align - 1));
+    uint8_t *data[4] = { NULL };
+    int plane;
+
+    if (start >= end)
+        return 0;
+
+    for (plane = 0; plane < ass->draw.nb_planes; plane++)
+        data[plane] = picref->data[plane] +
+                      (start >> ass->draw.vsub[plane]) * picref->linesize[plane];
+
+    for (image = td->image; image; image = image->next) {
         uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
         FFDrawColor color;
+
+        if (image->dst_y >= end || image->dst_y + image->h <= start)
+            continue;
         ff_draw_color(&ass->draw, &color, rgba_color);
         ff_blend_mask(&ass->draw, &color,
-                      picref->data, picref->linesize,
-                      picref->width, picref->height,
+                      data, picref->linesize,
+                      picref->width, end - start,
                       image->bitmap, image->stride, image->w, image->h,
-                      3, 0, image->dst_x, image->dst_y);
+                      3, 0, image->dst_x, image->dst_y - start);
     }
+
+    return 0;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
@@ -184,11 +217,23 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     double time_ms = picref->pts * av_q2d(inlink->time_base) * 1000;
     ASS_Image *image = ass_render_frame(ass->renderer, ass->track,
                                         time_ms, &detect_change);
+    const ASS_Image *img;
+    ThreadData td = { .frame = picref, .image = image, .y0 = INT_MAX, .y1 = INT_MIN };
 
     if (detect_change)
         av_log(ctx, AV_LOG_DEBUG, "Change happened at time ms:%f\n", time_ms);
 
-    overlay_ass_image(ass, picref, image);
+    /* only the rows covered by the images are blended */
+    for (img = image; img; img = img->next) {
+        td.y0 = FFMIN(td.y0, img->dst_y);
+        td.y1 = FFMAX(td.y1, img->dst_y + img->h);
+    }
+    td.y0 = FFMAX(td.y0, 0) & ~((1 << ass->draw.vsub_max) - 1);
+    td.y1 = FFMIN(td.y1, picref->height);
+    if (td.y0 < td.y1)
+        ctx->internal->execute(ctx, overlay_ass_image_slice, &td, NULL,
+                               av_clip((td.y1 - td.y0) >> ass->draw.vsub_max,
+                                       1, ff_filter_get_nb_threads(ctx)));
 
     return ff_filter_frame(outlink, picref);
 }
@@ -256,6 +301,7 @@ AVFilter ff_vf_ass = {
     .inputs        = ass_inputs,
     .outputs       = ass_outputs,
     .priv_class    = &ass_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
 
@@ -493,5 +539,6 @@ AVFilter ff_vf_subtitles = {
     .inputs        = ass_inputs,
     .outputs       = ass_outputs,
     .priv_class    = &subtitles_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
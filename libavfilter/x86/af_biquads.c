@@ -0,0 +1,83 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/af_biquadsdsp.h"
+
+#if HAVE_AVX_INLINE && ARCH_X86_64
+/* One row of four channels per iteration. Separate multiplies and adds in
+ * the same order as the C version, so the output is bitexact. */
+static void filter_tdii_lanes_avx(double *block, ptrdiff_t len, double *state,
+                                  const double *coeffs)
+{
+    __asm__ volatile(
+        "vmovupd           (%2), %%ymm0        \n\t" // z1
+        "vmovupd         32(%2), %%ymm1        \n\t" // z2
+        "vbroadcastsd      (%3), %%ymm2        \n\t" // b0
+        "vbroadcastsd     8(%3), %%ymm3        \n\t" // b1
+        "vbroadcastsd    16(%3), %%ymm4        \n\t" // b2
+        "vbroadcastsd    24(%3), %%ymm5        \n\t" // -a1
+        "vbroadcastsd    32(%3), %%ymm6        \n\t" // -a2
+        "vbroadcastsd    40(%3), %%ymm7        \n\t" // wet
+        "vbroadcastsd    48(%3), %%ymm8        \n\t" // dry
+        "test              %1, %1              \n\t"
+        "jle 2f                                \n\t"
+        ".p2align 4                            \n\t"
+        "1:                                    \n\t"
+        "vmovupd           (%0), %%ymm9        \n\t" // in
+        "vmulpd        %%ymm9, %%ymm2, %%ymm10 \n\t"
+        "vaddpd        %%ymm0, %%ymm10, %%ymm10\n\t" // out = b0 * in + z1
+        "vmulpd        %%ymm9, %%ymm3, %%ymm11 \n\t"
+        "vaddpd        %%ymm1, %%ymm11, %%ymm11\n\t"
+        "vmulpd       %%ymm10, %%ymm5, %%ymm12 \n\t"
+        "vaddpd       %%ymm12, %%ymm11, %%ymm0 \n\t" // z1 = b1 * in + z2 + a1 * out
+        "vmulpd        %%ymm9, %%ymm4, %%ymm11 \n\t"
+        "vmulpd       %%ymm10, %%ymm6, %%ymm12 \n\t"
+        "vaddpd       %%ymm12, %%ymm11, %%ymm1 \n\t" // z2 = b2 * in + a2 * out
+        "vmulpd       %%ymm10, %%ymm7, %%ymm10 \n\t"
+        "vmulpd        %%ymm9, %%ymm8, %%ymm9  \n\t"
+        "vaddpd        %%ymm9, %%ymm10, %%ymm10\n\t" // out * wet + in * dry
+        "vmovupd      %%ymm10, (%0)            \n\t"
+        "add              $32, %0              \n\t"
+        "sub               $1, %1              \n\t"
+        "jg 1b                                 \n\t"
+        "2:                                    \n\t"
+        "vmovupd       %%ymm0, (%2)            \n\t"
+        "vmovupd       %%ymm1, 32(%2)          \n\t"
+        "vzeroupper                            \n\t"
+        : "+r"(block), "+r"(len)
+        : "r"(state), "r"(coeffs)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",  "%xmm3",  "%xmm4",  "%xmm5",  "%xmm6",
+                       "%xmm7", "%xmm8", "%xmm9", "%xmm10", "%xmm11", "%xmm12",)
+          "memory");
+}
+#endif /* HAVE_AVX_INLINE && ARCH_X86_64 */
+
+av_cold void ff_biquads_init_x86(BiquadsDSPContext *dsp)
+{
+#if HAVE_AVX_INLINE && ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_AVX(cpu_flags))
+        dsp->filter_tdii_lanes = filter_tdii_lanes_avx;
+#endif
+}
@@ -1439,7 +1439,7 @@ resync:
         if (size > ast->remaining)
             size = ast->remaining;
         avi->last_pkt_pos = avio_tell(pb);
-        err               = av_get_packet(pb, pkt, size);
+        err               = ff_get_packet(s, pb, pkt, size);
         if (err < 0)
             return err;
         size = err;
@@ -18,12 +18,15 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "libavutil/timestamp.h"
 #include "avformat.h"
 #include "internal.h"
@@ -54,6 +57,16 @@ typedef struct {
     int nb_streams;
 } ConcatFile;
 
+typedef struct ConcatPreopen {
+    int fileno;                 ///< index of the file in this slot, -1 if unused
+    AVFormatContext *avf;
+    AVPacketList *pkt_buffer;   ///< packets read ahead, not yet returned
+    AVPacketList *pkt_buffer_end;
+    int64_t size;               ///< size of the packets read ahead
+    int ret;
+    int done;
+} ConcatPreopen;
+
 typedef struct {
     AVClass *class;
     ConcatFile *files;
@@ -66,6 +79,21 @@ typedef struct {
     ConcatMatchMode stream_match_mode;
     unsigned auto_convert;
     int segment_time_metadata;
+    int preopen;
+    int64_t preopen_max_size;
+    AVPacketList *read_ahead;   ///< packets read ahead from the current file
+    AVPacketList *read_ahead_end;
+#if HAVE_THREADS
+    ConcatPreopen *preopened;
+    unsigned preopen_start;     ///< first file of the window to pre-open
+    int64_t preopen_size;       ///< total size of the packets read ahead
+    atomic_int preopen_abort;
+    int preopen_thread_started;
+    AVIOInterruptCB interrupt_callback;
+    pthread_t preopen_thread;
+    pthread_mutex_t preopen_lock;
+    pthread_cond_t preopen_cond;
+#endif
 } ConcatContext;
 
 static int concat_probe(const AVProbeData *probe)
@@ -325,28 +353,290 @@ static int64_t get_best_effort_duration(ConcatFile *file, AVFormatContext *avf)
     return AV_NOPTS_VALUE;
 }
 
-static int open_file(AVFormatContext *avf, unsigned fileno)
+static int open_input(AVFormatContext *avf, ConcatFile *file,
+                      const AVIOInterruptCB *interrupt_callback,
+                      AVFormatContext **ravf)
+{
+    int ret;
+
+    *ravf = avformat_alloc_context();
+    if (!*ravf)
+        return AVERROR(ENOMEM);
+
+    (*ravf)->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
+    (*ravf)->interrupt_callback = *interrupt_callback;
+
+    if ((ret = ff_copy_whiteblacklists(*ravf, avf)) < 0)
+        return ret;
+
+    if ((ret = avformat_open_input(ravf, file->url, NULL, NULL)) < 0 ||
+        (ret = avformat_find_stream_info(*ravf, NULL)) < 0) {
+        av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
+        avformat_close_input(ravf);
+        return ret;
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+static int preopen_check_interrupt(void *arg)
+{
+    ConcatContext *cat = arg;
+
+    if (atomic_load(&cat->preopen_abort))
+        return 1;
+    return ff_check_interrupt(&cat->interrupt_callback);
+}
+
+/**
+ * Open and probe a file, seek to its inpoint and read packets ahead into
+ * a separate packet list, so that the reader can start with it without
+ * doing any I/O.
+ */
+static int preopen_file(AVFormatContext *avf, unsigned fileno,
+                        int64_t max_size, AVFormatContext **ravf,
+                        AVPacketList **pkt_buffer, AVPacketList **pkt_buffer_end,
+                        int64_t *size)
 {
     ConcatContext *cat = avf->priv_data;
     ConcatFile *file = &cat->files[fileno];
+    AVIOInterruptCB interrupt_callback = { preopen_check_interrupt, cat };
+    AVFormatContext *child;
+    AVPacket pkt;
     int ret;
 
-    if (cat->avf)
-        avformat_close_input(&cat->avf);
+    *size = 0;
+    if ((ret = open_input(avf, file, &interrupt_callback, ravf)) < 0)
+        return ret;
+    child = *ravf;
 
-    cat->avf = avformat_alloc_context();
-    if (!cat->avf)
+    if (file->inpoint != AV_NOPTS_VALUE) {
+        if ((ret = avformat_seek_file(child, -1, INT64_MIN, file->inpoint, file->inpoint, 0)) < 0)
+            return ret;
+    }
+
+    /* Errors while reading ahead are left for the reader to run into. */
+    while (*size < max_size && !atomic_load(&cat->preopen_abort)) {
+        if (av_read_frame(child, &pkt) < 0)
+            break;
+        *size += pkt.size;
+        if (ff_packet_list_put(pkt_buffer, pkt_buffer_end, &pkt, 0) < 0) {
+            av_packet_unref(&pkt);
+            break;
+        }
+    }
+    return 0;
+}
+
+static void *preopen_thread(void *arg)
+{
+    AVFormatContext *avf = arg;
+    ConcatContext *cat = avf->priv_data;
+    unsigned start, end, fileno;
+    int i, j;
+
+    pthread_mutex_lock(&cat->preopen_lock);
+    while (!atomic_load(&cat->preopen_abort)) {
+        ConcatPreopen *slot = NULL;
+        AVFormatContext *child = NULL;
+        AVPacketList *pkt_buffer = NULL, *pkt_buffer_end = NULL;
+        int64_t size;
+        int ret;
+
+        start = cat->preopen_start;
+        end   = FFMIN(start + cat->preopen, cat->nb_files);
+
+        /* Drop the files which are not going to be read next. */
+        for (i = 0; i < cat->preopen; i++) {
+            ConcatPreopen *p = &cat->preopened[i];
+            if (p->fileno >= 0 && p->done &&
+                ((unsigned)p->fileno < start || (unsigned)p->fileno >= end)) {
+                child = p->avf;
+                ff_packet_list_free(&p->pkt_buffer, &p->pkt_buffer_end);
+                cat->preopen_size -= p->size;
+                memset(p, 0, sizeof(*p));
+                p->fileno = -1;
+                break;
+            }
+        }
+        if (child) {
+            pthread_mutex_unlock(&cat->preopen_lock);
+            avformat_close_input(&child);
+            pthread_mutex_lock(&cat->preopen_lock);
+            continue;
+        }
+
+        /* Find the first file of the window which is not opened yet. */
+        for (fileno = start; fileno < end && !slot; fileno++) {
+            for (j = 0; j < cat->preopen; j++)
+                if (cat->preopened[j].fileno == fileno)
+                    break;
+            if (j < cat->preopen)
+                continue;
+            for (j = 0; j < cat->preopen; j++) {
+                if (cat->preopened[j].fileno < 0) {
+                    slot = &cat->preopened[j];
+                    slot->fileno = fileno;
+                    break;
+                }
+            }
+            break;
+        }
+        if (!slot) {
+            pthread_cond_wait(&cat->preopen_cond, &cat->preopen_lock);
+            continue;
+        }
+
+        size = FFMAX(cat->preopen_max_size - cat->preopen_size, 0);
+        pthread_mutex_unlock(&cat->preopen_lock);
+        ret = preopen_file(avf, slot->fileno, size, &child,
+                           &pkt_buffer, &pkt_buffer_end, &size);
+        pthread_mutex_lock(&cat->preopen_lock);
+
+        slot->avf            = child;
+        slot->pkt_buffer     = pkt_buffer;
+        slot->pkt_buffer_end = pkt_buffer_end;
+        slot->size           = size;
+        slot->ret  = ret;
+        slot->done = 1;
+        cat->preopen_size += size;
+        pthread_cond_broadcast(&cat->preopen_cond);
+    }
+    pthread_mutex_unlock(&cat->preopen_lock);
+    return NULL;
+}
+
+/**
+ * Take the pre-opened context of a file, waiting for it if it is being
+ * opened, and move the window of files to pre-open after it.
+ *
+ * @return 1 if the file was pre-opened, 0 if it has to be opened directly
+ */
+static int preopen_take(AVFormatContext *avf, unsigned fileno, int *ret)
+{
+    ConcatContext *cat = avf->priv_data;
+    int i, taken = 0;
+
+    pthread_mutex_lock(&cat->preopen_lock);
+    for (i = 0; i < cat->preopen; i++) {
+        ConcatPreopen *p = &cat->preopened[i];
+        if (p->fileno != fileno)
+            continue;
+        while (!p->done)
+            pthread_cond_wait(&cat->preopen_cond, &cat->preopen_lock);
+        cat->avf            = p->avf;
+        cat->read_ahead     = p->pkt_buffer;
+        cat->read_ahead_end = p->pkt_buffer_end;
+        *ret = p->ret;
+        cat->preopen_size -= p->size;
+        memset(p, 0, sizeof(*p));
+        p->fileno = -1;
+        taken = 1;
+        break;
+    }
+    cat->preopen_start = fileno + 1;
+    pthread_cond_broadcast(&cat->preopen_cond);
+    pthread_mutex_unlock(&cat->preopen_lock);
+    return taken;
+}
+
+/**
+ * Move the window of files to pre-open back to start, e.g. after a failed
+ * seek advanced it.
+ */
+static void preopen_restart(AVFormatContext *avf, unsigned start)
+{
+    ConcatContext *cat = avf->priv_data;
+
+    pthread_mutex_lock(&cat->preopen_lock);
+    cat->preopen_start = start;
+    pthread_cond_broadcast(&cat->preopen_cond);
+    pthread_mutex_unlock(&cat->preopen_lock);
+}
+
+static int preopen_init(AVFormatContext *avf)
+{
+    ConcatContext *cat = avf->priv_data;
+    int i, ret;
+
+    cat->preopened = av_malloc_array(cat->preopen, sizeof(*cat->preopened));
+    if (!cat->preopened)
         return AVERROR(ENOMEM);
+    for (i = 0; i < cat->preopen; i++) {
+        memset(&cat->preopened[i], 0, sizeof(*cat->preopened));
+        cat->preopened[i].fileno = -1;
+    }
+    cat->interrupt_callback = avf->interrupt_callback;
+    cat->preopen_start = cat->cur_file - cat->files + 1;
+    atomic_init(&cat->preopen_abort, 0);
+
+    if ((ret = pthread_mutex_init(&cat->preopen_lock, NULL))) {
+        av_freep(&cat->preopened);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&cat->preopen_cond, NULL))) {
+        pthread_mutex_destroy(&cat->preopen_lock);
+        av_freep(&cat->preopened);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&cat->preopen_thread, NULL, preopen_thread, avf))) {
+        av_log(avf, AV_LOG_ERROR, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&cat->preopen_cond);
+        pthread_mutex_destroy(&cat->preopen_lock);
+        av_freep(&cat->preopened);
+        return AVERROR(ret);
+    }
+    cat->preopen_thread_started = 1;
+    return 0;
+}
 
-    cat->avf->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
-    cat->avf->interrupt_callback = avf->interrupt_callback;
+static void preopen_uninit(AVFormatContext *avf)
+{
+    ConcatContext *cat = avf->priv_data;
+    int i;
+
+    if (!cat->preopen_thread_started)
+        return;
+
+    pthread_mutex_lock(&cat->preopen_lock);
+    atomic_store(&cat->preopen_abort, 1);
+    pthread_cond_broadcast(&cat->preopen_cond);
+    pthread_mutex_unlock(&cat->preopen_lock);
+    pthread_join(cat->preopen_thread, NULL);
+    cat->preopen_thread_started = 0;
+
+    for (i = 0; i < cat->preopen; i++) {
+        ff_packet_list_free(&cat->preopened[i].pkt_buffer,
+                            &cat->preopened[i].pkt_buffer_end);
+        if (cat->preopened[i].avf)
+            avformat_close_input(&cat->preopened[i].avf);
+    }
+    av_freep(&cat->preopened);
+    pthread_cond_destroy(&cat->preopen_cond);
+    pthread_mutex_destroy(&cat->preopen_lock);
+}
+#endif
 
-    if ((ret = ff_copy_whiteblacklists(cat->avf, avf)) < 0)
-        return ret;
+static int open_file(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    int ret, preopened = 0;
 
-    if ((ret = avformat_open_input(&cat->avf, file->url, NULL, NULL)) < 0 ||
-        (ret = avformat_find_stream_info(cat->avf, NULL)) < 0) {
-        av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
+    ff_packet_list_free(&cat->read_ahead, &cat->read_ahead_end);
+    if (cat->avf)
+        avformat_close_input(&cat->avf);
+
+#if HAVE_THREADS
+    if (cat->preopen_thread_started)
+        preopened = preopen_take(avf, fileno, &ret);
+    if (preopened && ret < 0) {
+        avformat_close_input(&cat->avf);
+        return ret;
+    }
+#endif
+    if (!preopened &&
+        (ret = open_input(avf, file, &avf->interrupt_callback, &cat->avf)) < 0) {
         avformat_close_input(&cat->avf);
         return ret;
     }
@@ -366,7 +656,7 @@ static int open_file(AVFormatContext *avf, unsigned fileno)
 
     if ((ret = match_streams(avf)) < 0)
         return ret;
-    if (file->inpoint != AV_NOPTS_VALUE) {
+    if (file->inpoint != AV_NOPTS_VALUE && !preopened) {
        if ((ret = avformat_seek_file(cat->avf, -1, INT64_MIN, file->inpoint, file->inpoint, 0)) < 0)
            return ret;
     }
@@ -378,6 +668,9 @@ static int concat_read_close(AVFormatContext *avf)
     ConcatContext *cat = avf->priv_data;
     unsigned i, j;
 
+#if HAVE_THREADS
+    preopen_uninit(avf);
+#endif
     for (i = 0; i < cat->nb_files; i++) {
         av_freep(&cat->files[i].url);
         for (j = 0; j < cat->files[i].nb_streams; j++) {
@@ -387,6 +680,7 @@ static int concat_read_close(AVFormatContext *avf)
         av_freep(&cat->files[i].streams);
         av_dict_free(&cat->files[i].metadata);
     }
+    ff_packet_list_free(&cat->read_ahead, &cat->read_ahead_end);
     if (cat->avf)
         avformat_close_input(&cat->avf);
     av_freep(&cat->files);
@@ -510,6 +804,14 @@ static int concat_read_header(AVFormatContext *avf)
                                                MATCH_ONE_TO_ONE;
     if ((ret = open_file(avf, 0)) < 0)
         goto fail;
+    if (cat->preopen && cat->nb_files > 1) {
+#if HAVE_THREADS
+        if ((ret = preopen_init(avf)) < 0)
+            goto fail;
+#else
+        av_log(avf, AV_LOG_WARNING, "Pre-opening files requires threads, ignoring\n");
+#endif
+    }
     av_bprint_finalize(&bp, NULL);
     return 0;
 
@@ -582,7 +884,10 @@ static int concat_read_packet(AVFormatContext *avf, AVPacket *pkt)
         return AVERROR(EIO);
 
     while (1) {
-        ret = av_read_frame(cat->avf, pkt);
+        if (cat->read_ahead)
+            ret = ff_packet_list_get(&cat->read_ahead, &cat->read_ahead_end, pkt);
+        else
+            ret = av_read_frame(cat->avf, pkt);
         if (ret == AVERROR_EOF) {
             if ((ret = open_next_file(avf)) < 0)
                 return ret;
@@ -664,6 +969,7 @@ static int try_seek(AVFormatContext *avf, int stream,
 {
     ConcatContext *cat = avf->priv_data;
     int64_t t0 = cat->cur_file->start_time - cat->cur_file->file_inpoint;
+    int ret;
 
     ts -= t0;
     min_ts = min_ts == INT64_MIN ? INT64_MIN : min_ts - t0;
@@ -674,7 +980,11 @@ static int try_seek(AVFormatContext *avf, int stream,
         rescale_interval(AV_TIME_BASE_Q, cat->avf->streams[stream]->time_base,
                          &min_ts, &ts, &max_ts);
     }
-    return avformat_seek_file(cat->avf, stream, min_ts, ts, max_ts, flags);
+    ret = avformat_seek_file(cat->avf, stream, min_ts, ts, max_ts, flags);
+    /* packets pre-read from the inpoint are stale after a seek */
+    if (ret >= 0)
+        ff_packet_list_free(&cat->read_ahead, &cat->read_ahead_end);
+    return ret;
 }
 
 static int real_seek(AVFormatContext *avf, int stream,
@@ -733,22 +1043,36 @@ static int concat_seek(AVFormatContext *avf, int stream,
     ConcatContext *cat = avf->priv_data;
     ConcatFile *cur_file_saved = cat->cur_file;
     AVFormatContext *cur_avf_saved = cat->avf;
+    AVPacketList *read_ahead_saved     = cat->read_ahead;
+    AVPacketList *read_ahead_end_saved = cat->read_ahead_end;
+#if HAVE_THREADS
+    unsigned preopen_start_saved = cat->preopen_start;
+#endif
     int ret;
 
     if (flags & (AVSEEK_FLAG_BYTE | AVSEEK_FLAG_FRAME))
         return AVERROR(ENOSYS);
     cat->avf = NULL;
+    cat->read_ahead = cat->read_ahead_end = NULL;
     if ((ret = real_seek(avf, stream, min_ts, ts, max_ts, flags, cur_avf_saved)) < 0) {
         if (cat->cur_file != cur_file_saved) {
+            ff_packet_list_free(&cat->read_ahead, &cat->read_ahead_end);
             if (cat->avf)
                 avformat_close_input(&cat->avf);
         }
-        cat->avf      = cur_avf_saved;
-        cat->cur_file = cur_file_saved;
+        cat->avf            = cur_avf_saved;
+        cat->cur_file       = cur_file_saved;
+        cat->read_ahead     = read_ahead_saved;
+        cat->read_ahead_end = read_ahead_end_saved;
+#if HAVE_THREADS
+        if (cat->preopen_thread_started && cat->preopen_start != preopen_start_saved)
+            preopen_restart(avf, preopen_start_saved);
+#endif
     } else {
         if (cat->cur_file != cur_file_saved) {
             avformat_close_input(&cur_avf_saved);
         }
+        ff_packet_list_free(&read_ahead_saved, &read_ahead_end_saved);
         cat->eof = 0;
     }
     return ret;
@@ -764,6 +1088,10 @@ static const AVOption options[] = {
       OFFSET(auto_convert), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, DEC },
     { "segment_time_metadata", "output file segment start time and duration as packet metadata",
       OFFSET(segment_time_metadata), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "preopen", "number of following files to open in a background thread",
+      OFFSET(preopen), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, DEC },
+    { "preopen_max_size", "maximum total size of the packets read ahead in pre-opened files",
+      OFFSET(preopen_max_size), AV_OPT_TYPE_INT64, {.i64 = 1 << 20}, 0, INT64_MAX, DEC },
     { NULL }
 };
 
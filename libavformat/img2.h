@@ -62,6 +62,8 @@ typedef struct VideoDemuxData {
     int frame_size;
     int ts_from_file;
     int export_path_metadata; /**< enabled when set to 1. */
+    int readahead;          /**< number of files read ahead in worker threads */
+    struct ImgReadAhead *readahead_ctx;
 } VideoDemuxData;
 
 typedef struct IdStrMap {
@@ -76,4 +78,6 @@ extern const AVOption ff_img_options[];
 int ff_img_read_header(AVFormatContext *s1);
 
 int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt);
+
+int ff_img_read_close(AVFormatContext *s1);
 #endif
@@ -29,6 +29,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
 #include "libavcodec/gif.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -399,6 +400,311 @@ static int add_filename_as_pkt_side_data(char *filename, AVPacket *pkt) {
     return 0;
 }
 
+#if HAVE_THREADS
+enum ReadAheadState {
+    RA_EMPTY,
+    RA_QUEUED,
+    RA_READING,
+    RA_DONE,
+};
+
+typedef struct ReadAheadSlot {
+    enum ReadAheadState state;
+    int img_number;
+    AVPacket pkt;
+    int64_t mtime;
+    int ret;
+} ReadAheadSlot;
+
+typedef struct ImgReadAhead {
+    ReadAheadSlot *slots;
+    pthread_t *threads;
+    int nb_slots;
+    int nb_threads;
+    int abort;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} ImgReadAhead;
+
+/**
+ * Read a whole image file of the sequence into a packet, sized after the
+ * file so that it never needs to be reallocated.
+ */
+static int readahead_read_file(AVFormatContext *s1, int img_number,
+                               AVPacket *pkt, int64_t *mtime)
+{
+    VideoDemuxData *s = s1->priv_data;
+    char filename_bytes[1024];
+    char *filename = filename_bytes;
+    AVIOContext *f = NULL;
+    int64_t size;
+    int ret;
+
+    if (s->use_glob) {
+#if HAVE_GLOB
+        filename = s->globstate.gl_pathv[img_number];
+#endif
+    } else if (av_get_frame_filename(filename_bytes, sizeof(filename_bytes),
+                                     s->path, img_number) < 0 && img_number > 1) {
+        return AVERROR(EIO);
+    }
+
+    if (s1->io_open(s1, &f, filename, AVIO_FLAG_READ, NULL) < 0) {
+        av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n", filename);
+        return AVERROR(EIO);
+    }
+    size = avio_size(f);
+    if (size < 0 || size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+        ret = size < 0 ? size : AVERROR(ERANGE);
+        goto fail;
+    }
+    if ((ret = av_new_packet(pkt, size)) < 0)
+        goto fail;
+    ret = avio_read(f, pkt->data, size);
+    ff_format_io_close(s1, &f);
+    if (ret <= 0) {
+        av_packet_unref(pkt);
+        return ret < 0 ? ret : AVERROR_EOF;
+    }
+    pkt->size = ret;
+
+    if (s->ts_from_file) {
+        struct stat img_stat;
+        if (stat(filename, &img_stat)) {
+            av_packet_unref(pkt);
+            return AVERROR(EIO);
+        }
+        *mtime = (int64_t)img_stat.st_mtime;
+#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+        if (s->ts_from_file == 2)
+            *mtime = 1000000000 * *mtime + img_stat.st_mtim.tv_nsec;
+#endif
+    }
+    if (s->export_path_metadata == 1) {
+        ret = add_filename_as_pkt_side_data(filename, pkt);
+        if (ret < 0)
+            av_packet_unref(pkt);
+    }
+    return ret < 0 ? ret : 0;
+
+fail:
+    ff_format_io_close(s1, &f);
+    return ret;
+}
+
+static void *readahead_thread(void *arg)
+{
+    AVFormatContext *s1 = arg;
+    VideoDemuxData *s = s1->priv_data;
+    ImgReadAhead *ra = s->readahead_ctx;
+    int i;
+
+    pthread_mutex_lock(&ra->lock);
+    while (!ra->abort) {
+        ReadAheadSlot *slot = NULL;
+        AVPacket pkt;
+        int64_t mtime = 0;
+        int ret;
+
+        for (i = 0; i < ra->nb_slots && !slot; i++)
+            if (ra->slots[i].state == RA_QUEUED)
+                slot = &ra->slots[i];
+        if (!slot) {
+            pthread_cond_wait(&ra->cond, &ra->lock);
+            continue;
+        }
+        slot->state = RA_READING;
+        pthread_mutex_unlock(&ra->lock);
+
+        av_init_packet(&pkt);
+        ret = readahead_read_file(s1, slot->img_number, &pkt, &mtime);
+
+        pthread_mutex_lock(&ra->lock);
+        av_packet_move_ref(&slot->pkt, &pkt);
+        slot->mtime = mtime;
+        slot->ret   = ret;
+        slot->state = RA_DONE;
+        pthread_cond_broadcast(&ra->cond);
+    }
+    pthread_mutex_unlock(&ra->lock);
+    return NULL;
+}
+
+static int readahead_window_number(VideoDemuxData *s, int k)
+{
+    int64_t n = (int64_t)s->img_number + k;
+
+    if (n > s->img_last) {
+        if (!s->loop)
+            return -1;
+        n = s->img_first + (n - s->img_first) % (s->img_last - s->img_first + 1);
+    }
+    return n;
+}
+
+/**
+ * Queue the files following the current one which are not read yet and
+ * drop the ones that will not be needed anymore. Must be called with the
+ * lock held.
+ */
+static void readahead_schedule(VideoDemuxData *s)
+{
+    ImgReadAhead *ra = s->readahead_ctx;
+    int window = FFMIN(ra->nb_slots, s->img_last - s->img_first + 1);
+    int i, k, n;
+
+    for (i = 0; i < ra->nb_slots; i++) {
+        ReadAheadSlot *slot = &ra->slots[i];
+        if (slot->state == RA_EMPTY || slot->state == RA_READING)
+            continue;
+        for (k = 0; k < window; k++)
+            if (readahead_window_number(s, k) == slot->img_number)
+                break;
+        if (k == window) {
+            av_packet_unref(&slot->pkt);
+            slot->state = RA_EMPTY;
+        }
+    }
+    for (k = 0; k < window; k++) {
+        if ((n = readahead_window_number(s, k)) < 0)
+            break;
+        for (i = 0; i < ra->nb_slots; i++)
+            if (ra->slots[i].state != RA_EMPTY && ra->slots[i].img_number == n)
+                break;
+        if (i < ra->nb_slots)
+            continue;
+        for (i = 0; i < ra->nb_slots; i++) {
+            if (ra->slots[i].state == RA_EMPTY) {
+                ra->slots[i].img_number = n;
+                ra->slots[i].state      = RA_QUEUED;
+                break;
+            }
+        }
+    }
+    pthread_cond_broadcast(&ra->cond);
+}
+
+static int readahead_read_packet(AVFormatContext *s1, AVPacket *pkt)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgReadAhead *ra = s->readahead_ctx;
+    ReadAheadSlot *slot;
+    int64_t mtime;
+    int i, ret, img_number;
+
+    pthread_mutex_lock(&ra->lock);
+    for (;;) {
+        readahead_schedule(s);
+        slot = NULL;
+        for (i = 0; i < ra->nb_slots; i++)
+            if (ra->slots[i].state == RA_DONE && ra->slots[i].img_number == s->img_number)
+                slot = &ra->slots[i];
+        if (slot)
+            break;
+        pthread_cond_wait(&ra->cond, &ra->lock);
+    }
+    av_packet_move_ref(pkt, &slot->pkt);
+    img_number = slot->img_number;
+    mtime = slot->mtime;
+    ret   = slot->ret;
+    slot->state = RA_EMPTY;
+    /* Keep the workers busy with the files following this one. */
+    if (ret >= 0) {
+        s->img_number++;
+        if (s->loop && s->img_number > s->img_last)
+            s->img_number = s->img_first;
+        readahead_schedule(s);
+    }
+    pthread_mutex_unlock(&ra->lock);
+
+    if (ret < 0)
+        return ret;
+
+    pkt->stream_index = 0;
+    pkt->flags       |= AV_PKT_FLAG_KEY;
+    if (s->ts_from_file) {
+        pkt->pts = mtime;
+        av_add_index_entry(s1->streams[0], img_number, pkt->pts, 0, 0, AVINDEX_KEYFRAME);
+    } else {
+        pkt->pts = s->pts;
+    }
+    s->img_count++;
+    s->pts++;
+    return 0;
+}
+
+static int readahead_init(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImgReadAhead *ra;
+    int i, ret;
+
+    ra = av_mallocz(sizeof(*ra));
+    if (!ra)
+        return AVERROR(ENOMEM);
+    ra->slots   = av_mallocz_array(s->readahead, sizeof(*ra->slots));
+    ra->threads = av_mallocz_array(s->readahead, sizeof(*ra->threads));
+    if (!ra->slots || !ra->threads) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    ra->nb_slots = s->readahead;
+    for (i = 0; i < ra->nb_slots; i++)
+        av_init_packet(&ra->slots[i].pkt);
+
+    if ((ret = pthread_mutex_init(&ra->lock, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&ra->cond, NULL))) {
+        pthread_mutex_destroy(&ra->lock);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    s->readahead_ctx = ra;
+
+    for (i = 0; i < s->readahead; i++) {
+        if ((ret = pthread_create(&ra->threads[i], NULL, readahead_thread, s1))) {
+            av_log(s1, AV_LOG_ERROR, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+            ret = AVERROR(ret);
+            break;
+        }
+        ra->nb_threads++;
+    }
+    return ra->nb_threads ? 0 : ret;
+
+fail:
+    av_freep(&ra->slots);
+    av_freep(&ra->threads);
+    av_freep(&ra);
+    return ret;
+}
+
+static void readahead_uninit(VideoDemuxData *s)
+{
+    ImgReadAhead *ra = s->readahead_ctx;
+    int i;
+
+    if (!ra)
+        return;
+
+    pthread_mutex_lock(&ra->lock);
+    ra->abort = 1;
+    pthread_cond_broadcast(&ra->cond);
+    pthread_mutex_unlock(&ra->lock);
+    for (i = 0; i < ra->nb_threads; i++)
+        pthread_join(ra->threads[i], NULL);
+
+    for (i = 0; i < ra->nb_slots; i++)
+        av_packet_unref(&ra->slots[i].pkt);
+    pthread_cond_destroy(&ra->cond);
+    pthread_mutex_destroy(&ra->lock);
+    av_freep(&ra->slots);
+    av_freep(&ra->threads);
+    av_freep(&s->readahead_ctx);
+}
+#endif
+
 int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
 {
     VideoDemuxData *s = s1->priv_data;
@@ -416,6 +722,18 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
         if (s->img_number > s->img_last)
             return AVERROR_EOF;
+#if HAVE_THREADS
+        /* The first file is read directly, it may be needed to probe the codec.
+         * User supplied I/O callbacks are only called from this thread. */
+        if (s->readahead > 0 && !s->readahead_ctx && s->img_count &&
+            s->pattern_type != PT_NONE && !s->split_planes && !s1->pb &&
+            ff_format_io_open_is_default(s1)) {
+            if ((res = readahead_init(s1)) < 0)
+                return res;
+        }
+        if (s->readahead_ctx)
+            return readahead_read_packet(s1, pkt);
+#endif
         if (s->pattern_type == PT_NONE) {
             av_strlcpy(filename_bytes, s->path, sizeof(filename_bytes));
         } else if (s->use_glob) {
@@ -567,10 +885,15 @@ fail:
     return res;
 }
 
-static int img_read_close(struct AVFormatContext* s1)
+int ff_img_read_close(struct AVFormatContext* s1)
 {
-#if HAVE_GLOB
+#if HAVE_GLOB || HAVE_THREADS
     VideoDemuxData *s = s1->priv_data;
+#endif
+#if HAVE_THREADS
+    readahead_uninit(s);
+#endif
+#if HAVE_GLOB
     if (s->use_glob) {
         globfree(&s->globstate);
     }
@@ -621,6 +944,7 @@ const AVOption ff_img_options[] = {
     { "sec",  "second precision",       0, AV_OPT_TYPE_CONST,    {.i64 = 1   }, 0, 2,       DEC, "ts_type" },
     { "ns",   "nano second precision",  0, AV_OPT_TYPE_CONST,    {.i64 = 2   }, 0, 2,       DEC, "ts_type" },
     { "export_path_metadata", "enable metadata containing input path information", OFFSET(export_path_metadata), AV_OPT_TYPE_BOOL,   {.i64 = 0   }, 0, 1,       DEC }, \
+    { "readahead",    "number of files to read ahead in worker threads", OFFSET(readahead), AV_OPT_TYPE_INT, {.i64 = 0   }, 0, 64,      DEC },
     COMMON_OPTIONS
 };
 
@@ -637,7 +961,7 @@ AVInputFormat ff_image2_demuxer = {
     .read_probe     = img_read_probe,
     .read_header    = ff_img_read_header,
     .read_packet    = ff_img_read_packet,
-    .read_close     = img_read_close,
+    .read_close     = ff_img_read_close,
     .read_seek      = img_read_seek,
     .flags          = AVFMT_NOFILE,
     .priv_class     = &img2_class,
@@ -27,6 +27,7 @@
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/time_internal.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -38,16 +39,37 @@ typedef struct VideoMuxData {
     int img_number;
     int split_planes;       /**< use independent file for each Y, U, V plane */
     char path[1024];
-    char tmp[4][1024];
-    char target[4][1024];
     int update;
     int use_strftime;
     int frame_pts;
     const char *muxer;
     int use_rename;
     AVDictionary *protocol_opts;
+    int write_threads;      /**< number of threads writing the files */
+    struct ImgWriter *writer;
 } VideoMuxData;
 
+#if HAVE_THREADS
+typedef struct WriteJob {
+    AVPacket pkt;
+    char filename[1024];
+} WriteJob;
+
+typedef struct ImgWriter {
+    pthread_t *threads;
+    int nb_threads;
+    WriteJob *jobs;         ///< FIFO of files to write
+    int nb_jobs;
+    int first_job;
+    int queued;             ///< number of jobs in the FIFO
+    int writing;            ///< number of jobs being written
+    int ret;                ///< first error of the writing threads
+    int abort;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} ImgWriter;
+#endif
+
 static int write_header(AVFormatContext *s)
 {
     VideoMuxData *img = s->priv_data;
@@ -125,49 +147,24 @@ static int write_packet_pipe(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
-static int write_packet(AVFormatContext *s, AVPacket *pkt)
+static int write_file(AVFormatContext *s, char *filename, AVPacket *pkt)
 {
     VideoMuxData *img = s->priv_data;
     AVIOContext *pb[4] = {0};
-    char filename[1024];
+    char tmp[4][1024];
+    char target[4][1024];
     AVCodecParameters *par = s->streams[pkt->stream_index]->codecpar;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(par->format);
     int ret, i;
     int nb_renames = 0;
     AVDictionary *options = NULL;
 
-    if (img->update) {
-        av_strlcpy(filename, img->path, sizeof(filename));
-    } else if (img->use_strftime) {
-        time_t now0;
-        struct tm *tm, tmpbuf;
-        time(&now0);
-        tm = localtime_r(&now0, &tmpbuf);
-        if (!strftime(filename, sizeof(filename), img->path, tm)) {
-            av_log(s, AV_LOG_ERROR, "Could not get frame filename with strftime\n");
-            return AVERROR(EINVAL);
-        }
-    } else if (img->frame_pts) {
-        if (av_get_frame_filename2(filename, sizeof(filename), img->path, pkt->pts, AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
-            av_log(s, AV_LOG_ERROR, "Cannot write filename by pts of the frames.");
-            return AVERROR(EINVAL);
-        }
-    } else if (av_get_frame_filename2(filename, sizeof(filename), img->path,
-                                      img->img_number,
-                                      AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0 &&
-               img->img_number > 1) {
-        av_log(s, AV_LOG_ERROR,
-               "Could not get frame filename number %d from pattern '%s'. "
-               "Use '-frames:v 1' for a single image, or '-update' option, or use a pattern such as %%03d within the filename.\n",
-               img->img_number, img->path);
-        return AVERROR(EINVAL);
-    }
     for (i = 0; i < 4; i++) {
         av_dict_copy(&options, img->protocol_opts, 0);
-        snprintf(img->tmp[i], sizeof(img->tmp[i]), "%s.tmp", filename);
-        av_strlcpy(img->target[i], filename, sizeof(img->target[i]));
-        if (s->io_open(s, &pb[i], img->use_rename ? img->tmp[i] : filename, AVIO_FLAG_WRITE, &options) < 0) {
-            av_log(s, AV_LOG_ERROR, "Could not open file : %s\n", img->use_rename ? img->tmp[i] : filename);
+        snprintf(tmp[i], sizeof(tmp[i]), "%s.tmp", filename);
+        av_strlcpy(target[i], filename, sizeof(target[i]));
+        if (s->io_open(s, &pb[i], img->use_rename ? tmp[i] : filename, AVIO_FLAG_WRITE, &options) < 0) {
+            av_log(s, AV_LOG_ERROR, "Could not open file : %s\n", img->use_rename ? tmp[i] : filename);
             ret = AVERROR(EIO);
             goto fail;
         }
@@ -210,12 +207,10 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
     avio_flush(pb[0]);
     ff_format_io_close(s, &pb[0]);
     for (i = 0; i < nb_renames; i++) {
-        int ret = ff_rename(img->tmp[i], img->target[i], s);
+        int ret = ff_rename(tmp[i], target[i], s);
         if (ret < 0)
             return ret;
     }
-
-    img->img_number++;
     return 0;
 
 fail:
@@ -226,6 +221,226 @@ fail:
     return ret;
 }
 
+#if HAVE_THREADS
+static void *writer_thread(void *arg)
+{
+    AVFormatContext *s = arg;
+    VideoMuxData *img = s->priv_data;
+    ImgWriter *w = img->writer;
+
+    pthread_mutex_lock(&w->lock);
+    while (!w->abort) {
+        WriteJob *job;
+        AVPacket pkt;
+        char filename[1024];
+        int ret;
+
+        if (!w->queued) {
+            pthread_cond_wait(&w->cond, &w->lock);
+            continue;
+        }
+        job = &w->jobs[w->first_job];
+        av_packet_move_ref(&pkt, &job->pkt);
+        av_strlcpy(filename, job->filename, sizeof(filename));
+        w->first_job = (w->first_job + 1) % w->nb_jobs;
+        w->queued--;
+        w->writing++;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+
+        ret = write_file(s, filename, &pkt);
+        av_packet_unref(&pkt);
+
+        pthread_mutex_lock(&w->lock);
+        if (ret < 0 && !w->ret)
+            w->ret = ret;
+        w->writing--;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+/**
+ * Queue a file for the writing threads, waiting for a free entry if all
+ * threads are busy. Errors of previously queued files are returned.
+ */
+static int writer_queue(AVFormatContext *s, const char *filename, AVPacket *pkt)
+{
+    VideoMuxData *img = s->priv_data;
+    ImgWriter *w = img->writer;
+    WriteJob *job;
+    int ret;
+
+    pthread_mutex_lock(&w->lock);
+    while (w->queued == w->nb_jobs && !w->ret)
+        pthread_cond_wait(&w->cond, &w->lock);
+    if ((ret = w->ret) < 0)
+        goto end;
+    job = &w->jobs[(w->first_job + w->queued) % w->nb_jobs];
+    if ((ret = av_packet_ref(&job->pkt, pkt)) < 0)
+        goto end;
+    av_strlcpy(job->filename, filename, sizeof(job->filename));
+    w->queued++;
+    pthread_cond_broadcast(&w->cond);
+end:
+    pthread_mutex_unlock(&w->lock);
+    return ret;
+}
+
+static int writer_flush(AVFormatContext *s)
+{
+    VideoMuxData *img = s->priv_data;
+    ImgWriter *w = img->writer;
+    int ret;
+
+    pthread_mutex_lock(&w->lock);
+    while ((w->queued || w->writing) && !w->abort)
+        pthread_cond_wait(&w->cond, &w->lock);
+    ret = w->ret;
+    pthread_mutex_unlock(&w->lock);
+    return ret;
+}
+
+static int writer_init(AVFormatContext *s)
+{
+    VideoMuxData *img = s->priv_data;
+    ImgWriter *w;
+    int i, ret;
+
+    w = av_mallocz(sizeof(*w));
+    if (!w)
+        return AVERROR(ENOMEM);
+    w->nb_jobs = 2 * img->write_threads;
+    w->jobs    = av_mallocz_array(w->nb_jobs, sizeof(*w->jobs));
+    w->threads = av_mallocz_array(img->write_threads, sizeof(*w->threads));
+    if (!w->jobs || !w->threads) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    if ((ret = pthread_mutex_init(&w->lock, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&w->cond, NULL))) {
+        pthread_mutex_destroy(&w->lock);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    img->writer = w;
+
+    for (i = 0; i < img->write_threads; i++) {
+        if ((ret = pthread_create(&w->threads[i], NULL, writer_thread, s))) {
+            av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+            ret = AVERROR(ret);
+            break;
+        }
+        w->nb_threads++;
+    }
+    return w->nb_threads ? 0 : ret;
+
+fail:
+    av_freep(&w->jobs);
+    av_freep(&w->threads);
+    av_freep(&w);
+    return ret;
+}
+
+static void writer_uninit(AVFormatContext *s)
+{
+    VideoMuxData *img = s->priv_data;
+    ImgWriter *w = img->writer;
+    int i;
+
+    if (!w)
+        return;
+
+    pthread_mutex_lock(&w->lock);
+    w->abort = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    for (i = 0; i < w->nb_threads; i++)
+        pthread_join(w->threads[i], NULL);
+
+    for (i = 0; i < w->nb_jobs; i++)
+        av_packet_unref(&w->jobs[i].pkt);
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+    av_freep(&w->jobs);
+    av_freep(&w->threads);
+    av_freep(&img->writer);
+}
+#endif
+
+static int write_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    VideoMuxData *img = s->priv_data;
+    char filename[1024];
+    int ret;
+
+    if (img->update) {
+        av_strlcpy(filename, img->path, sizeof(filename));
+    } else if (img->use_strftime) {
+        time_t now0;
+        struct tm *tm, tmpbuf;
+        time(&now0);
+        tm = localtime_r(&now0, &tmpbuf);
+        if (!strftime(filename, sizeof(filename), img->path, tm)) {
+            av_log(s, AV_LOG_ERROR, "Could not get frame filename with strftime\n");
+            return AVERROR(EINVAL);
+        }
+    } else if (img->frame_pts) {
+        if (av_get_frame_filename2(filename, sizeof(filename), img->path, pkt->pts, AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
+            av_log(s, AV_LOG_ERROR, "Cannot write filename by pts of the frames.");
+            return AVERROR(EINVAL);
+        }
+    } else if (av_get_frame_filename2(filename, sizeof(filename), img->path,
+                                      img->img_number,
+                                      AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0 &&
+               img->img_number > 1) {
+        av_log(s, AV_LOG_ERROR,
+               "Could not get frame filename number %d from pattern '%s'. "
+               "Use '-frames:v 1' for a single image, or '-update' option, or use a pattern such as %%03d within the filename.\n",
+               img->img_number, img->path);
+        return AVERROR(EINVAL);
+    }
+
+#if HAVE_THREADS
+    /* Files with the same name must be written in order, and user
+     * supplied I/O callbacks are only called from this thread. */
+    if (img->write_threads > 0 && !img->update && !img->use_strftime &&
+        !img->frame_pts && ff_format_io_open_is_default(s)) {
+        if (!img->writer && (ret = writer_init(s)) < 0)
+            return ret;
+        ret = writer_queue(s, filename, pkt);
+    } else
+#endif
+    ret = write_file(s, filename, pkt);
+    if (ret < 0)
+        return ret;
+
+    img->img_number++;
+    return 0;
+}
+
+static int write_trailer(AVFormatContext *s)
+{
+#if HAVE_THREADS
+    VideoMuxData *img = s->priv_data;
+
+    if (img->writer)
+        return writer_flush(s);
+#endif
+    return 0;
+}
+
+static void deinit(AVFormatContext *s)
+{
+#if HAVE_THREADS
+    writer_uninit(s);
+#endif
+}
+
 static int query_codec(enum AVCodecID id, int std_compliance)
 {
     int i;
@@ -246,6 +461,7 @@ static const AVOption muxoptions[] = {
     { "frame_pts",    "use current frame pts for filename", OFFSET(frame_pts),  AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, ENC },
     { "atomic_writing", "write files atomically (using temporary files and renames)", OFFSET(use_rename), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, ENC },
     { "protocol_opts", "specify protocol options for the opened files", OFFSET(protocol_opts), AV_OPT_TYPE_DICT, {0}, 0, 0, ENC },
+    { "write_threads", "write the files with the given number of threads", OFFSET(write_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, ENC },
     { NULL },
 };
 
@@ -267,6 +483,8 @@ AVOutputFormat ff_image2_muxer = {
     .video_codec    = AV_CODEC_ID_MJPEG,
     .write_header   = write_header,
     .write_packet   = write_packet,
+    .write_trailer  = write_trailer,
+    .deinit         = deinit,
     .query_codec    = query_codec,
     .flags          = AVFMT_NOTIMESTAMPS | AVFMT_NODIMENSIONS | AVFMT_NOFILE,
     .priv_class     = &img2mux_class,
@@ -24,6 +24,7 @@
 #include <stdint.h>
 
 #include "libavutil/bprint.h"
+#include "libavcodec/packet_internal.h"
 #include "avformat.h"
 #include "os_support.h"
 
@@ -98,6 +99,13 @@ struct AVFormatInternal {
 #define RAW_PACKET_BUFFER_SIZE 2500000
     int raw_packet_buffer_remaining_size;
 
+    /**
+     * Pool for the packet buffers allocated while demuxing,
+     * with AVFMT_FLAG_POOL_PACKETS.
+     * Only used from the thread calling the demuxer.
+     */
+    FFPacketPool *packet_pool;
+
     /**
      * Offset to remap timestamps to be non-negative.
      * Expressed in timebase units.
@@ -485,6 +493,14 @@ int ff_framehash_write_header(AVFormatContext *s);
  */
 int ff_read_packet(AVFormatContext *s, AVPacket *pkt);
 
+/**
+ * Like av_get_packet(), but take the packet data from the packet pool of s
+ * when AVFMT_FLAG_POOL_PACKETS is set.
+ *
+ * @param pb context to read from, not necessarily s->pb
+ */
+int ff_get_packet(AVFormatContext *s, AVIOContext *pb, AVPacket *pkt, int size);
+
 /**
  * Interleave an AVPacket per dts so it can be muxed.
  *
@@ -648,6 +664,13 @@ int ff_format_output_open(AVFormatContext *s, const char *url, AVDictionary **op
  */
 void ff_format_io_close(AVFormatContext *s, AVIOContext **pb);
 
+/**
+ * Check whether AVFormatContext.io_open is still the default callback.
+ * Callers may only use it from other threads if it is, user callbacks are
+ * not required to be thread-safe.
+ */
+int ff_format_io_open_is_default(AVFormatContext *s);
+
 /**
  * Utility function to check if the file uses http or https protocol
  *
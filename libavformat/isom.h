@@ -169,6 +169,7 @@ typedef struct MOVStreamContext {
     unsigned int ctts_count;
     unsigned int ctts_allocated_size;
     MOVStts *ctts_data;
+    int ctts_compact;     ///< ctts_data is still run-length coded and not 1-1 with the index entries
     unsigned int stsc_count;
     MOVStsc *stsc_data;
     unsigned int stsc_index;
@@ -3343,6 +3343,51 @@ static int64_t add_ctts_entry(MOVStts** ctts_data, unsigned int* ctts_count, uns
     return *ctts_count;
 }
 
+/**
+ * Expand run-length coded ctts entries such that there is a 1-1 mapping
+ * with the first nb_entries index entries, keeping the current read
+ * position. This is needed before samples of fragments are inserted.
+ */
+static int mov_expand_ctts(MOVStreamContext *sc, unsigned int nb_entries)
+{
+    MOVStts *ctts_data_old = sc->ctts_data;
+    unsigned int ctts_count_old = sc->ctts_count;
+    int64_t ctts_pos = sc->ctts_sample;
+    unsigned int i, j;
+
+    if (!sc->ctts_compact)
+        return 0;
+    sc->ctts_compact = 0;
+
+    if (nb_entries >= UINT_MAX / sizeof(*sc->ctts_data))
+        return AVERROR_INVALIDDATA;
+    for (i = 0; i < (unsigned)sc->ctts_index && i < ctts_count_old; i++)
+        ctts_pos += ctts_data_old[i].count;
+
+    sc->ctts_count = 0;
+    sc->ctts_allocated_size = 0;
+    sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
+                                    FFMAX(nb_entries, 1) * sizeof(*sc->ctts_data));
+    if (!sc->ctts_data) {
+        av_free(ctts_data_old);
+        return AVERROR(ENOMEM);
+    }
+    memset(sc->ctts_data, 0, sc->ctts_allocated_size);
+
+    for (i = 0; i < ctts_count_old && sc->ctts_count < nb_entries; i++) {
+        for (j = 0; j < ctts_data_old[i].count && sc->ctts_count < nb_entries; j++) {
+            sc->ctts_data[sc->ctts_count].count    = 1;
+            sc->ctts_data[sc->ctts_count].duration = ctts_data_old[i].duration;
+            sc->ctts_count++;
+        }
+    }
+    av_free(ctts_data_old);
+
+    sc->ctts_index  = FFMIN(ctts_pos, sc->ctts_count);
+    sc->ctts_sample = 0;
+    return 0;
+}
+
 #define MAX_REORDER_DELAY 16
 static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
 {
@@ -3767,8 +3812,6 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     unsigned int stps_index = 0;
     unsigned int i, j;
     uint64_t stream_size = 0;
-    MOVStts *ctts_data_old = sc->ctts_data;
-    unsigned int ctts_count_old = sc->ctts_count;
 
     if (sc->elst_count) {
         int i, edit_start_index = 0, multiple_edits = 0;
@@ -3838,30 +3881,10 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
         st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
 
-        if (ctts_data_old) {
-            // Expand ctts entries such that we have a 1-1 mapping with samples
-            if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
-                return;
-            sc->ctts_count = 0;
-            sc->ctts_allocated_size = 0;
-            sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
-                                    sc->sample_count * sizeof(*sc->ctts_data));
-            if (!sc->ctts_data) {
-                av_free(ctts_data_old);
-                return;
-            }
-
-            memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
-
-            for (i = 0; i < ctts_count_old &&
-                        sc->ctts_count < sc->sample_count; i++)
-                for (j = 0; j < ctts_data_old[i].count &&
-                            sc->ctts_count < sc->sample_count; j++)
-                    add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
-                                   &sc->ctts_allocated_size, 1,
-                                   ctts_data_old[i].duration);
-            av_free(ctts_data_old);
-        }
+        // Keep the ctts entries run-length coded, they are only expanded to
+        // one entry per sample if fragments have to be merged into the index.
+        if (sc->ctts_data)
+            sc->ctts_compact = 1;
 
         for (i = 0; i < sc->chunk_count; i++) {
             int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
@@ -4740,7 +4763,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts, pts = AV_NOPTS_VALUE;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i;
+    int flags, distance, i, ret;
     int64_t prev_dts = AV_NOPTS_VALUE;
     int next_frag_index = -1, index_entry_pos;
     size_t requested_size;
@@ -4840,6 +4863,9 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     if (entries == 0)
         return 0;
 
+    if ((ret = mov_expand_ctts(sc, st->nb_index_entries)) < 0)
+        return ret;
+
     requested_size = (st->nb_index_entries + entries) * sizeof(AVIndexEntry);
     new_entries = av_fast_realloc(st->index_entries,
                                   &st->index_entries_allocated_size,
@@ -7889,7 +7915,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         if (st->codecpar->codec_id == AV_CODEC_ID_EIA_608 && sample->size > 8)
             ret = get_eia608_packet(sc->pb, pkt, sample->size);
         else
-            ret = av_get_packet(sc->pb, pkt, sample->size);
+            ret = ff_get_packet(s, sc->pb, pkt, sample->size);
         if (ret < 0) {
             if (should_retry(sc->pb, ret)) {
                 mov_current_sample_dec(sc);
@@ -2346,26 +2346,16 @@ static int mov_write_stsd_tag(AVFormatContext *s, AVIOContext *pb, MOVMuxContext
 static int mov_write_ctts_tag(AVFormatContext *s, AVIOContext *pb, MOVTrack *track)
 {
     MOVMuxContext *mov = s->priv_data;
-    MOVStts *ctts_entries;
-    uint32_t entries = 0;
+    uint32_t entries = 0, count = 0;
     uint32_t atom_size;
     int i;
 
-    ctts_entries = av_malloc_array((track->entry + 1), sizeof(*ctts_entries)); /* worst case */
-    if (!ctts_entries)
-        return AVERROR(ENOMEM);
-    ctts_entries[0].count = 1;
-    ctts_entries[0].duration = track->cluster[0].cts;
-    for (i = 1; i < track->entry; i++) {
-        if (track->cluster[i].cts == ctts_entries[entries].duration) {
-            ctts_entries[entries].count++; /* compress */
-        } else {
+    /* Count the runs first, so the table can be written without keeping
+     * a copy of it in memory. */
+    for (i = 0; i < track->entry; i++)
+        if (!i || track->cluster[i].cts != track->cluster[i - 1].cts)
             entries++;
-            ctts_entries[entries].duration = track->cluster[i].cts;
-            ctts_entries[entries].count = 1;
-        }
-    }
-    entries++; /* last one */
+
     atom_size = 16 + (entries * 8);
     avio_wb32(pb, atom_size); /* size */
     ffio_wfourcc(pb, "ctts");
@@ -2375,57 +2365,59 @@ static int mov_write_ctts_tag(AVFormatContext *s, AVIOContext *pb, MOVTrack *tra
         avio_w8(pb, 0); /* version */
     avio_wb24(pb, 0); /* flags */
     avio_wb32(pb, entries); /* entry count */
-    for (i = 0; i < entries; i++) {
-        avio_wb32(pb, ctts_entries[i].count);
-        avio_wb32(pb, ctts_entries[i].duration);
+    for (i = 0; i < track->entry; i++) {
+        count++; /* compress */
+        if (i + 1 == track->entry || track->cluster[i + 1].cts != track->cluster[i].cts) {
+            avio_wb32(pb, count);
+            avio_wb32(pb, track->cluster[i].cts);
+            count = 0;
+        }
     }
-    av_free(ctts_entries);
     return atom_size;
 }
 
 /* Time to sample atom */
 static int mov_write_stts_tag(AVIOContext *pb, MOVTrack *track)
 {
-    MOVStts *stts_entries = NULL;
-    uint32_t entries = -1;
+    uint32_t entries = 0, count = 0;
     uint32_t atom_size;
-    int i;
+    int i, duration, next_duration;
+    int audio_cbr = track->par->codec_type == AVMEDIA_TYPE_AUDIO && !track->audio_vbr;
 
-    if (track->par->codec_type == AVMEDIA_TYPE_AUDIO && !track->audio_vbr) {
-        stts_entries = av_malloc(sizeof(*stts_entries)); /* one entry */
-        if (!stts_entries)
-            return AVERROR(ENOMEM);
-        stts_entries[0].count = track->sample_count;
-        stts_entries[0].duration = 1;
+    if (audio_cbr) {
         entries = 1;
     } else {
-        if (track->entry) {
-            stts_entries = av_malloc_array(track->entry, sizeof(*stts_entries)); /* worst case */
-            if (!stts_entries)
-                return AVERROR(ENOMEM);
-        }
+        /* Count the runs first, so the table can be written without
+         * keeping a copy of it in memory. */
+        duration = -1;
         for (i = 0; i < track->entry; i++) {
-            int duration = get_cluster_duration(track, i);
-            if (i && duration == stts_entries[entries].duration) {
-                stts_entries[entries].count++; /* compress */
-            } else {
+            next_duration = get_cluster_duration(track, i);
+            if (!i || next_duration != duration)
                 entries++;
-                stts_entries[entries].duration = duration;
-                stts_entries[entries].count = 1;
-            }
+            duration = next_duration;
         }
-        entries++; /* last one */
     }
     atom_size = 16 + (entries * 8);
     avio_wb32(pb, atom_size); /* size */
     ffio_wfourcc(pb, "stts");
     avio_wb32(pb, 0); /* version & flags */
     avio_wb32(pb, entries); /* entry count */
-    for (i = 0; i < entries; i++) {
-        avio_wb32(pb, stts_entries[i].count);
-        avio_wb32(pb, stts_entries[i].duration);
+    if (audio_cbr) {
+        avio_wb32(pb, track->sample_count);
+        avio_wb32(pb, 1);
+    } else if (track->entry) {
+        duration = get_cluster_duration(track, 0);
+        for (i = 0; i < track->entry; i++) {
+            next_duration = get_cluster_duration(track, i + 1);
+            count++; /* compress */
+            if (i + 1 == track->entry || next_duration != duration) {
+                avio_wb32(pb, count);
+                avio_wb32(pb, duration);
+                count = 0;
+            }
+            duration = next_duration;
+        }
     }
-    av_free(stts_entries);
     return atom_size;
 }
 
@@ -4707,21 +4699,21 @@ static int mov_write_prft_tag(AVIOContext *pb, MOVMuxContext *mov, int tracks)
         return 0;
     }
 
-    if (first_track->cluster[0].pts == AV_NOPTS_VALUE) {
+    if (first_track->cluster_pts == AV_NOPTS_VALUE) {
         av_log(mov->fc, AV_LOG_WARNING, "Unable to write PRFT, first PTS is invalid\n");
         return 0;
     }
 
     if (mov->write_prft == MOV_PRFT_SRC_WALLCLOCK) {
-        if (first_track->cluster[0].prft.wallclock) {
+        if (first_track->cluster_prft.wallclock) {
             /* Round the NTP time to whole milliseconds. */
-            ntp_ts = ff_get_formatted_ntp_time((first_track->cluster[0].prft.wallclock / 1000) * 1000 +
+            ntp_ts = ff_get_formatted_ntp_time((first_track->cluster_prft.wallclock / 1000) * 1000 +
                                                NTP_OFFSET_US);
-            flags = first_track->cluster[0].prft.flags;
+            flags = first_track->cluster_prft.flags;
         } else
             ntp_ts = ff_get_formatted_ntp_time(ff_ntp_time());
     } else if (mov->write_prft == MOV_PRFT_SRC_PTS) {
-        pts_us = av_rescale_q(first_track->cluster[0].pts,
+        pts_us = av_rescale_q(first_track->cluster_pts,
                               first_track->st->time_base, AV_TIME_BASE_Q);
         ntp_ts = ff_get_formatted_ntp_time(pts_us + NTP_OFFSET_US);
     } else {
@@ -4736,7 +4728,7 @@ static int mov_write_prft_tag(AVIOContext *pb, MOVMuxContext *mov, int tracks)
     avio_wb24(pb, flags);                       // Flags
     avio_wb32(pb, first_track->track_id);       // reference track ID
     avio_wb64(pb, ntp_ts);                      // NTP time stamp
-    avio_wb64(pb, first_track->cluster[0].pts); //media time
+    avio_wb64(pb, first_track->cluster_pts); //media time
     return update_size(pb, pos);
 }
 
@@ -5647,7 +5639,8 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     trk->cluster[trk->entry].size             = size;
     trk->cluster[trk->entry].entries          = samples_in_chunk;
     trk->cluster[trk->entry].dts              = pkt->dts;
-    trk->cluster[trk->entry].pts              = pkt->pts;
+    if (!trk->entry)
+        trk->cluster_pts = pkt->pts;
     if (!trk->entry && trk->start_dts != AV_NOPTS_VALUE) {
         if (!trk->frag_discont) {
             /* First packet of a new fragment. We already wrote the duration
@@ -5748,11 +5741,15 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         trk->has_disposable++;
     }
 
-    prft = (AVProducerReferenceTime *)av_packet_get_side_data(pkt, AV_PKT_DATA_PRFT, &prft_size);
-    if (prft && prft_size == sizeof(AVProducerReferenceTime))
-        memcpy(&trk->cluster[trk->entry].prft, prft, prft_size);
-    else
-        memset(&trk->cluster[trk->entry].prft, 0, sizeof(AVProducerReferenceTime));
+    /* Only the producer reference time of the first sample of a fragment
+     * is ever written, so don't keep one per sample. */
+    if (!trk->entry) {
+        prft = (AVProducerReferenceTime *)av_packet_get_side_data(pkt, AV_PKT_DATA_PRFT, &prft_size);
+        if (prft && prft_size == sizeof(AVProducerReferenceTime))
+            memcpy(&trk->cluster_prft, prft, prft_size);
+        else
+            memset(&trk->cluster_prft, 0, sizeof(AVProducerReferenceTime));
+    }
 
     trk->entry++;
     trk->sample_count += samples_in_chunk;
@@ -46,7 +46,6 @@
 typedef struct MOVIentry {
     uint64_t     pos;
     int64_t      dts;
-    int64_t      pts;
     unsigned int size;
     unsigned int samples_in_chunk;
     unsigned int chunkNum;              ///< Chunk number if the current entry is a chunk start otherwise 0
@@ -56,7 +55,6 @@ typedef struct MOVIentry {
 #define MOV_PARTIAL_SYNC_SAMPLE 0x0002
 #define MOV_DISPOSABLE_SAMPLE   0x0004
     uint32_t     flags;
-    AVProducerReferenceTime prft;
 } MOVIentry;
 
 typedef struct HintSample {
@@ -112,6 +110,8 @@ typedef struct MOVTrack {
     uint8_t     *vos_data;
     MOVIentry   *cluster;
     unsigned    cluster_capacity;
+    int64_t     cluster_pts;  ///< pts of the first entry in cluster
+    AVProducerReferenceTime cluster_prft; ///< producer reference time of the first entry in cluster
     int         audio_vbr;
     int         height; ///< active picture (w/o VBI) height for D-10/IMX
     uint32_t    tref_tag;
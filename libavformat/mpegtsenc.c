@@ -71,6 +71,9 @@ enum {
     MPEGTS_SERVICE_TYPE_ADVANCED_CODEC_DIGITAL_HDTV  = 0x19,
     MPEGTS_SERVICE_TYPE_HEVC_DIGITAL_HDTV            = 0x1F,
 };
+/* number of TS packets collected before they are passed to the AVIOContext */
+#define TS_BATCH_PACKETS 32
+
 typedef struct MpegTSWrite {
     const AVClass *av_class;
     MpegTSSection pat; /* MPEG-2 PAT table */
@@ -92,6 +95,8 @@ typedef struct MpegTSWrite {
     int pmt_start_pid;
     int start_pid;
     int m2ts_mode;
+    uint8_t batch[TS_BATCH_PACKETS * (TS_PACKET_SIZE + 4)];
+    int batch_len;
     int m2ts_video_pid;
     int m2ts_audio_pid;
     int m2ts_pgssub_pid;
@@ -103,6 +108,7 @@ typedef struct MpegTSWrite {
 #define MPEGTS_FLAG_PAT_PMT_AT_FRAMES           0x04
 #define MPEGTS_FLAG_SYSTEM_B        0x08
 #define MPEGTS_FLAG_DISCONT         0x10
+#define MPEGTS_FLAG_PCR_ALIGN       0x20
     int flags;
     int copyts;
     int tables_version;
@@ -802,23 +808,66 @@ invalid:
     return 0;
 }
 
+/* output position, including the packets which are not flushed yet */
+static int64_t ts_tell(const MpegTSWrite *ts, AVIOContext *pb)
+{
+    return avio_tell(pb) + ts->batch_len;
+}
+
 static int64_t get_pcr(const MpegTSWrite *ts, AVIOContext *pb)
 {
-    return av_rescale(avio_tell(pb) + 11, 8 * PCR_TIME_BASE, ts->mux_rate) +
+    return av_rescale(ts_tell(ts, pb) + 11, 8 * PCR_TIME_BASE, ts->mux_rate) +
            ts->first_pcr;
 }
 
-static void write_packet(AVFormatContext *s, const uint8_t *packet)
+/* with pcr_align, PCRs are only written at the start of an output packet */
+static int pcr_aligned(AVFormatContext *s)
 {
     MpegTSWrite *ts = s->priv_data;
+
+    return !(ts->flags & MPEGTS_FLAG_PCR_ALIGN) || ts->mux_rate <= 1 ||
+           !s->pb->max_packet_size ||
+           !(ts_tell(ts, s->pb) % s->pb->max_packet_size);
+}
+
+static void flush_batch(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    if (ts->batch_len) {
+        avio_write(s->pb, ts->batch, ts->batch_len);
+        ts->batch_len = 0;
+    }
+}
+
+/* Get the buffer for the next TS packet, it is output by commit_packet() */
+static uint8_t *get_packet_buf(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    uint8_t *buf = ts->batch + ts->batch_len;
+
     if (ts->m2ts_mode) {
-        int64_t pcr = get_pcr(s->priv_data, s->pb);
-        uint32_t tp_extra_header = pcr % 0x3fffffff;
-        tp_extra_header = AV_RB32(&tp_extra_header);
-        avio_write(s->pb, (unsigned char *) &tp_extra_header,
-                   sizeof(tp_extra_header));
+        int64_t pcr = get_pcr(ts, s->pb);
+        AV_WB32(buf, pcr % 0x3fffffff);
+        buf += 4;
     }
-    avio_write(s->pb, packet, TS_PACKET_SIZE);
+    return buf;
+}
+
+static void commit_packet(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    ts->batch_len += TS_PACKET_SIZE + (ts->m2ts_mode ? 4 : 0);
+    /* with direct IO, every write is passed through to the protocol */
+    if (ts->batch_len > sizeof(ts->batch) - (TS_PACKET_SIZE + 4) || s->pb->direct)
+        flush_batch(s);
+}
+
+static void write_packet(AVFormatContext *s, const uint8_t *packet)
+{
+    memcpy(get_packet_buf(s), packet, TS_PACKET_SIZE);
+    commit_packet(s);
 }
 
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
@@ -1112,6 +1161,12 @@ static int mpegts_init(AVFormatContext *s)
     ts->pat_period = av_rescale(ts->pat_period_us, PCR_TIME_BASE, AV_TIME_BASE);
     ts->sdt_period = av_rescale(ts->sdt_period_us, PCR_TIME_BASE, AV_TIME_BASE);
 
+    if (ts->mux_rate > 1 && s->pb && s->pb->max_packet_size &&
+        s->pb->max_packet_size % (TS_PACKET_SIZE + (ts->m2ts_mode ? 4 : 0)))
+        av_log(s, AV_LOG_WARNING, "Output packet size %d is not a multiple of "
+               "the TS packet size, packets will straddle datagrams\n",
+               s->pb->max_packet_size);
+
     if (ts->mux_rate == 1)
         av_log(s, AV_LOG_VERBOSE, "muxrate VBR, ");
     else
@@ -1167,7 +1222,7 @@ static int write_pcr_bits(uint8_t *buf, int64_t pcr)
 static void mpegts_insert_null_packet(AVFormatContext *s)
 {
     uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *buf = get_packet_buf(s);
 
     q    = buf;
     *q++ = 0x47;
@@ -1175,7 +1230,7 @@ static void mpegts_insert_null_packet(AVFormatContext *s)
     *q++ = 0xff;
     *q++ = 0x10;
     memset(q, 0x0FF, TS_PACKET_SIZE - (q - buf));
-    write_packet(s, buf);
+    commit_packet(s);
 }
 
 /* Write a single transport stream packet with a PCR and no payload */
@@ -1184,7 +1239,7 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
     MpegTSWrite *ts = s->priv_data;
     MpegTSWriteStream *ts_st = st->priv_data;
     uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *buf = get_packet_buf(s);
 
     q    = buf;
     *q++ = 0x47;
@@ -1204,7 +1259,7 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
-    write_packet(s, buf);
+    commit_packet(s);
 }
 
 static void write_pts(uint8_t *q, int fourbits, int64_t pts)
@@ -1264,15 +1319,17 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
 {
     MpegTSWriteStream *ts_st = st->priv_data;
     MpegTSWrite *ts = s->priv_data;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *buf;
     uint8_t *q;
-    int val, is_start, len, header_len, write_pcr, is_dvb_subtitle, is_dvb_teletext, flags;
+    int val, is_start, len, header_len, write_pcr, is_dvb_subtitle = 0, is_dvb_teletext, flags;
     int afc_len, stuffing_len;
     int64_t delay = av_rescale(s->max_delay, 90000, AV_TIME_BASE);
     int force_pat = st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && key && !ts_st->prev_payload_key;
     int force_sdt = 0;
+    int pid_hi = ts_st->pid >> 8;
 
-    av_assert0(ts_st->payload != buf || st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO);
+    if (ts->m2ts_mode && st->codecpar->codec_id == AV_CODEC_ID_AC3)
+        pid_hi |= 0x20;
     if (ts->flags & MPEGTS_FLAG_PAT_PMT_AT_FRAMES && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
         force_pat = 1;
     }
@@ -1299,7 +1356,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         if (ts->mux_rate > 1) {
             /* Send PCR packets for all PCR streams if needed */
             pcr = get_pcr(ts, s->pb);
-            if (pcr >= ts->next_pcr) {
+            if (pcr >= ts->next_pcr && pcr_aligned(s)) {
                 int64_t next_pcr = INT64_MAX;
                 for (int i = 0; i < s->nb_streams; i++) {
                     /* Make the current stream the last, because for that we
@@ -1338,12 +1395,30 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             }
         }
 
+        /* the packet is built in place in the output batch */
+        buf = get_packet_buf(s);
+
+        /* fast path for the packets in the middle of a PES, which carry
+         * nothing but payload */
+        if (!is_start && !write_pcr && !ts_st->discontinuity &&
+            payload_size >= TS_PACKET_SIZE - 4 &&
+            !(is_dvb_subtitle && payload_size == TS_PACKET_SIZE - 4)) {
+            ts_st->cc = ts_st->cc + 1 & 0xf;
+            buf[0] = 0x47;
+            buf[1] = pid_hi;
+            buf[2] = ts_st->pid;
+            buf[3] = 0x10 | ts_st->cc;
+            memcpy(buf + 4, payload, TS_PACKET_SIZE - 4);
+            payload      += TS_PACKET_SIZE - 4;
+            payload_size -= TS_PACKET_SIZE - 4;
+            commit_packet(s);
+            continue;
+        }
+
         /* prepare packet header */
         q    = buf;
         *q++ = 0x47;
-        val  = ts_st->pid >> 8;
-        if (ts->m2ts_mode && st->codecpar->codec_id == AV_CODEC_ID_AC3)
-            val |= 0x20;
+        val  = pid_hi;
         if (is_start)
             val |= 0x40;
         *q++      = val;
@@ -1357,7 +1432,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         }
         if (key && is_start && pts != AV_NOPTS_VALUE) {
             // set Random Access for key frames
-            if (ts_st->pcr_period)
+            if (ts_st->pcr_period && pcr_aligned(s))
                 write_pcr = 1;
             set_af_flag(buf, 0x40);
             q = get_ts_payload_start(buf);
@@ -1546,7 +1621,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
 
         payload      += len;
         payload_size -= len;
-        write_packet(s, buf);
+        commit_packet(s);
     }
     ts_st->prev_payload_key = key;
 }
@@ -1898,7 +1973,7 @@ static void mpegts_write_flush(AVFormatContext *s)
     }
 
     if (ts->m2ts_mode) {
-        int packets = (avio_tell(s->pb) / (TS_PACKET_SIZE + 4)) % 32;
+        int packets = (ts_tell(ts, s->pb) / (TS_PACKET_SIZE + 4)) % 32;
         while (packets++ < 32)
             mpegts_insert_null_packet(s);
     }
@@ -1906,18 +1981,24 @@ static void mpegts_write_flush(AVFormatContext *s)
 
 static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
+    int ret;
+
     if (!pkt) {
         mpegts_write_flush(s);
-        return 1;
+        ret = 1;
     } else {
-        return mpegts_write_packet_internal(s, pkt);
+        ret = mpegts_write_packet_internal(s, pkt);
     }
+    flush_batch(s);
+    return ret;
 }
 
 static int mpegts_write_end(AVFormatContext *s)
 {
-    if (s->pb)
+    if (s->pb) {
         mpegts_write_flush(s);
+        flush_batch(s);
+    }
 
     return 0;
 }
@@ -2015,6 +2096,8 @@ static const AVOption options[] = {
       0, AV_OPT_TYPE_CONST, { .i64 = MPEGTS_FLAG_SYSTEM_B }, 0, INT_MAX, ENC, "mpegts_flags" },
     { "initial_discontinuity", "Mark initial packets as discontinuous",
       0, AV_OPT_TYPE_CONST, { .i64 = MPEGTS_FLAG_DISCONT }, 0, INT_MAX, ENC, "mpegts_flags" },
+    { "pcr_align", "Start output packets with the PCR packets in CBR mode",
+      0, AV_OPT_TYPE_CONST, { .i64 = MPEGTS_FLAG_PCR_ALIGN }, 0, INT_MAX, ENC, "mpegts_flags" },
     { "mpegts_copyts", "don't offset dts/pts", OFFSET(copyts), AV_OPT_TYPE_BOOL, { .i64 = -1 }, -1, 1, ENC },
     { "tables_version", "set PAT, PMT and SDT version", OFFSET(tables_version), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 31, ENC },
     { "omit_video_pes_length", "Omit the PES packet length for video packets",
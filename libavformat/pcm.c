@@ -41,7 +41,7 @@ int ff_pcm_read_packet(AVFormatContext *s, AVPacket *pkt)
     size = FFMAX(par->sample_rate/25, 1);
     size = FFMIN(size, RAW_SAMPLES) * par->block_align;
 
-    ret = av_get_packet(s->pb, pkt, size);
+    ret = ff_get_packet(s, s->pb, pkt, size);
 
     pkt->flags &= ~AV_PKT_FLAG_CORRUPT;
     pkt->stream_index = 0;
@@ -39,7 +39,7 @@ int ff_raw_read_partial_packet(AVFormatContext *s, AVPacket *pkt)
 
     size = raw->raw_packet_size;
 
-    if ((ret = av_new_packet(pkt, size)) < 0)
+    if ((ret = avpriv_packet_pool_new_packet(s->internal->packet_pool, pkt, size)) < 0)
         return ret;
 
     pkt->pos= avio_tell(s->pb);
@@ -42,6 +42,7 @@
 #include "os_support.h"
 #include "url.h"
 #include "ip.h"
+#include "mpegts.h"
 
 #ifdef __APPLE__
 #include "TargetConditionals.h"
@@ -80,6 +81,37 @@
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
 
+#define PCR_HZ          27000000LL
+#define PCR_WRAP        (300LL << 33)
+/* PCR steps beyond this are treated as discontinuities */
+#define PCR_MAX_GAP     PCR_HZ
+/* pacing is restarted when the byte clock drifts this far from wall clock */
+#define PACE_MAX_DRIFT  1000000
+
+/**
+ * PCR clock recovered from the TS packets carried in the datagrams, used to
+ * pace output and to measure PCR accuracy on input.
+ */
+typedef struct UDPPCRClock {
+    uint8_t partial[TS_PACKET_SIZE]; ///< TS packet split across datagrams
+    int partial_len;
+    int pcr_pid;                     ///< first PID seen carrying a PCR
+    int64_t pos;                     ///< stream offset of the next datagram
+    int64_t rate;                    ///< byte clock in bit/s, 0 if unknown
+    int64_t ref_pcr;                 ///< last PCR, AV_NOPTS_VALUE if none
+    int64_t ref_pos;                 ///< stream offset of the last PCR packet
+    int64_t ref_clock;               ///< wall clock of the last PCR in 27 MHz units
+
+    /* accuracy statistics, in microseconds */
+    int64_t last_time;
+    int64_t last_offset;
+    int64_t nb_pcr;
+    int64_t dev_sum;
+    int64_t dev_max;
+    int64_t offset_min;
+    int64_t offset_max;
+} UDPPCRClock;
+
 typedef struct UDPContext {
     const AVClass *class;
     int udp_fd;
@@ -102,6 +134,10 @@ typedef struct UDPContext {
     int circular_buffer_error;
     int64_t bitrate; /* number of bits to send per second */
     int64_t burst_bits;
+    int pcr_pace;
+    int pcr_stats;
+    UDPPCRClock pace_clock;
+    UDPPCRClock stats_clock;
     int close_req;
 #if HAVE_PTHREAD_CANCEL
     pthread_t circular_buffer_thread;
@@ -126,6 +162,8 @@ static const AVOption options[] = {
     { "buffer_size",    "System data size (in bytes)",                     OFFSET(buffer_size),    AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
     { "bitrate",        "Bits to send per second",                         OFFSET(bitrate),        AV_OPT_TYPE_INT64,  { .i64 = 0  },     0, INT64_MAX, .flags = E },
     { "burst_bits",     "Max length of bursts in bits (when using bitrate)", OFFSET(burst_bits),   AV_OPT_TYPE_INT64,  { .i64 = 0  },     0, INT64_MAX, .flags = E },
+    { "pcr_pace",       "Send MPEG-TS datagrams at the byte clock given by their PCRs", OFFSET(pcr_pace), AV_OPT_TYPE_BOOL, { .i64 = 0  },     0, 1,       .flags = E },
+    { "pcr_stats",      "Measure and report MPEG-TS PCR accuracy",          OFFSET(pcr_stats),      AV_OPT_TYPE_BOOL,   { .i64 = 0  },     0, 1,       .flags = D|E },
     { "localport",      "Local port",                                      OFFSET(local_port),     AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, D|E },
     { "local_port",     "Local port",                                      OFFSET(local_port),     AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
     { "localaddr",      "Local address",                                   OFFSET(localaddr),      AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -459,6 +497,174 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+static void pcr_clock_init(UDPPCRClock *c, int64_t rate)
+{
+    memset(c, 0, sizeof(*c));
+    c->pcr_pid    = -1;
+    c->rate       = rate;
+    c->ref_pcr    = AV_NOPTS_VALUE;
+    c->offset_min = INT64_MAX;
+    c->offset_max = INT64_MIN;
+}
+
+static int64_t ts_packet_pcr(UDPPCRClock *c, const uint8_t *p)
+{
+    int pid = AV_RB16(p + 1) & 0x1fff;
+
+    if (!(p[3] & 0x20) || p[4] < 7 || !(p[5] & 0x10))
+        return AV_NOPTS_VALUE;
+    if (c->pcr_pid < 0)
+        c->pcr_pid = pid;
+    else if (pid != c->pcr_pid)
+        return AV_NOPTS_VALUE;
+    return ((int64_t)AV_RB32(p + 6) << 1 | p[10] >> 7) * 300 +
+           ((p[10] & 1) << 8 | p[11]);
+}
+
+static int64_t pcr_diff(int64_t a, int64_t b)
+{
+    int64_t d = b - a;
+
+    if (d < -PCR_WRAP / 2)
+        d += PCR_WRAP;
+    else if (d > PCR_WRAP / 2)
+        d -= PCR_WRAP;
+    return d;
+}
+
+/**
+ * Find the first PCR of the PCR PID in a datagram.
+ *
+ * @param pkt_pos set to the offset of the PCR packet from the start of the
+ *                datagram, negative if the packet began in the previous one
+ * @return the PCR, or AV_NOPTS_VALUE if there is none
+ */
+static int64_t pcr_clock_scan(UDPPCRClock *c, const uint8_t *buf, int size,
+                              int *pkt_pos)
+{
+    int64_t pcr = AV_NOPTS_VALUE;
+    int pos = 0;
+
+    if (c->partial_len) {
+        pos = FFMIN(size, TS_PACKET_SIZE - c->partial_len);
+        memcpy(c->partial + c->partial_len, buf, pos);
+        c->partial_len += pos;
+        if (c->partial_len < TS_PACKET_SIZE)
+            return AV_NOPTS_VALUE;
+        c->partial_len = 0;
+        pcr = ts_packet_pcr(c, c->partial);
+        *pkt_pos = pos - TS_PACKET_SIZE;
+    }
+    while (pos < size) {
+        if (buf[pos] != 0x47) {
+            pos++;
+            continue;
+        }
+        if (size - pos < TS_PACKET_SIZE) {
+            c->partial_len = size - pos;
+            memcpy(c->partial, buf + pos, c->partial_len);
+            break;
+        }
+        if (pcr == AV_NOPTS_VALUE) {
+            pcr = ts_packet_pcr(c, buf + pos);
+            *pkt_pos = pos;
+        }
+        pos += TS_PACKET_SIZE;
+    }
+    return pcr;
+}
+
+/**
+ * Compute the wall clock time at which a datagram has to be sent for its
+ * TS packets to leave at the byte clock defined by the PCRs. Between PCRs
+ * the position is interpolated with the rate measured over the last PCR
+ * interval, or with the bitrate option if it is set.
+ */
+static int64_t pcr_clock_pace(UDPPCRClock *c, int64_t bitrate,
+                              const uint8_t *buf, int size, int64_t now)
+{
+    int64_t pos = c->pos, pcr, t;
+    int pkt_pos;
+
+    pcr = pcr_clock_scan(c, buf, size, &pkt_pos);
+    c->pos += size;
+    if (pcr != AV_NOPTS_VALUE) {
+        int64_t delta = c->ref_pcr == AV_NOPTS_VALUE ? -1 : pcr_diff(c->ref_pcr, pcr);
+        int64_t pcr_pos = pos + pkt_pos;
+
+        if (delta <= 0 || delta > PCR_MAX_GAP) {
+            /* first PCR or discontinuity, restart the clock */
+            c->ref_clock = now * 27;
+        } else {
+            if (!bitrate)
+                c->rate = av_rescale(pcr_pos - c->ref_pos, 8 * PCR_HZ, delta);
+            c->ref_clock += delta;
+        }
+        c->ref_pcr = pcr;
+        c->ref_pos = pcr_pos;
+    }
+    if (c->ref_pcr == AV_NOPTS_VALUE)
+        return now;
+
+    t = c->ref_clock / 27;
+    if (c->rate > 0)
+        t += av_rescale(pos - c->ref_pos, 8000000, c->rate);
+    if (FFABS(t - now) > PACE_MAX_DRIFT) {
+        /* the input fell behind real time or jumped ahead of it */
+        c->ref_clock += (now - t) * 27;
+        t = now;
+    }
+    return t;
+}
+
+/**
+ * Record the time a datagram was sent or received against its PCR.
+ */
+static void pcr_clock_measure(UDPPCRClock *c, const uint8_t *buf, int size,
+                              int64_t now)
+{
+    int64_t pcr, delta, offset;
+    int pkt_pos;
+
+    pcr = pcr_clock_scan(c, buf, size, &pkt_pos);
+    if (pcr == AV_NOPTS_VALUE)
+        return;
+
+    delta = c->ref_pcr == AV_NOPTS_VALUE ? -1 : pcr_diff(c->ref_pcr, pcr);
+    if (c->ref_pcr == AV_NOPTS_VALUE) {
+        c->ref_clock = now * 27;
+    } else if (delta <= 0 || delta > PCR_MAX_GAP) {
+        /* keep the offset continuous over discontinuities */
+        c->ref_clock = (now - c->last_offset) * 27;
+    } else {
+        int64_t dev = FFABS(now - c->last_time - delta / 27);
+
+        c->ref_clock += delta;
+        c->nb_pcr++;
+        c->dev_sum += dev;
+        c->dev_max  = FFMAX(c->dev_max, dev);
+    }
+    offset = now - c->ref_clock / 27;
+    c->offset_min  = FFMIN(c->offset_min, offset);
+    c->offset_max  = FFMAX(c->offset_max, offset);
+    c->last_offset = offset;
+    c->last_time   = now;
+    c->ref_pcr     = pcr;
+}
+
+static void pcr_clock_report(URLContext *h, UDPPCRClock *c)
+{
+    if (!c->nb_pcr) {
+        av_log(h, AV_LOG_INFO, "PCR accuracy: no PCR intervals seen\n");
+        return;
+    }
+    av_log(h, AV_LOG_INFO, "PCR accuracy (%s): %"PRId64" intervals, "
+           "interval jitter mean %"PRId64" us max %"PRId64" us, "
+           "overall jitter %"PRId64" us peak-to-peak\n",
+           h->flags & AVIO_FLAG_WRITE ? "sent" : "received", c->nb_pcr,
+           c->dev_sum / c->nb_pcr, c->dev_max, c->offset_max - c->offset_min);
+}
+
 #if HAVE_PTHREAD_CANCEL
 static void *circular_buffer_task_rx( void *_URLContext)
 {
@@ -485,6 +691,8 @@ static void *circular_buffer_task_rx( void *_URLContext)
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
         len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+        if (s->pcr_stats && len > 0 && !ff_ip_check_source_lists(&addr, &s->filters))
+            pcr_clock_measure(&s->stats_clock, s->tmp + 4, len, av_gettime_relative());
         pthread_mutex_lock(&s->mutex);
         if (len < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
@@ -563,10 +771,18 @@ static void *circular_buffer_task_tx( void *_URLContext)
         av_assert0(len <= sizeof(s->tmp));
 
         av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
+        if (s->pcr_pace)
+            pthread_cond_signal(&s->cond);
 
         pthread_mutex_unlock(&s->mutex);
 
-        if (s->bitrate) {
+        if (s->pcr_pace) {
+            target_timestamp = pcr_clock_pace(&s->pace_clock, s->bitrate,
+                                              s->tmp, len, av_gettime_relative());
+            timestamp = av_gettime_relative();
+            if (timestamp < target_timestamp)
+                av_usleep(target_timestamp - timestamp);
+        } else if (s->bitrate) {
             timestamp = av_gettime_relative();
             if (timestamp < target_timestamp) {
                 int64_t delay = target_timestamp - timestamp;
@@ -586,6 +802,9 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
+        if (s->pcr_stats)
+            pcr_clock_measure(&s->stats_clock, s->tmp, len, av_gettime_relative());
+
         p = s->tmp;
         while (len) {
             int ret;
@@ -604,6 +823,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
                     pthread_mutex_lock(&s->mutex);
                     s->circular_buffer_error = ret;
+                    pthread_cond_signal(&s->cond);
                     pthread_mutex_unlock(&s->mutex);
                     return NULL;
                 }
@@ -614,6 +834,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
     }
 
 end:
+    pthread_cond_signal(&s->cond);
     pthread_mutex_unlock(&s->mutex);
     return NULL;
 }
@@ -711,6 +932,16 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
             s->burst_bits = strtoll(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "pcr_pace", p)) {
+            s->pcr_pace = strtol(buf, NULL, 10);
+            if (!HAVE_PTHREAD_CANCEL)
+                av_log(h, AV_LOG_WARNING,
+                       "'pcr_pace' option was set but it is not supported "
+                       "on this build (pthread support is required)\n");
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "pcr_stats", p)) {
+            s->pcr_stats = strtol(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "localaddr", p)) {
             av_strlcpy(localaddr, buf, sizeof(localaddr));
         }
@@ -731,6 +962,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     s->circular_buffer_size *= 188;
     if (flags & AVIO_FLAG_WRITE) {
         h->max_packet_size = s->pkt_size;
+        /* paced output is sent in full datagrams only */
+        if (s->pcr_pace)
+            h->min_packet_size = s->pkt_size;
     } else {
         h->max_packet_size = UDP_MAX_PKT_SIZE;
     }
@@ -878,19 +1112,23 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+    pcr_clock_init(&s->pace_clock, s->bitrate);
+    pcr_clock_init(&s->stats_clock, 0);
+
 #if HAVE_PTHREAD_CANCEL
     /*
       Create thread in case of:
       1. Input and circular_buffer_size is set
-      2. Output and bitrate and circular_buffer_size is set
+      2. Output and bitrate or pcr_pace and circular_buffer_size is set
     */
 
-    if (is_output && s->bitrate && !s->circular_buffer_size) {
+    if (is_output && (s->bitrate || s->pcr_pace) && !s->circular_buffer_size) {
         /* Warn user in case of 'circular_buffer_size' is not set */
-        av_log(h, AV_LOG_WARNING,"'bitrate' option was set but 'circular_buffer_size' is not, but required\n");
+        av_log(h, AV_LOG_WARNING,"'bitrate' or 'pcr_pace' option was set but 'circular_buffer_size' is not, but required\n");
     }
 
-    if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
+    if ((!is_output && s->circular_buffer_size) ||
+        (is_output && (s->bitrate || s->pcr_pace) && s->circular_buffer_size)) {
         int ret;
 
         /* start the task going */
@@ -1001,6 +1239,8 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
         return ff_neterrno();
     if (ff_ip_check_source_lists(&addr, &s->filters))
         return AVERROR(EINTR);
+    if (s->pcr_stats)
+        pcr_clock_measure(&s->stats_clock, buf, ret, av_gettime_relative());
     return ret;
 }
 
@@ -1025,10 +1265,24 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
             return err;
         }
 
-        if(av_fifo_space(s->fifo) < size + 4) {
-            /* What about a partial packet tx ? */
-            pthread_mutex_unlock(&s->mutex);
-            return AVERROR(ENOMEM);
+        while (av_fifo_space(s->fifo) < size + 4) {
+            /* When pacing, wait for the sending thread to make room
+               instead of dropping the datagram */
+            if (!s->pcr_pace || size + 4 > s->circular_buffer_size) {
+                /* What about a partial packet tx ? */
+                pthread_mutex_unlock(&s->mutex);
+                return AVERROR(ENOMEM);
+            }
+            if (h->flags & AVIO_FLAG_NONBLOCK) {
+                pthread_mutex_unlock(&s->mutex);
+                return AVERROR(EAGAIN);
+            }
+            pthread_cond_wait(&s->cond, &s->mutex);
+            if (s->circular_buffer_error < 0) {
+                int err = s->circular_buffer_error;
+                pthread_mutex_unlock(&s->mutex);
+                return err;
+            }
         }
         AV_WL32(tmp, size);
         av_fifo_generic_write(s->fifo, tmp, 4, NULL); /* size of packet */
@@ -1051,6 +1305,9 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     } else
         ret = send(s->udp_fd, buf, size, 0);
 
+    if (ret > 0 && s->pcr_stats)
+        pcr_clock_measure(&s->stats_clock, buf, ret, av_gettime_relative());
+
     return ret < 0 ? ff_neterrno() : ret;
 }
 
@@ -1092,6 +1349,8 @@ static int udp_close(URLContext *h)
         pthread_cond_destroy(&s->cond);
     }
 #endif
+    if (s->pcr_stats)
+        pcr_clock_report(h, &s->stats_clock);
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
     ff_ip_reset_filters(&s->filters);
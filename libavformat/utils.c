@@ -262,7 +262,8 @@ int ffio_limit(AVIOContext *s, int size)
 
 /* Read the data in sane-sized chunks and append to pkt.
  * Return the number of bytes read or an error. */
-static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
+static int append_packet_chunked(AVIOContext *s, FFPacketPool *pool,
+                                 AVPacket *pkt, int size)
 {
     int orig_size      = pkt->size;
     int ret;
@@ -281,7 +282,7 @@ static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
                 read_size = FFMIN(read_size, SANE_CHUNK_SIZE);
         }
 
-        ret = av_grow_packet(pkt, read_size);
+        ret = avpriv_packet_pool_grow_packet(pool, pkt, read_size);
         if (ret < 0)
             break;
 
@@ -301,21 +302,31 @@ static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
     return pkt->size > orig_size ? pkt->size - orig_size : ret;
 }
 
-int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
+static int get_packet(AVIOContext *s, FFPacketPool *pool, AVPacket *pkt, int size)
 {
     av_init_packet(pkt);
     pkt->data = NULL;
     pkt->size = 0;
     pkt->pos  = avio_tell(s);
 
-    return append_packet_chunked(s, pkt, size);
+    return append_packet_chunked(s, pool, pkt, size);
+}
+
+int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
+{
+    return get_packet(s, NULL, pkt, size);
+}
+
+int ff_get_packet(AVFormatContext *s, AVIOContext *pb, AVPacket *pkt, int size)
+{
+    return get_packet(pb, s->internal->packet_pool, pkt, size);
 }
 
 int av_append_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
     if (!pkt->size)
         return av_get_packet(s, pkt, size);
-    return append_packet_chunked(s, pkt, size);
+    return append_packet_chunked(s, NULL, pkt, size);
 }
 
 int av_filename_number_test(const char *filename)
@@ -556,6 +567,14 @@ int avformat_open_input(AVFormatContext **ps, const char *filename,
     if ((ret = av_opt_set_dict(s, &tmp)) < 0)
         goto fail;
 
+    if (s->flags & AVFMT_FLAG_POOL_PACKETS) {
+        s->internal->packet_pool = avpriv_packet_pool_alloc();
+        if (!s->internal->packet_pool) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
     if (!(s->url = av_strdup(filename ? filename : ""))) {
         ret = AVERROR(ENOMEM);
         goto fail;
@@ -869,7 +888,7 @@ int ff_read_packet(AVFormatContext *s, AVPacket *pkt)
             continue;
         }
 
-        err = av_packet_make_refcounted(pkt);
+        err = avpriv_packet_pool_make_refcounted(s->internal->packet_pool, pkt);
         if (err < 0) {
             av_packet_unref(pkt);
             return err;
@@ -1487,7 +1506,7 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt,
                 goto fail;
             }
         } else {
-            ret = av_packet_make_refcounted(&out_pkt);
+            ret = avpriv_packet_pool_make_refcounted(s->internal->packet_pool, &out_pkt);
             if (ret < 0)
                 goto fail;
         }
@@ -4483,6 +4502,7 @@ void avformat_free_context(AVFormatContext *s)
     av_dict_free(&s->internal->id3v2_meta);
     av_freep(&s->streams);
     flush_packet_queue(s);
+    avpriv_packet_pool_free(&s->internal->packet_pool, s);
     av_freep(&s->internal);
     av_freep(&s->url);
     av_free(s);
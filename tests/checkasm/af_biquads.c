@@ -0,0 +1,84 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "libavfilter/af_biquadsdsp.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "checkasm.h"
+
+#define LEN 256
+#define SIZE (LEN * BIQUADS_NB_LANES)
+
+static void test_filter_tdii_lanes(const double *src, const double *coeffs,
+                                   const double *state)
+{
+    LOCAL_ALIGNED_32(double, cdst, [SIZE]);
+    LOCAL_ALIGNED_32(double, odst, [SIZE]);
+    double cstate[2 * BIQUADS_NB_LANES], ostate[2 * BIQUADS_NB_LANES];
+
+    declare_func(void, double *block, ptrdiff_t len, double *state,
+                 const double *coeffs);
+
+    memcpy(cdst, src, SIZE * sizeof(*cdst));
+    memcpy(odst, src, SIZE * sizeof(*odst));
+    memcpy(cstate, state, sizeof(cstate));
+    memcpy(ostate, state, sizeof(ostate));
+    call_ref(cdst, LEN, cstate, coeffs);
+    call_new(odst, LEN, ostate, coeffs);
+    /* the vector version must be bitexact, the filter output is compared
+     * against the scalar path in FATE */
+    if (memcmp(cdst, odst, SIZE * sizeof(*cdst)) ||
+        memcmp(cstate, ostate, sizeof(cstate)))
+        fail();
+    memcpy(odst, src, SIZE * sizeof(*odst));
+    memcpy(ostate, state, sizeof(ostate));
+    bench_new(odst, LEN, ostate, coeffs);
+}
+
+void checkasm_check_biquads(void)
+{
+    LOCAL_ALIGNED_32(double, src, [SIZE]);
+    /* lowpass at 1 kHz, 44.1 kHz sample rate, half wet */
+    static const double coeffs[BIQUADS_NB_COEFFS] = {
+        [BIQUADS_B0]  =  0.004604,
+        [BIQUADS_B1]  =  0.009208,
+        [BIQUADS_B2]  =  0.004604,
+        [BIQUADS_A1]  =  1.799087,
+        [BIQUADS_A2]  = -0.817503,
+        [BIQUADS_WET] =  0.5,
+        [BIQUADS_DRY] =  0.5,
+    };
+    double state[2 * BIQUADS_NB_LANES];
+    BiquadsDSPContext dsp = { 0 };
+    int i;
+
+    ff_biquads_init(&dsp);
+
+    for (i = 0; i < SIZE; i++)
+        src[i] = (rnd() & 0xffff) / 32768.0 - 1.0;
+    for (i = 0; i < 2 * BIQUADS_NB_LANES; i++)
+        state[i] = (rnd() & 0xff) / 256.0 - 0.5;
+
+    if (check_func(dsp.filter_tdii_lanes, "filter_tdii_lanes"))
+        test_filter_tdii_lanes(src, coeffs, state);
+    report("filter_tdii_lanes");
+}
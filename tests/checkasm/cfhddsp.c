@@ -0,0 +1,139 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/cfhddsp.h"
+#include "libavutil/common.h"
+
+#define WIDTH  480
+#define HEIGHT 8
+#define BUF_SIZE (WIDTH * HEIGHT)
+
+/* full range coefficients, so that the 16 bit truncation is covered */
+#define randomize_buffers(buf, size)        \
+    do {                                    \
+        int i;                              \
+        for (i = 0; i < size; i++)          \
+            buf[i] = rnd();                 \
+    } while (0)
+
+static const int widths[] = { 1, 2, 3, 9, 10, 17, 18, 33, 35, WIDTH };
+
+static void check_horiz_filter(CFHDDSPContext *c)
+{
+    LOCAL_ALIGNED_32(int16_t, low,     [WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, high,    [WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, dst_ref, [2 * WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, dst_new, [2 * WIDTH]);
+    int i;
+
+    declare_func(void, int16_t *output, const int16_t *low,
+                 const int16_t *high, int width);
+
+    if (check_func(c->horiz_filter, "cfhd_horiz_filter")) {
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            int width = FFMAX(widths[i], 3);
+
+            randomize_buffers(low,  WIDTH);
+            randomize_buffers(high, WIDTH);
+            memset(dst_ref, 0, 2 * WIDTH * sizeof(*dst_ref));
+            memset(dst_new, 0, 2 * WIDTH * sizeof(*dst_new));
+            call_ref(dst_ref, low, high, width);
+            call_new(dst_new, low, high, width);
+            if (memcmp(dst_ref, dst_new, 2 * WIDTH * sizeof(*dst_ref)))
+                fail();
+        }
+        bench_new(dst_new, low, high, WIDTH);
+    }
+    report("horiz_filter");
+}
+
+static void check_horiz_filter_clip(CFHDDSPContext *c)
+{
+    LOCAL_ALIGNED_32(int16_t, low,     [WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, high,    [WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, dst_ref, [2 * WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, dst_new, [2 * WIDTH]);
+    int i, bpc;
+
+    declare_func(void, int16_t *output, const int16_t *low,
+                 const int16_t *high, int width, int clip);
+
+    for (bpc = 10; bpc <= 12; bpc += 2) {
+        if (check_func(c->horiz_filter_clip, "cfhd_horiz_filter_clip_%d", bpc)) {
+            for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+                int width = FFMAX(widths[i], 3);
+
+                randomize_buffers(low,  WIDTH);
+                randomize_buffers(high, WIDTH);
+                memset(dst_ref, 0, 2 * WIDTH * sizeof(*dst_ref));
+                memset(dst_new, 0, 2 * WIDTH * sizeof(*dst_new));
+                call_ref(dst_ref, low, high, width, bpc);
+                call_new(dst_new, low, high, width, bpc);
+                if (memcmp(dst_ref, dst_new, 2 * WIDTH * sizeof(*dst_ref)))
+                    fail();
+            }
+            bench_new(dst_new, low, high, WIDTH, bpc);
+        }
+    }
+    report("horiz_filter_clip");
+}
+
+static void check_vert_filter(CFHDDSPContext *c)
+{
+    LOCAL_ALIGNED_32(int16_t, low,     [BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, high,    [BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, dst_ref, [2 * BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, dst_new, [2 * BUF_SIZE]);
+    int i;
+
+    declare_func(void, int16_t *output, ptrdiff_t out_stride,
+                 const int16_t *low, ptrdiff_t low_stride,
+                 const int16_t *high, ptrdiff_t high_stride,
+                 int width, int height);
+
+    if (check_func(c->vert_filter, "cfhd_vert_filter")) {
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            int width = widths[i];
+
+            randomize_buffers(low,  BUF_SIZE);
+            randomize_buffers(high, BUF_SIZE);
+            memset(dst_ref, 0, 2 * BUF_SIZE * sizeof(*dst_ref));
+            memset(dst_new, 0, 2 * BUF_SIZE * sizeof(*dst_new));
+            call_ref(dst_ref, width, low, WIDTH, high, WIDTH, width, HEIGHT);
+            call_new(dst_new, width, low, WIDTH, high, WIDTH, width, HEIGHT);
+            if (memcmp(dst_ref, dst_new, 2 * BUF_SIZE * sizeof(*dst_ref)))
+                fail();
+        }
+        bench_new(dst_new, WIDTH, low, WIDTH, high, WIDTH, WIDTH, HEIGHT);
+    }
+    report("vert_filter");
+}
+
+void checkasm_check_cfhddsp(void)
+{
+    CFHDDSPContext c;
+
+    ff_cfhddsp_init(&c);
+
+    check_horiz_filter(&c);
+    check_horiz_filter_clip(&c);
+    check_vert_filter(&c);
+}
@@ -43,9 +43,11 @@ void checkasm_check_aacpsdsp(void);
 void checkasm_check_afir(void);
 void checkasm_check_alacdsp(void);
 void checkasm_check_audiodsp(void);
+void checkasm_check_biquads(void);
 void checkasm_check_blend(void);
 void checkasm_check_blockdsp(void);
 void checkasm_check_bswapdsp(void);
+void checkasm_check_cfhddsp(void);
 void checkasm_check_colorspace(void);
 void checkasm_check_exrdsp(void);
 void checkasm_check_fixed_dsp(void);
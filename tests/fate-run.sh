@@ -162,6 +162,20 @@ md5(){
     do_md5sum $encfile | awk '{print $1}'
 }
 
+# $1=sample, $2=output format, $3=bitstream filter under test,
+# $4=bitstream filter removing the units the filter under test may modify;
+# prints "match" if all other units pass through unmodified
+bsf_passthrough(){
+    sample=$1
+    fmt=$2
+    bsf=$3
+    strip=$4
+
+    in_md5=$(md5pipe -i $sample -c:v copy -bsf:v $strip -f $fmt)
+    out_md5=$(md5pipe -i $sample -c:v copy -bsf:v $bsf,$strip -f $fmt)
+    test "$in_md5" = "$out_md5" && echo match || echo "$out_md5 != $in_md5"
+}
+
 pcm(){
     ffmpeg "$@" -vn -f s16le -
 }
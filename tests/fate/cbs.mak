@@ -1,15 +1,20 @@
 # Read/write tests: this uses the codec metadata filter - with no
-# arguments, it decomposes the stream fully and then recomposes it
-# without making any changes.
+# arguments (other than full_decompose where the filter only decomposes
+# the units it may modify by default), it decomposes the stream fully and
+# then recomposes it without making any changes.
 
 fate-cbs: fate-cbs-av1 fate-cbs-h264 fate-cbs-hevc fate-cbs-mpeg2 fate-cbs-vp9
 
+FATE_CBS_av1_ARGS  = =full_decompose=1
+FATE_CBS_h264_ARGS = =full_decompose=1
+FATE_CBS_hevc_ARGS = =full_decompose=1
+
 FATE_CBS_DEPS = $(call ALLYES, $(1)_DEMUXER $(2)_PARSER $(3)_METADATA_BSF $(4)_DECODER $(5)_MUXER)
 
 define FATE_CBS_TEST
 # (codec, test_name, sample_file, output_format)
 FATE_CBS_$(1) += fate-cbs-$(1)-$(2)
-fate-cbs-$(1)-$(2): CMD = md5 -i $(TARGET_SAMPLES)/$(3) -c:v copy -y -bsf:v $(1)_metadata -f $(4)
+fate-cbs-$(1)-$(2): CMD = md5 -i $(TARGET_SAMPLES)/$(3) -c:v copy -y -bsf:v $(1)_metadata$(FATE_CBS_$(1)_ARGS) -f $(4)
 endef
 
 # AV1 read/write
@@ -69,6 +74,15 @@ FATE_CBS_H264-$(call FATE_CBS_DEPS, H264, H264, H264, H264, H264) = $(FATE_CBS_h
 FATE_SAMPLES_AVCONV += $(FATE_CBS_H264-yes)
 fate-cbs-h264: $(FATE_CBS_H264-yes)
 
+# With only SPS options set, everything but the SPS must pass through the
+# filter bit-exact.
+FATE_CBS_H264_PASSTHROUGH-$(call ALLYES, H264_DEMUXER H264_PARSER H264_METADATA_BSF FILTER_UNITS_BSF H264_MUXER) += fate-cbs-h264-sps-passthrough
+fate-cbs-h264-sps-passthrough: CMD = bsf_passthrough $(TARGET_SAMPLES)/h264-conformance/SVA_Base_B.264 h264 h264_metadata=video_full_range_flag=1:crop_bottom=8 filter_units=remove_types=7
+fate-cbs-h264-sps-passthrough: CMP = oneline
+fate-cbs-h264-sps-passthrough: REF = match
+FATE_SAMPLES_AVCONV += $(FATE_CBS_H264_PASSTHROUGH-yes)
+fate-cbs-h264: $(FATE_CBS_H264_PASSTHROUGH-yes)
+
 # H.265 read/write
 
 FATE_CBS_HEVC_SAMPLES =       \
@@ -29,6 +29,10 @@ FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_parse_frames
+fate-ffprobe_parse_frames: $(FFPROBE_TEST_FILE)
+fate-ffprobe_parse_frames: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -show_streams -show_frames -count_frames -parse_frames -bitexact $(TARGET_PATH)/$(FFPROBE_TEST_FILE) -print_filename $(FFPROBE_TEST_FILE) -of compact
+
 FATE_FFPROBE += $(FATE_FFPROBE-yes)
 
 fate-ffprobe: $(FATE_FFPROBE)
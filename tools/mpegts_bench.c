@@ -0,0 +1,187 @@
+/*
+ * MPEG-TS muxer throughput benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Mux synthetic video and audio packets into MPEG-TS in memory and report
+ * the muxing throughput. Build with: make tools/mpegts_bench
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#include "libavformat/avformat.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+
+static int64_t output_size;
+
+static int null_write(void *opaque, uint8_t *buf, int size)
+{
+    output_size += size;
+    return size;
+}
+
+static void usage(void)
+{
+    printf("Usage: mpegts_bench [options]\n"
+           "  -s <services>  number of services, each with one video and one audio stream (default 16)\n"
+           "  -f <frames>    number of video frames per service (default 1000)\n"
+           "  -v <size>      video packet size in bytes (default 40000)\n"
+           "  -a <size>      audio packet size in bytes (default 768)\n"
+           "  -r <rate>      mux rate in bit/s for CBR output, 0 for VBR (default 0)\n"
+           "  -m             write m2ts (single service)\n");
+}
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *oc = NULL;
+    AVIOContext *pb = NULL;
+    uint8_t *video_data = NULL, *audio_data = NULL, *iobuf = NULL;
+    int nb_services = 16, nb_frames = 1000;
+    int video_size = 40000, audio_size = 768;
+    int64_t mux_rate = 0, payload_size = 0, t0, t1;
+    int m2ts = 0, i, j, k, opt, ret;
+    AVLFG lfg;
+
+    while ((opt = getopt(argc, argv, "s:f:v:a:r:mh")) != -1) {
+        switch (opt) {
+        case 's': nb_services = atoi(optarg);   break;
+        case 'f': nb_frames   = atoi(optarg);   break;
+        case 'v': video_size  = atoi(optarg);   break;
+        case 'a': audio_size  = atoi(optarg);   break;
+        case 'r': mux_rate    = atoll(optarg);  break;
+        case 'm': m2ts        = 1;              break;
+        default:
+            usage();
+            return opt != 'h';
+        }
+    }
+    if (m2ts)
+        nb_services = 1;
+    if (nb_services <= 0 || nb_frames <= 0 || video_size <= 0 || audio_size <= 0) {
+        usage();
+        return 1;
+    }
+
+    video_data = av_malloc(video_size);
+    audio_data = av_malloc(audio_size);
+    iobuf      = av_malloc(32768);
+    if (!video_data || !audio_data || !iobuf) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (i = 0; i < video_size; i++)
+        video_data[i] = av_lfg_get(&lfg);
+    for (i = 0; i < audio_size; i++)
+        audio_data[i] = av_lfg_get(&lfg);
+
+    if ((ret = avformat_alloc_output_context2(&oc, NULL, "mpegts", NULL)) < 0)
+        goto end;
+    pb = avio_alloc_context(iobuf, 32768, 1, NULL, NULL, null_write, NULL);
+    if (!pb) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    iobuf  = NULL;
+    oc->pb = pb;
+
+    for (i = 0; i < nb_services; i++) {
+        AVProgram *program = av_new_program(oc, i + 1);
+        for (j = 0; j < 2; j++) {
+            AVStream *st = avformat_new_stream(oc, NULL);
+            if (!st || !program) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            if (!j) {
+                st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+                st->codecpar->codec_id   = AV_CODEC_ID_MPEG2VIDEO;
+                st->codecpar->width      = 1920;
+                st->codecpar->height     = 1080;
+            } else {
+                st->codecpar->codec_type  = AVMEDIA_TYPE_AUDIO;
+                st->codecpar->codec_id    = AV_CODEC_ID_MP2;
+                st->codecpar->sample_rate = 48000;
+                st->codecpar->channels    = 2;
+            }
+            st->time_base = (AVRational){ 1, 90000 };
+            av_program_add_stream_index(oc, program->id, st->index);
+        }
+    }
+    if (mux_rate > 0)
+        av_opt_set_int(oc->priv_data, "muxrate", mux_rate, 0);
+    if (m2ts)
+        av_opt_set_int(oc->priv_data, "mpegts_m2ts_mode", 1, 0);
+
+    if ((ret = avformat_write_header(oc, NULL)) < 0)
+        goto end;
+
+    t0 = av_gettime_relative();
+    for (k = 0; k < nb_frames; k++) {
+        for (i = 0; i < oc->nb_streams; i++) {
+            AVStream *st = oc->streams[i];
+            int video = st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
+            AVPacket pkt;
+
+            av_init_packet(&pkt);
+            pkt.data         = video ? video_data : audio_data;
+            pkt.size         = video ? video_size : audio_size;
+            pkt.stream_index = i;
+            pkt.pts = pkt.dts = av_rescale_q(k * 3600LL, (AVRational){ 1, 90000 }, st->time_base);
+            if (!video || !(k % 12))
+                pkt.flags |= AV_PKT_FLAG_KEY;
+            payload_size += pkt.size;
+            if ((ret = av_write_frame(oc, &pkt)) < 0)
+                goto end;
+        }
+    }
+    if ((ret = av_write_trailer(oc)) < 0)
+        goto end;
+    t1 = av_gettime_relative();
+
+    printf("%d services, %d frames: %"PRId64" bytes in, %"PRId64" bytes out, "
+           "%.3f s, %.1f MB/s\n", nb_services, nb_frames, payload_size, output_size,
+           (t1 - t0) / 1000000.0, output_size / (double)FFMAX(t1 - t0, 1));
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    if (pb)
+        av_freep(&pb->buffer);
+    avio_context_free(&pb);
+    avformat_free_context(oc);
+    av_free(iobuf);
+    av_free(video_data);
+    av_free(audio_data);
+    return ret < 0;
+}
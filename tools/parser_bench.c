@@ -0,0 +1,165 @@
+/*
+ * Codec parser throughput benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Run a raw elementary stream (e.g. Annex B H.264/HEVC) through a codec
+ * parser the way a demuxer does and report the parsing throughput.
+ * Build with: make tools/parser_bench
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/file.h"
+#include "libavutil/time.h"
+
+static void usage(void)
+{
+    printf("Usage: parser_bench [options] <codec> <file>\n"
+           "  -b <size>      size of the chunks fed to the parser (default 4096)\n"
+           "  -f             feed complete frames, as packetized demuxers do\n"
+           "  -n <count>     number of passes over the file (default 10)\n");
+}
+
+int main(int argc, char **argv)
+{
+    const AVCodec *codec;
+    AVCodecContext *avctx = NULL;
+    AVCodecParserContext *parser = NULL;
+    uint8_t *data = NULL;
+    size_t size = 0;
+    int *frame_sizes = NULL;
+    int chunk_size = 4096, nb_passes = 10, complete_frames = 0;
+    int64_t nb_frames = 0, t0 = 0, t1;
+    int i, opt, ret;
+
+    while ((opt = getopt(argc, argv, "b:fn:h")) != -1) {
+        switch (opt) {
+        case 'b': chunk_size      = atoi(optarg); break;
+        case 'f': complete_frames = 1;            break;
+        case 'n': nb_passes       = atoi(optarg); break;
+        default:
+            usage();
+            return opt != 'h';
+        }
+    }
+    if (argc - optind != 2 || chunk_size <= 0 || nb_passes <= 0) {
+        usage();
+        return 1;
+    }
+
+    codec = avcodec_find_decoder_by_name(argv[optind]);
+    if (!codec) {
+        fprintf(stderr, "Unknown codec %s\n", argv[optind]);
+        return 1;
+    }
+    if ((ret = av_file_map(argv[optind + 1], &data, &size, 0, NULL)) < 0)
+        goto end;
+
+    avctx = avcodec_alloc_context3(NULL);
+    if (!avctx) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    avctx->codec_id = codec->id;
+
+    /* The first pass splits the stream; in complete frames mode it only
+     * records the frame sizes and is not timed */
+    for (i = -complete_frames; i < nb_passes; i++) {
+        size_t pos = 0;
+        int frame = 0;
+
+        if (!i)
+            t0 = av_gettime_relative();
+
+        parser = av_parser_init(codec->id);
+        if (!parser) {
+            fprintf(stderr, "No parser for codec %s\n", codec->name);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+        if (i >= 0 && complete_frames)
+            parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+
+        /* Feed the file in chunks and finally flush with an empty buffer */
+        for (;;) {
+            int len = i >= 0 && complete_frames ? frame_sizes[frame] :
+                                                  FFMIN(chunk_size, size - pos);
+            uint8_t *out;
+            int out_size;
+
+            ret = av_parser_parse2(parser, avctx, &out, &out_size,
+                                   data + pos, len,
+                                   AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+            pos += ret;
+            if (out_size) {
+                if (i < 0) {
+                    ret = av_reallocp_array(&frame_sizes, frame + 2,
+                                            sizeof(*frame_sizes));
+                    if (ret < 0)
+                        goto end;
+                    frame_sizes[frame]     = out_size;
+                    frame_sizes[frame + 1] = 0;
+                } else {
+                    nb_frames++;
+                }
+                frame++;
+            } else if (!len) {
+                break;
+            }
+        }
+        av_parser_close(parser);
+        parser = NULL;
+
+        if (i < 0 && !frame_sizes) {
+            fprintf(stderr, "No frames found\n");
+            ret = AVERROR_INVALIDDATA;
+            goto end;
+        }
+    }
+    t1 = av_gettime_relative();
+    ret = 0;
+
+    printf("%s: %"PRId64" frames, %"PRId64" bytes, %.3f s, %.1f MB/s, %.0f frames/s\n",
+           codec->name, nb_frames, (int64_t)size * nb_passes,
+           (t1 - t0) / 1000000.0, size * nb_passes / (double)FFMAX(t1 - t0, 1),
+           nb_frames * 1000000.0 / FFMAX(t1 - t0, 1));
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    av_parser_close(parser);
+    avcodec_free_context(&avctx);
+    av_free(frame_sizes);
+    if (data)
+        av_file_unmap(data, size);
+    return ret < 0;
+}